@@ -26,6 +26,39 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#ifdef SEQ_HOST
+
+/*
+ * Host build (hw/seq_host): the managers are a software model that is
+ * addressed with the sequencer's own Avalon addresses, so there is no
+ * APB translation and no U-Boot register base.
+ */
+#include "seq_model.h"
+
+#define IOWR_32DIRECT(BASE, OFFSET, DATA) \
+	seq_model_write((alt_u32)((BASE) + (OFFSET)), DATA)
+
+#define IORD_32DIRECT(BASE, OFFSET) \
+	seq_model_read((alt_u32)((BASE) + (OFFSET)))
+
+/* The model's stand-in for memory that survives a warm reset */
+#define CALIB_CACHE_BASE ((unsigned long)seq_model.cache)
+#define MARGIN_EXPORT_BASE ((unsigned long)seq_model.margins)
+#define TRK_BASELINE_BASE ((unsigned long)seq_model.baseline)
+
+/* Host time for ENABLE_CAL_TIMING, in ns */
+#define CAL_TIMESTAMP_INIT()
+#define CAL_TIMESTAMP() seq_model_timestamp()
+#define CAL_TIMESTAMP_TICKS_PER_US 1000
+
+/* The model's memory for the ENABLE_PRINTF_LOG trace ring, which also
+   serves as the base its strings are counted from */
+#define TRACE_RING_BASE ((unsigned long)seq_model.trace)
+#define TRACE_STRING_BASE ((const char *)seq_model.trace)
+#define TRACE_BARRIER() __sync_synchronize()
+
+#else
+
 #include <sdram.h>
 
 #define MGR_SELECT_MASK   0xf8000
@@ -52,3 +85,57 @@
 #define IORD_32DIRECT(BASE, OFFSET) \
 	read_register(HPS_SDR_BASE, __AVL_TO_APB((alt_u32)((BASE) + (OFFSET))))
 
+/*
+ * The Cortex-A9 PMU cycle counter, for ENABLE_CAL_TIMING: enabled and
+ * reset by setting PMCR.E and PMCR.C and enabling counter 31 in PMCNTENSET.
+ * It counts MPU clocks, CAL_TIMESTAMP_TICKS_PER_US of them per us.
+ */
+#define CAL_TIMESTAMP_INIT() do { \
+	unsigned int __pmcr; \
+	asm volatile ("mrc p15, 0, %0, c9, c12, 0" : "=r" (__pmcr)); \
+	asm volatile ("mcr p15, 0, %0, c9, c12, 0" : : "r" (__pmcr | 0x5)); \
+	asm volatile ("mcr p15, 0, %0, c9, c12, 1" : : "r" (0x80000000)); \
+} while (0)
+
+#define CAL_TIMESTAMP() ({ \
+	unsigned int __ccnt; \
+	asm volatile ("mrc p15, 0, %0, c9, c13, 0" : "=r" (__ccnt)); \
+	(alt_u32)__ccnt; \
+})
+
+#ifndef CAL_TIMESTAMP_TICKS_PER_US
+#define CAL_TIMESTAMP_TICKS_PER_US 800	/* MPU clock in MHz */
+#endif
+
+/*
+ * For ENABLE_PRINTF_LOG: an event's words reach memory before the head
+ * that publishes them, for a reader on another master
+ */
+#define TRACE_BARRIER() asm volatile ("dmb" : : : "memory")
+
+/*
+ * The trace ring's strings are offsets from where the boot ROM loads the
+ * preloader, so offsets into its .bin
+ */
+#define TRACE_STRING_BASE	0xFFFF0000
+
+/*
+ * On-chip RAM this board keeps for the records the sequencer leaves for
+ * a later boot or for the OS: 0xFFFFC000-0xFFFFDFFF.  The 8 KB above it
+ * are the boot ROM's workspace and the preloader's stack; the preloader's
+ * image, data and heap must end below it.  A warm reset leaves it alone,
+ * since the boot ROM reloads only the image.
+ */
+#define SEQ_RECORDS_BASE	0xFFFFC000
+#define SEQ_RECORDS_SIZE	0x2000
+
+#define TRACE_RING_BASE		(SEQ_RECORDS_BASE)
+#define TRACE_RING_SIZE		0x1400
+#define CALIB_CACHE_BASE	(SEQ_RECORDS_BASE + 0x1400)
+#define CALIB_CACHE_SIZE	0x200
+#define MARGIN_EXPORT_BASE	(SEQ_RECORDS_BASE + 0x1600)	/* sw/ddr_margins.c */
+#define MARGIN_EXPORT_SIZE	0x200
+#define TRK_BASELINE_BASE	(SEQ_RECORDS_BASE + 0x1800)	/* soc_system.dts */
+#define TRK_BASELINE_SIZE	0x100
+
+#endif /* SEQ_HOST */
@@ -44,6 +44,35 @@
 #include "hps_controller.h"
 #endif
 
+//USER The memory the options below leave their records in has no default
+//USER address (see sequencer.h): the board must reserve it
+#if ENABLE_CALIB_CACHE && !defined(CALIB_CACHE_BASE)
+#error "the calibration cache needs CALIB_CACHE_BASE, on-chip RAM reserved for it on this board"
+#endif
+#if ENABLE_MARGIN_EXPORT && !defined(MARGIN_EXPORT_BASE)
+#error "the margin export needs MARGIN_EXPORT_BASE, on-chip RAM reserved for it on this board"
+#endif
+#if ENABLE_TRACKING_BASELINE && !defined(TRK_BASELINE_BASE)
+#error "the tracking baseline needs TRK_BASELINE_BASE, on-chip RAM reserved for it on this board"
+#endif
+#if ENABLE_PRINTF_LOG && !ENABLE_TCL_DEBUG && !BFM_MODE && !defined(TRACE_RING_BASE)
+#error "the trace ring needs TRACE_RING_BASE, on-chip RAM reserved for it on this board"
+#endif
+
+//USER and the room the board gives each record must hold it
+#if ENABLE_CALIB_CACHE && defined(CALIB_CACHE_SIZE)
+typedef char calib_cache_fits[sizeof(calib_cache_t) <= CALIB_CACHE_SIZE ? 1 : -1];
+#endif
+#if ENABLE_MARGIN_EXPORT && defined(MARGIN_EXPORT_SIZE)
+typedef char margin_export_fits[sizeof(margin_export_t) <= MARGIN_EXPORT_SIZE ? 1 : -1];
+#endif
+#if ENABLE_PRINTF_LOG && defined(TRACE_RING_SIZE)
+typedef char trace_ring_fits[sizeof(trace_ring_t) <= TRACE_RING_SIZE ? 1 : -1];
+#endif
+#if ENABLE_TRACKING_BASELINE && defined(TRK_BASELINE_SIZE)
+typedef char trk_baseline_fits[(2 + TRK_BASELINE_MAX_GROUPS) * 4 <= TRK_BASELINE_SIZE ? 1 : -1];
+#endif
+
 
 /******************************************************************************
  ******************************************************************************
@@ -79,9 +108,6 @@ asm("__alt_stack_pointer = " STRINGIFY(STACK_POINTER));
 #endif
 
 #if ENABLE_PRINTF_LOG
-#include <stdio.h>
-#include <string.h>
-
 typedef struct {
 	alt_u32 v;
 	alt_u32 p;
@@ -257,29 +283,109 @@ debug_data_t my_debug_data;
 
 #elif ENABLE_PRINTF_LOG // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
-#define DLEVEL 2
+#define DLEVEL TRACE_LEVEL
 
-void wait_printf_queue()
-{
-	alt_u32 next_entry;
+volatile trace_ring_t *trace_ring = 0;
 
-	while (debug_printf_output->count == PRINTF_READ_BUFFER_FIFO_WORDS || debug_printf_output->slave_lock != 0)
-	{}
+//USER Point trace_ring at the debug data if there is any, else at
+//USER TRACE_RING_BASE if the board has one, and empty it.  With neither
+//USER the events go nowhere.
+static void trace_ring_start(void)
+{
+	trace_ring = 0;
+#ifdef TRACE_RING_BASE
+	trace_ring = (trace_ring_t *) TRACE_RING_BASE;
+#endif
+#if ENABLE_TCL_DEBUG
+	if (debug_data) {
+		trace_ring = &debug_data->printf_output;
+	}
+#endif
+	if (trace_ring == 0) {
+		return;
+	}
 
-	debug_printf_output->master_lock = 1;
-	next_entry = (debug_printf_output->head + debug_printf_output->count) % PRINTF_READ_BUFFER_FIFO_WORDS;
-	strcpy((char*)(&(debug_printf_output->read_buffer[next_entry])), (char*)(debug_printf_output->active_word));
-	debug_printf_output->count++;
-	debug_printf_output->master_lock = 0;
+	trace_ring->data_size = sizeof(trace_ring_t);
+	trace_ring->words = TRACE_RING_WORDS;
+	trace_ring->ticks_per_us = CAL_TIMESTAMP_TICKS_PER_US;
+	trace_ring->head = 0;
+	trace_ring->tail = 0;
+	trace_ring->dropped = 0;
 }
-#define DPRINT(level, fmt, args...) \
-	if (DLEVEL >= (level)) { \
-		snprintf((char*)(debug_printf_output->active_word), PRINTF_READ_BUFFER_SIZE*4, "DEBUG:" fmt, ## args); \
-		wait_printf_queue(); \
+
+//USER Copy an event into the ring and publish it by moving head, or count
+//USER it as dropped if the reader has not left room for it
+static void trace_put(alt_u32 info, const char *fmt, const alt_u32 *args)
+{
+	alt_u32 head, n, i;
+
+	if (trace_ring == 0) {
+		return;
+	}
+
+	head = trace_ring->head;
+	n = TRACE_EVENT_NARGS(info);
+	if (TRACE_RING_WORDS - (head - trace_ring->tail) < TRACE_EVENT_WORDS + n) {
+		trace_ring->dropped++;
+		return;
+	}
+
+	trace_ring->buf[head++ % TRACE_RING_WORDS] = info;
+	trace_ring->buf[head++ % TRACE_RING_WORDS] = CAL_TIMESTAMP();
+	trace_ring->buf[head++ % TRACE_RING_WORDS] = TRACE_STRING(fmt);
+	for (i = 0; i < n; i++) {
+		trace_ring->buf[head++ % TRACE_RING_WORDS] = args[i];
+	}
+	TRACE_BARRIER();
+	trace_ring->head = head;
+}
+
+//USER TRACE_NARGS counts the arguments (up to 24) and TRACE_WORDS turns each
+//USER of them into a TRACE_ARG, followed by a comma, for an event's argument
+//USER words.  TRACE_ARG stores a pointer, as %s takes, with TRACE_STRING and
+//USER casts anything else to alt_u32.
+#define TRACE_NARGS(args...) TRACE_NARGS_(0 , ## args, 24, 23, 22, 21, 20, 19, 18, \
+	17, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define TRACE_NARGS_(_0, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, \
+	_13, _14, _15, _16, _17, _18, _19, _20, _21, _22, _23, _24, n, rest...) n
+#define TRACE_ARG(a) __builtin_choose_expr(__builtin_classify_type(a) == 5, \
+	TRACE_STRING((const char *)(__UINTPTR_TYPE__)(a)), (alt_u32)(__UINTPTR_TYPE__)(a))
+#define TRACE_WORDS(n, args...)		TRACE_WORDS_(n, ## args)
+#define TRACE_WORDS_(n, args...)	TRACE_W ## n(args)
+#define TRACE_W0()
+#define TRACE_W1(a)			TRACE_ARG(a),
+#define TRACE_W2(a, rest...)		TRACE_ARG(a), TRACE_W1(rest)
+#define TRACE_W3(a, rest...)		TRACE_ARG(a), TRACE_W2(rest)
+#define TRACE_W4(a, rest...)		TRACE_ARG(a), TRACE_W3(rest)
+#define TRACE_W5(a, rest...)		TRACE_ARG(a), TRACE_W4(rest)
+#define TRACE_W6(a, rest...)		TRACE_ARG(a), TRACE_W5(rest)
+#define TRACE_W7(a, rest...)		TRACE_ARG(a), TRACE_W6(rest)
+#define TRACE_W8(a, rest...)		TRACE_ARG(a), TRACE_W7(rest)
+#define TRACE_W9(a, rest...)		TRACE_ARG(a), TRACE_W8(rest)
+#define TRACE_W10(a, rest...)		TRACE_ARG(a), TRACE_W9(rest)
+#define TRACE_W11(a, rest...)		TRACE_ARG(a), TRACE_W10(rest)
+#define TRACE_W12(a, rest...)		TRACE_ARG(a), TRACE_W11(rest)
+#define TRACE_W13(a, rest...)		TRACE_ARG(a), TRACE_W12(rest)
+#define TRACE_W14(a, rest...)		TRACE_ARG(a), TRACE_W13(rest)
+#define TRACE_W15(a, rest...)		TRACE_ARG(a), TRACE_W14(rest)
+#define TRACE_W16(a, rest...)		TRACE_ARG(a), TRACE_W15(rest)
+#define TRACE_W17(a, rest...)		TRACE_ARG(a), TRACE_W16(rest)
+#define TRACE_W18(a, rest...)		TRACE_ARG(a), TRACE_W17(rest)
+#define TRACE_W19(a, rest...)		TRACE_ARG(a), TRACE_W18(rest)
+#define TRACE_W20(a, rest...)		TRACE_ARG(a), TRACE_W19(rest)
+#define TRACE_W21(a, rest...)		TRACE_ARG(a), TRACE_W20(rest)
+#define TRACE_W22(a, rest...)		TRACE_ARG(a), TRACE_W21(rest)
+#define TRACE_W23(a, rest...)		TRACE_ARG(a), TRACE_W22(rest)
+#define TRACE_W24(a, rest...)		TRACE_ARG(a), TRACE_W23(rest)
+
+#define TRACE_EVENT(info, fmt, args...) { \
+		const alt_u32 __trace_args[] = { TRACE_WORDS(TRACE_NARGS(args), ## args) 0 }; \
+		trace_put((info) | TRACE_NARGS(args), fmt, __trace_args); \
 	}
+#define DPRINT(level, fmt, args...) \
+	if (DLEVEL >= (level)) TRACE_EVENT((level) << 8, fmt, ## args)
 #define IPRINT(fmt, args...) \
-		snprintf((char*)(debug_printf_output->active_word), PRINTF_READ_BUFFER_SIZE*4, "INFO:" fmt, ## args); \
-		wait_printf_queue();
+	TRACE_EVENT(TRACE_EVENT_INFO, fmt, ## args)
 
 #define BFM_GBL_SET(field,value)	bfm_gbl.field = value
 #define BFM_GBL_GET(field)		bfm_gbl.field
@@ -331,6 +437,9 @@ void wait_printf_queue()
 #if BFM_MODE
 // In BFM mode, we do full calibration as for real-rtl
 #define DYNAMIC_CALIB_STEPS STATIC_CALIB_STEPS
+#elif ENABLE_DE1_SOC_PROFILE
+// The hard PHY always runs the steps selected at compile time
+#define DYNAMIC_CALIB_STEPS STATIC_CALIB_STEPS
 #else
 #define DYNAMIC_CALIB_STEPS (dyn_calib_steps)
 #endif
@@ -370,14 +479,66 @@ alt_u16 dyn_calib_steps = 0;
 
 alt_u16 skip_delay_mask = 0;	// mask off bits when skipping/not-skipping
 
+#if ENABLE_DE1_SOC_PROFILE
+#define SKIP_DELAY_LOOP_VALUE_OR_ZERO(non_skip_value) \
+	(((DYNAMIC_CALIB_STEPS) & CALIB_SKIP_DELAY_LOOPS) ? 0 : (non_skip_value))
+#else
 #define SKIP_DELAY_LOOP_VALUE_OR_ZERO(non_skip_value) \
 	((non_skip_value) & skip_delay_mask)
+#endif
+
+// The debug mode flags calibration starts with
+#if ENABLE_MARGIN_REPORT_GEN || ENABLE_MARGIN_EXPORT
+// Only enable margining by default if requested
+#define STATIC_MARGIN_RPT PHY_DEBUG_ENABLE_MARGIN_RPT
+#else
+#define STATIC_MARGIN_RPT 0
+#endif
+#if ENABLE_SWEEP_ALL_GROUPS
+// Only sweep all groups (regardless of fail state) by default if requested
+#define STATIC_SWEEP_ALL_GROUPS PHY_DEBUG_SWEEP_ALL_GROUPS
+#else
+#define STATIC_SWEEP_ALL_GROUPS 0
+#endif
+#if DISABLE_GUARANTEED_READ
+#define STATIC_DISABLE_GUARANTEED_READ PHY_DEBUG_DISABLE_GUARANTEED_READ
+#else
+#define STATIC_DISABLE_GUARANTEED_READ 0
+#endif
+#if ENABLE_NON_DESTRUCTIVE_CALIB
+#define STATIC_NON_DESTRUCTIVE_CALIBRATION PHY_DEBUG_ENABLE_NON_DESTRUCTIVE_CALIBRATION
+#else
+#define STATIC_NON_DESTRUCTIVE_CALIBRATION 0
+#endif
+// Calibration report enabled by default
+#define STATIC_PHY_DEBUG_MODE_FLAGS (PHY_DEBUG_ENABLE_CAL_RPT | STATIC_MARGIN_RPT | \
+	STATIC_SWEEP_ALL_GROUPS | STATIC_DISABLE_GUARANTEED_READ | STATIC_NON_DESTRUCTIVE_CALIBRATION)
+
+#if ENABLE_DE1_SOC_PROFILE
+// Only the TCL debug interface changes them
+#define PHY_DEBUG_MODE_FLAGS STATIC_PHY_DEBUG_MODE_FLAGS
+#else
+#define PHY_DEBUG_MODE_FLAGS (gbl->phy_debug_mode_flags)
+#endif
 
 
 // TODO: The skip group strategy is completely missing
 
 gbl_t *gbl = 0;
+#if ENABLE_DE1_SOC_PROFILE
+// Every rank, group and shadow register is calibrated, with the masks
+// initialize would give them
+static const param_t static_param = {
+	.dm_correct_mask       = ((t_btfld)1 << (RW_MGR_MEM_DATA_WIDTH / RW_MGR_MEM_DATA_MASK_WIDTH)) - 1,
+	.read_correct_mask     = ((t_btfld)1 << RW_MGR_MEM_DQ_PER_READ_DQS) - 1,
+	.read_correct_mask_vg  = ((t_btfld)1 << (RW_MGR_MEM_DQ_PER_READ_DQS / RW_MGR_MEM_VIRTUAL_GROUPS_PER_READ_DQS)) - 1,
+	.write_correct_mask    = ((t_btfld)1 << RW_MGR_MEM_DQ_PER_WRITE_DQS) - 1,
+	.write_correct_mask_vg = ((t_btfld)1 << (RW_MGR_MEM_DQ_PER_READ_DQS / RW_MGR_MEM_VIRTUAL_GROUPS_PER_READ_DQS)) - 1,
+};
+#define param (&static_param)
+#else
 param_t *param = 0;
+#endif
 
 alt_u32 curr_shadow_reg = 0;
 
@@ -604,11 +765,83 @@ static void set_failing_group_stage(alt_u32 group, alt_u32 stage, alt_u32 substa
 
 	}
 
-	// Always set the group specific errors
-	TCLRPT_SET(debug_cal_report->cal_status_per_group[curr_shadow_reg][group].error_stage, stage);
-	TCLRPT_SET(debug_cal_report->cal_status_per_group[curr_shadow_reg][group].error_sub_stage, substage);
+	// Always set the group specific errors, but for group 0xff (every
+	// group), which the caller sets for each group itself
+#if ENABLE_TCL_DEBUG
+	if (group < RW_MGR_MEM_IF_WRITE_DQS_WIDTH)
+	{
+		TCLRPT_SET(debug_cal_report->cal_status_per_group[curr_shadow_reg][group].error_stage, stage);
+		TCLRPT_SET(debug_cal_report->cal_status_per_group[curr_shadow_reg][group].error_sub_stage, substage);
+	}
+#endif
+
+}
+
+#if ENABLE_CAL_TIMING
+cal_timing_t my_cal_timing;
+cal_timing_t *cal_timing = 0;
+
+//USER When REG_FILE_CUR_STAGE last changed, and to what
+static alt_u32 cal_timing_last;
+static alt_u32 cal_timing_cur;
+static alt_u32 cal_timing_begin;
+
+//USER Charge the time since the last change to the stage, sub-stage and group
+//USER REG_FILE_CUR_STAGE held, and start timing cur_stage_group
+static void cal_timing_mark(alt_u32 cur_stage_group)
+{
+	alt_u32 now, stage, sub_stage, group;
+
+	//USER Not timing until run_mem_calibrate starts
+	if (cal_timing == 0) {
+		return;
+	}
+
+	now = CAL_TIMESTAMP();
+	stage = cal_timing_cur & 0xff;
+	sub_stage = (cal_timing_cur >> 8) & 0xff;
+	group = (cal_timing_cur >> 16) & 0xffff;
+	if (stage < CAL_TIMING_STAGES && sub_stage < CAL_TIMING_SUBSTAGES && group < MAX_DQS) {
+		cal_timing->ticks[stage][sub_stage][group] += now - cal_timing_last;
+	}
+	cal_timing_last = now;
+	cal_timing_cur = cur_stage_group;
+}
+
+static void cal_timing_start(void)
+{
+	alt_u32 stage, sub_stage, group;
+
+	cal_timing = &my_cal_timing;
+#if ENABLE_TCL_DEBUG
+	if (debug_data) {
+		cal_timing = (cal_timing_t *)&debug_data->cal_timing;
+	}
+#endif
+
+	CAL_TIMESTAMP_INIT();
+	cal_timing->data_size = sizeof(cal_timing_t);
+	cal_timing->ticks_per_us = CAL_TIMESTAMP_TICKS_PER_US;
+	cal_timing->total = 0;
+	for (stage = 0; stage < CAL_TIMING_STAGES; stage++) {
+		for (sub_stage = 0; sub_stage < CAL_TIMING_SUBSTAGES; sub_stage++) {
+			for (group = 0; group < MAX_DQS; group++) {
+				cal_timing->ticks[stage][sub_stage][group] = 0;
+			}
+		}
+	}
+
+	cal_timing_cur = IORD_32DIRECT (REG_FILE_CUR_STAGE, 0);
+	cal_timing_begin = CAL_TIMESTAMP();
+	cal_timing_last = cal_timing_begin;
+}
 
+static void cal_timing_stop(void)
+{
+	cal_timing_mark(cal_timing_cur);
+	cal_timing->total = cal_timing_last - cal_timing_begin;
 }
+#endif
 
 static inline void reg_file_set_group(alt_u32 set_group)
 {
@@ -621,6 +854,10 @@ static inline void reg_file_set_group(alt_u32 set_group)
 	// Set the group
 	cur_stage_group |= (set_group << 16);
 
+#if ENABLE_CAL_TIMING
+	cal_timing_mark(cur_stage_group);
+#endif
+
 	// Write the data back
 	IOWR_32DIRECT (REG_FILE_CUR_STAGE, 0, cur_stage_group);
 }
@@ -636,6 +873,10 @@ static inline void reg_file_set_stage(alt_u32 set_stage)
 	// Set the stage
 	cur_stage_group |= (set_stage & 0x000000FF);
 
+#if ENABLE_CAL_TIMING
+	cal_timing_mark(cur_stage_group);
+#endif
+
 	// Write the data back
 	IOWR_32DIRECT (REG_FILE_CUR_STAGE, 0, cur_stage_group);
 }
@@ -651,6 +892,10 @@ static inline void reg_file_set_sub_stage(alt_u32 set_sub_stage)
 	// Set the sub stage
 	cur_stage_group |= ((set_sub_stage << 8) & 0x0000FF00);
 
+#if ENABLE_CAL_TIMING
+	cal_timing_mark(cur_stage_group);
+#endif
+
 	// Write the data back
 	IOWR_32DIRECT (REG_FILE_CUR_STAGE, 0, cur_stage_group);
 }
@@ -714,6 +959,7 @@ void initialize(void)
 	IOWR_32DIRECT (PHY_MGR_CAL_STATUS, 0, 0);
 	IOWR_32DIRECT (PHY_MGR_CAL_DEBUG_INFO, 0, 0);
 
+#if !ENABLE_DE1_SOC_PROFILE
 	if (((DYNAMIC_CALIB_STEPS) & CALIB_SKIP_ALL) != CALIB_SKIP_ALL) {
 		param->read_correct_mask_vg  = ((t_btfld)1 << (RW_MGR_MEM_DQ_PER_READ_DQS / RW_MGR_MEM_VIRTUAL_GROUPS_PER_READ_DQS)) - 1;
 		param->write_correct_mask_vg = ((t_btfld)1 << (RW_MGR_MEM_DQ_PER_READ_DQS / RW_MGR_MEM_VIRTUAL_GROUPS_PER_READ_DQS)) - 1;
@@ -721,6 +967,7 @@ void initialize(void)
 		param->write_correct_mask    = ((t_btfld)1 << RW_MGR_MEM_DQ_PER_WRITE_DQS) - 1;
 		param->dm_correct_mask       = ((t_btfld)1 << (RW_MGR_MEM_DATA_WIDTH / RW_MGR_MEM_DATA_MASK_WIDTH)) - 1;
 	}
+#endif
 }
 
 
@@ -1147,12 +1394,8 @@ void select_shadow_regs_for_update (alt_u32 rank, alt_u32 group, alt_u32 update_
 		IOWR_32DIRECT (SCC_MGR_DQS_ENA, 0, group);
 		IOWR_32DIRECT (SCC_MGR_DQS_IO_ENA, 0, 0);
 		
-		for (i = 0; i < RW_MGR_MEM_DQ_PER_WRITE_DQS; i++) {
-			IOWR_32DIRECT (SCC_MGR_DQ_ENA, 0, i);
-		}
-		for (i = 0; i < RW_MGR_NUM_DM_PER_WRITE_GROUP; i++) {
-			IOWR_32DIRECT (SCC_MGR_DM_ENA, 0, i);
-		}
+		scc_mgr_load_all_dq ();
+		scc_mgr_load_all_dm ();
 	}
 
 	//USER Map the rank to its shadow reg
@@ -1731,6 +1974,21 @@ void scc_mgr_load_dm (alt_u32 dm)
 	IOWR_32DIRECT (SCC_MGR_DM_ENA, 0, dm);
 }
 
+//USER load up the config settings of every dq (or dm) pin of the current
+//USER group at once: an ENA of 0xff is multicast to all of them, so a
+//USER group-wide change costs one scan chain load instead of one per pin.
+//USER Pins whose settings were not changed are loaded again as they are.
+
+void scc_mgr_load_all_dq (void)
+{
+	IOWR_32DIRECT (SCC_MGR_DQ_ENA, 0, 0xff);
+}
+
+void scc_mgr_load_all_dm (void)
+{
+	IOWR_32DIRECT (SCC_MGR_DM_ENA, 0, 0xff);
+}
+
 //USER apply and load a particular input delay for the DQ pins in a group
 //USER group_bgn is the index of the first dq pin (in the write group)
 
@@ -1740,8 +1998,8 @@ void scc_mgr_apply_group_dq_in_delay (alt_u32 write_group, alt_u32 group_bgn, al
 
 	for (i = 0, p = group_bgn; i < RW_MGR_MEM_DQ_PER_READ_DQS; i++, p++) {
 		scc_mgr_set_dq_in_delay(write_group, p, delay);
-		scc_mgr_load_dq (p);
 	}
+	scc_mgr_load_all_dq ();
 }
 
 //USER apply and load a particular output delay for the DQ pins in a group
@@ -1752,8 +2010,8 @@ void scc_mgr_apply_group_dq_out1_delay (alt_u32 write_group, alt_u32 group_bgn,
 
 	for (i = 0, p = group_bgn; i < RW_MGR_MEM_DQ_PER_WRITE_DQS; i++, p++) {
 		scc_mgr_set_dq_out1_delay(write_group, i, delay1);
-		scc_mgr_load_dq (i);
 	}
+	scc_mgr_load_all_dq ();
 }
 
 void scc_mgr_apply_group_dq_out2_delay (alt_u32 write_group, alt_u32 group_bgn, alt_u32 delay2)
@@ -1762,8 +2020,8 @@ void scc_mgr_apply_group_dq_out2_delay (alt_u32 write_group, alt_u32 group_bgn,
 
 	for (i = 0, p = group_bgn; i < RW_MGR_MEM_DQ_PER_WRITE_DQS; i++, p++) {
 		scc_mgr_set_dq_out2_delay(write_group, i, delay2);
-		scc_mgr_load_dq (i);
 	}
+	scc_mgr_load_all_dq ();
 }
 
 //USER apply and load a particular output delay for the DM pins in a group
@@ -1774,8 +2032,8 @@ void scc_mgr_apply_group_dm_out1_delay (alt_u32 write_group, alt_u32 delay1)
 
 	for (i = 0; i < RW_MGR_NUM_DM_PER_WRITE_GROUP; i++) {
 		scc_mgr_set_dm_out1_delay(write_group, i, delay1);
-		scc_mgr_load_dm (i);
 	}
+	scc_mgr_load_all_dm ();
 }
 
 
@@ -1906,8 +2164,8 @@ void scc_mgr_apply_group_all_out_delay_add (alt_u32 write_group, alt_u32 group_b
 		}
 
 		scc_mgr_set_dq_out2_delay(write_group, i, new_delay);
-		scc_mgr_load_dq (i);
 	}
+	scc_mgr_load_all_dq ();
 
 	//USER dm shift 
 
@@ -1923,8 +2181,8 @@ void scc_mgr_apply_group_all_out_delay_add (alt_u32 write_group, alt_u32 group_b
 		}
 
 		scc_mgr_set_dm_out2_delay(write_group, i, new_delay);
-		scc_mgr_load_dm (i);
 	}
+	scc_mgr_load_all_dm ();
 
 	//USER dqs shift 
 
@@ -1995,8 +2253,8 @@ static inline void scc_mgr_spread_out2_delay_all_ranks (alt_u32 write_group, alt
 			DPRINT(1, "rw_mgr_mem_calibrate_vfifo_find_dqs_en_phase_sweep_dq_in_delay: g=%lu r=%lu, i=%lu p=%lu d=%lu",
 			       write_group, r, i, p, d);
 			scc_mgr_set_dq_out2_delay(write_group, i, d);
-			scc_mgr_load_dq (i);
 		}
+		scc_mgr_load_all_dq ();
 		IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
 	}
 #endif
@@ -3744,6 +4002,10 @@ static inline void rw_mgr_mem_calibrate_read_load_patterns_all_ranks (void)
 //	
 //}
 
+#if ENABLE_READ_RECENTER
+alt_u32 mem_refresh_all_ranks (alt_u32 no_validate);
+#endif
+
 //USER  try a read and see if it returns correct data back. has dummy reads inserted into the mix
 //USER  used to align dqs enable. has more thorough checks than the regular read test.
 
@@ -3754,6 +4016,13 @@ alt_u32 rw_mgr_mem_calibrate_read_test (alt_u32 rank_bgn, alt_u32 group, alt_u32
 	t_btfld tmp_bit_chk;
 	alt_u32 rank_end = all_ranks ? RW_MGR_MEM_NUMBER_OF_RANKS : (rank_bgn + NUM_RANKS_PER_SHADOW_REG);
 
+#if ENABLE_READ_RECENTER
+	//USER Memory in use has had no refresh since the last test
+	if (gbl->live_memory) {
+		mem_refresh_all_ranks(1);
+	}
+#endif
+
 #if LRDIMM
 	// USER Disable MB Write-levelling mode and enter normal operation
 	rw_mgr_lrdimm_rc_program(0,12,0x0);
@@ -3783,6 +4052,10 @@ alt_u32 rw_mgr_mem_calibrate_read_test (alt_u32 rank_bgn, alt_u32 group, alt_u32
 			IOWR_32DIRECT (RW_MGR_LOAD_CNTR_0, 0, 0x1); /* need at least two (1+1) reads to capture failures */
 		} else if (all_groups) {
 			IOWR_32DIRECT (RW_MGR_LOAD_CNTR_0, 0, 0x06);
+#if ENABLE_ADAPTIVE_TEST_COUNT
+		} else if (gbl->short_test) {
+			IOWR_32DIRECT (RW_MGR_LOAD_CNTR_0, 0, SHORT_READ_TEST_LOOPS);
+#endif
 		} else {
 			IOWR_32DIRECT (RW_MGR_LOAD_CNTR_0, 0, 0x32);
 		}
@@ -3898,6 +4171,9 @@ void rw_mgr_incr_vfifo(alt_u32 grp, alt_u32 *v) {
 	}
 	
 	(*v)++;
+#if ENABLE_CALIB_CACHE
+	gbl->curr_vfifo[grp] = (gbl->curr_vfifo[grp] + 1) % VFIFO_SIZE;
+#endif
 #if USE_DQS_TRACKING && !HHP_HPS
 	IOWR_32DIRECT (TRK_V_POINTER, (grp << 2), *v);
 #endif
@@ -5062,8 +5338,8 @@ static inline alt_u32 rw_mgr_mem_calibrate_vfifo_find_dqs_en_phase_sweep_dq_in_d
 			DPRINT(1, "rw_mgr_mem_calibrate_vfifo_find_dqs_en_phase_sweep_dq_in_delay: g=%lu/%lu r=%lu, i=%lu p=%lu d=%lu",
 			       write_group, read_group, r, i, p, d);
 			scc_mgr_set_dq_in_delay(write_group, p, d);
-			scc_mgr_load_dq (p);
 		}
+		scc_mgr_load_all_dq ();
 		IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
 	}
 
@@ -5076,8 +5352,8 @@ static inline alt_u32 rw_mgr_mem_calibrate_vfifo_find_dqs_en_phase_sweep_dq_in_d
 		select_shadow_regs_for_update(r, write_group, 1);
 		for (i = 0, p = test_bgn; i < RW_MGR_MEM_DQ_PER_READ_DQS; i++, p++) {
 			scc_mgr_set_dq_in_delay(write_group, p, 0);
-			scc_mgr_load_dq (p);
 		}
+		scc_mgr_load_all_dq ();
 		IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
 	}
 
@@ -5087,134 +5363,501 @@ static inline alt_u32 rw_mgr_mem_calibrate_vfifo_find_dqs_en_phase_sweep_dq_in_d
 #endif
 }
 
-//USER per-bit deskew DQ and center 
+#if ENABLE_COARSE_EDGE_SEARCH
 
-#if NEWVERSION_RDDESKEW
+//USER Delays swept by the deskew edge searches
+#define EDGE_SWEEP_DQ_IN	0	//USER DQ input delay, DQS in place
+#define EDGE_SWEEP_DQS_IN	1	//USER DQS input delay from start, DQ at 0
+#define EDGE_SWEEP_DQ_OUT1	2	//USER DQ output delay, DQS in place
+#define EDGE_SWEEP_DQS_OUT1	3	//USER DQS and OCT output delay from start, DQ at 0
 
-alt_u32 rw_mgr_mem_calibrate_vfifo_center (alt_u32 rank_bgn, alt_u32 write_group, alt_u32 read_group, alt_u32 test_bgn, alt_u32 use_read_test, alt_u32 update_fom)
+#if RW_MGR_MEM_DQ_PER_READ_DQS > RW_MGR_MEM_DQ_PER_WRITE_DQS
+#define EDGE_SEARCH_MAX_BITS	RW_MGR_MEM_DQ_PER_READ_DQS
+#else
+#define EDGE_SEARCH_MAX_BITS	RW_MGR_MEM_DQ_PER_WRITE_DQS
+#endif
+
+//USER Set the swept delay to tap d and run the test the linear sweep runs there,
+//USER short if short_test (see ENABLE_ADAPTIVE_TEST_COUNT).
+//USER Returns which DQ bits of the group passed.
+static t_btfld rw_mgr_mem_calibrate_edge_probe (alt_u32 sweep, alt_u32 rank_bgn, alt_u32 write_group, alt_u32 read_group, alt_u32 test_bgn, alt_u32 use_read_test, alt_u32 start, alt_u32 start_en, alt_u32 d, alt_u32 short_test)
 {
-	alt_u32 i, p, d, min_index;
-	//USER Store these as signed since there are comparisons with signed numbers
 	t_btfld bit_chk;
-	t_btfld sticky_bit_chk;
-	alt_32 left_edge[RW_MGR_MEM_DQ_PER_READ_DQS];
-	alt_32 right_edge[RW_MGR_MEM_DQ_PER_READ_DQS];
-	alt_32 final_dq[RW_MGR_MEM_DQ_PER_READ_DQS];
-	alt_32 mid;
-	alt_32 orig_mid_min, mid_min;
-	alt_32 new_dqs, start_dqs, start_dqs_en, shift_dq, final_dqs, final_dqs_en;
-	alt_32 dq_margin, dqs_margin;
-	alt_u32 stop;
 
-	TRACE_FUNC("%lu %lu", read_group, test_bgn);
-#if BFM_MODE	
-	if (use_read_test) {
-		BFM_STAGE("vfifo_center");
-	} else {
-		BFM_STAGE("vfifo_center_after_writes");
+	switch (sweep) {
+	case EDGE_SWEEP_DQ_IN:
+		scc_mgr_apply_group_dq_in_delay (write_group, test_bgn, d);
+		break;
+	case EDGE_SWEEP_DQS_IN:
+		scc_mgr_set_dqs_bus_in_delay(read_group, d + start);
+		if (IO_SHIFT_DQS_EN_WHEN_SHIFT_DQS) {
+			alt_u32 delay = d + start_en;
+			if (delay > IO_DQS_EN_DELAY_MAX) {
+				delay = IO_DQS_EN_DELAY_MAX;
+			}
+			scc_mgr_set_dqs_en_delay(read_group, delay);
+		}
+		scc_mgr_load_dqs (read_group);
+		break;
+	case EDGE_SWEEP_DQ_OUT1:
+		scc_mgr_apply_group_dq_out1_delay (write_group, test_bgn, d);
+		break;
+	default:
+		scc_mgr_apply_group_dqs_io_and_oct_out1 (write_group, d + start);
+		break;
 	}
-#endif	
-	
-	ALTERA_ASSERT(read_group < RW_MGR_MEM_IF_READ_DQS_WIDTH);
-	ALTERA_ASSERT(write_group < RW_MGR_MEM_IF_WRITE_DQS_WIDTH);
 
-	start_dqs = READ_SCC_DQS_IN_DELAY(read_group);
-	if (IO_SHIFT_DQS_EN_WHEN_SHIFT_DQS) {
-		start_dqs_en = READ_SCC_DQS_EN_DELAY(read_group);
-	}
-	
-	select_curr_shadow_reg_using_rank(rank_bgn);
+	IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
 
-	//USER per-bit deskew 
-		
-	//USER set the left and right edge of each bit to an illegal value 
-	//USER use (IO_IO_IN_DELAY_MAX + 1) as an illegal value 
-	sticky_bit_chk = 0;
-	for (i = 0; i < RW_MGR_MEM_DQ_PER_READ_DQS; i++) {
-		left_edge[i]  = IO_IO_IN_DELAY_MAX + 1;
-		right_edge[i] = IO_IO_IN_DELAY_MAX + 1;
+#if ENABLE_ADAPTIVE_TEST_COUNT
+	gbl->short_test = short_test;
+#endif
+
+	if (sweep == EDGE_SWEEP_DQS_OUT1) {
+		if (QDRII) {
+			rw_mgr_mem_dll_lock_wait();
+		}
+		if (!rw_mgr_mem_calibrate_write_test (rank_bgn, write_group, 0, PASS_ONE_BIT, &bit_chk, 0)) {
+			recover_mem_device_after_ck_dqs_violation();
+		}
+	} else if (sweep == EDGE_SWEEP_DQ_OUT1) {
+		rw_mgr_mem_calibrate_write_test (rank_bgn, write_group, 0, PASS_ONE_BIT, &bit_chk, 0);
+	} else if (use_read_test) {
+		rw_mgr_mem_calibrate_read_test (rank_bgn, read_group, NUM_READ_PB_TESTS, PASS_ONE_BIT, &bit_chk, 0, 0);
+	} else {
+		rw_mgr_mem_calibrate_write_test (rank_bgn, write_group, 0, PASS_ONE_BIT, &bit_chk, 0);
+		bit_chk = bit_chk >> (RW_MGR_MEM_DQ_PER_READ_DQS * (read_group - (write_group * RW_MGR_MEM_IF_READ_DQS_WIDTH / RW_MGR_MEM_IF_WRITE_DQS_WIDTH)));
 	}
-	
-	//USER Search for the left edge of the window for each bit
-	for (d = 0; d <= IO_IO_IN_DELAY_MAX; d++) {
-		scc_mgr_apply_group_dq_in_delay (write_group, test_bgn, d);
 
-		IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
+#if ENABLE_ADAPTIVE_TEST_COUNT
+	gbl->short_test = 0;
+#endif
 
-		//USER Stop searching when the read test doesn't pass AND when we've seen a passing read on every bit
-		if (use_read_test) {
-			stop = !rw_mgr_mem_calibrate_read_test (rank_bgn, read_group, NUM_READ_PB_TESTS, PASS_ONE_BIT, &bit_chk, 0, 0);
-		} else {
-			rw_mgr_mem_calibrate_write_test (rank_bgn, write_group, 0, PASS_ONE_BIT, &bit_chk, 0);    
-			bit_chk = bit_chk >> (RW_MGR_MEM_DQ_PER_READ_DQS * (read_group - (write_group * RW_MGR_MEM_IF_READ_DQS_WIDTH / RW_MGR_MEM_IF_WRITE_DQS_WIDTH)));
-			stop = (bit_chk == 0);                                      
+	DPRINT(2, "find_edges(%lu): dtap=%lu => " BTFLD_FMT, sweep, d, bit_chk);
+	return bit_chk;
+}
+
+//USER Test every tap from 0 to max at full length, or with skip_coarse only
+//USER the ones between coarse taps, and widen the passing run of each of
+//USER the bits in bits to the taps where it passes
+static void rw_mgr_mem_calibrate_find_edges_all_taps (alt_u32 sweep, alt_u32 rank_bgn, alt_u32 write_group, alt_u32 read_group, alt_u32 test_bgn, alt_u32 use_read_test, alt_u32 start, alt_u32 start_en, alt_32 max, alt_u32 num_bits, t_btfld bits, alt_u32 skip_coarse, alt_32 *first, alt_32 *last)
+{
+	alt_u32 i;
+	alt_32 d;
+	t_btfld bit_chk;
+
+	for (d = 0; d <= max; d++) {
+		if (skip_coarse && d % COARSE_EDGE_SEARCH_STEP == 0) {
+			continue;
 		}
-		sticky_bit_chk = sticky_bit_chk | bit_chk;
-		stop = stop && (sticky_bit_chk == param->read_correct_mask);
-		DPRINT(2, "vfifo_center(left): dtap=%lu => " BTFLD_FMT " == " BTFLD_FMT " && %lu", d, sticky_bit_chk, param->read_correct_mask, stop);
-		
-		if (stop == 1) {
-			break;
-		} else {
-			for (i = 0; i < RW_MGR_MEM_DQ_PER_READ_DQS; i++) {
-				if (bit_chk & 1) {
-					//USER Remember a passing test as the left_edge
-					left_edge[i] = d;
-				} else {
-					//USER If a left edge has not been seen yet, then a future passing test will mark this edge as the right edge 
-					if (left_edge[i] == IO_IO_IN_DELAY_MAX + 1) {
-						right_edge[i] = -(d + 1);
-					}
+		bit_chk = rw_mgr_mem_calibrate_edge_probe (sweep, rank_bgn, write_group, read_group, test_bgn, use_read_test, start, start_en, d, 0) & bits;
+		for (i = 0; i < num_bits; i++, bit_chk >>= 1) {
+			if (bit_chk & 1) {
+				if (first[i] < 0 || d < first[i]) {
+					first[i] = d;
+				}
+				if (d > last[i]) {
+					last[i] = d;
 				}
-				DPRINT(2, "vfifo_center[l,d=%lu]: bit_chk_test=%d left_edge[%lu]: %ld right_edge[%lu]: %ld",
-				       d, (int)(bit_chk & 1), i, left_edge[i], i, right_edge[i]);
-				bit_chk = bit_chk >> 1;
 			}
 		}
 	}
+}
 
-	//USER Reset DQ delay chains to 0 
-	scc_mgr_apply_group_dq_in_delay (write_group, test_bgn, 0);
-	sticky_bit_chk = 0;
-	for (i = RW_MGR_MEM_DQ_PER_READ_DQS - 1;; i--) {
+//USER Find the first and last passing tap of each DQ bit over a sweep of
+//USER taps 0 to max, or -1 for a bit that never passes.  The sweep stops where
+//USER the linear one does: at a tap where every bit fails once every bit has
+//USER passed (bits already in sticky_bit_chk count as having passed).
+//USER
+//USER Only every COARSE_EDGE_SEARCH_STEP taps is tested on the way.  A coarse
+//USER tap that passes and its failing neighbour then bracket each edge, and the
+//USER brackets are bisected; a test in the middle of one bit's bracket also
+//USER narrows any other bracket it falls in, so bits with close edges share
+//USER tests.  If some bit never passed at a coarse tap its window may lie
+//USER between them, so every skipped tap is then tested as before.
+//USER
+//USER With ENABLE_ADAPTIVE_TEST_COUNT the coarse taps and the bisection are
+//USER tested short, and once a bit's bracket is bisected, the edge it found is
+//USER tested again at full length.  If it fails there it becomes the failing
+//USER side of the bracket and the next tap in is tested at full length, until
+//USER one passes.  A bit whose only pass was a short one that fails at full
+//USER length may have a window narrower than the coarse step, between coarse
+//USER taps, so its taps are all tested as in the fallback.
+static void rw_mgr_mem_calibrate_find_edges (alt_u32 sweep, alt_u32 rank_bgn, alt_u32 write_group, alt_u32 read_group, alt_u32 test_bgn, alt_u32 use_read_test, alt_u32 start, alt_u32 start_en, alt_32 max, alt_u32 num_bits, t_btfld correct_mask, t_btfld sticky_bit_chk, alt_32 *first, alt_32 *last)
+{
+	alt_u32 i;
+	alt_32 d;
+	t_btfld bit_chk;
+	//USER The failing taps either side of each bit's passing run
+	alt_32 first_fail[EDGE_SEARCH_MAX_BITS];
+	alt_32 last_fail[EDGE_SEARCH_MAX_BITS];
+#if ENABLE_ADAPTIVE_TEST_COUNT
+	//USER The bits whose first or last passing tap only passed a short test
+	t_btfld first_short = 0;
+	t_btfld last_short = 0;
+	//USER The bits to find by testing every tap after the bisection
+	t_btfld full_sweep = 0;
+	t_btfld mask;
+	alt_u32 short_probe;
+#endif
 
-		DPRINT(2, "vfifo_center: left_edge[%lu]: %ld right_edge[%lu]: %ld", i, left_edge[i], i, right_edge[i]);
+	ALTERA_ASSERT(num_bits <= EDGE_SEARCH_MAX_BITS);
 
-		//USER Check for cases where we haven't found the left edge, which makes our assignment of the the 
-		//USER right edge invalid.  Reset it to the illegal value. 
-		if ((left_edge[i] == IO_IO_IN_DELAY_MAX + 1) && (right_edge[i] != IO_IO_IN_DELAY_MAX + 1)) {
-			right_edge[i] = IO_IO_IN_DELAY_MAX + 1;
-			DPRINT(2, "vfifo_center: reset right_edge[%lu]: %ld", i, right_edge[i]);
-		}
-		
-		//USER Reset sticky bit (except for bits where we have seen both the left and right edge) 
-		sticky_bit_chk = sticky_bit_chk << 1;
-		if ((left_edge[i] != IO_IO_IN_DELAY_MAX + 1) && (right_edge[i] != IO_IO_IN_DELAY_MAX + 1)) {
-			sticky_bit_chk = sticky_bit_chk | 1;
-		}
+	for (i = 0; i < num_bits; i++) {
+		first[i] = -1;
+		last[i] = -1;
+	}
 
-		if (i == 0)
-		{
+	//USER Coarse sweep
+	for (d = 0; d <= max; d += COARSE_EDGE_SEARCH_STEP) {
+		bit_chk = rw_mgr_mem_calibrate_edge_probe (sweep, rank_bgn, write_group, read_group, test_bgn, use_read_test, start, start_en, d, 1);
+		sticky_bit_chk = sticky_bit_chk | bit_chk;
+		if (bit_chk == 0 && sticky_bit_chk == correct_mask) {
 			break;
 		}
-	}
-	
-	//USER Search for the right edge of the window for each bit 
-	for (d = 0; d <= IO_DQS_IN_DELAY_MAX - start_dqs; d++) {
-		scc_mgr_set_dqs_bus_in_delay(read_group, d + start_dqs);
-		if (IO_SHIFT_DQS_EN_WHEN_SHIFT_DQS) {
-			alt_u32 delay = d + start_dqs_en;
-			if (delay > IO_DQS_EN_DELAY_MAX) {
-				delay = IO_DQS_EN_DELAY_MAX;
+		for (i = 0; i < num_bits; i++, bit_chk >>= 1) {
+			if (bit_chk & 1) {
+				if (first[i] < 0) {
+					first[i] = d;
+				}
+				last[i] = d;
 			}
-			scc_mgr_set_dqs_en_delay(read_group, delay);
 		}
-		scc_mgr_load_dqs (read_group);
-
-		IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
+	}
 
-		//USER Stop searching when the read test doesn't pass AND when we've seen a passing read on every bit 
-		if (use_read_test) {
+	if (sticky_bit_chk != correct_mask) {
+		//USER Fall back to the taps the coarse sweep skipped
+#if ENABLE_ADAPTIVE_TEST_COUNT
+		//USER and to full tests of the ones it tested short
+		for (i = 0; i < num_bits; i++) {
+			first[i] = -1;
+			last[i] = -1;
+		}
+#endif
+		rw_mgr_mem_calibrate_find_edges_all_taps (sweep, rank_bgn, write_group, read_group, test_bgn, use_read_test, start, start_en, max, num_bits, correct_mask, !ENABLE_ADAPTIVE_TEST_COUNT, first, last);
+		return;
+	}
+
+	//USER Bracket the edges.  Taps outside the sweep count as failing.
+	for (i = 0; i < num_bits; i++) {
+		if (first[i] < 0) {
+			first_fail[i] = first[i] - 1;
+			last_fail[i] = last[i] + 1;
+			continue;
+		}
+		first_fail[i] = (first[i] > 0) ? first[i] - COARSE_EDGE_SEARCH_STEP : -1;
+		last_fail[i] = last[i] + COARSE_EDGE_SEARCH_STEP;
+		if (last_fail[i] > max + 1) {
+			last_fail[i] = max + 1;
+		}
+#if ENABLE_ADAPTIVE_TEST_COUNT
+		first_short |= (t_btfld)1 << i;
+		last_short |= (t_btfld)1 << i;
+#endif
+	}
+
+	//USER Bisect until every edge is next to a failing tap
+	for (;;) {
+#if ENABLE_ADAPTIVE_TEST_COUNT
+		short_probe = 1;
+#endif
+		for (i = 0; i < num_bits; i++) {
+			if (first[i] - first_fail[i] > 1) {
+				d = (first_fail[i] + first[i]) / 2;
+				break;
+			}
+			if (last_fail[i] - last[i] > 1) {
+				d = (last[i] + last_fail[i]) / 2;
+				break;
+			}
+#if ENABLE_ADAPTIVE_TEST_COUNT
+			short_probe = 0;
+			if (first_short & ((t_btfld)1 << i)) {
+				d = first[i];
+				break;
+			}
+			if (last_short & ((t_btfld)1 << i)) {
+				d = last[i];
+				break;
+			}
+			short_probe = 1;
+#endif
+		}
+		if (i == num_bits) {
+			break;
+		}
+
+#if ENABLE_ADAPTIVE_TEST_COUNT
+		bit_chk = rw_mgr_mem_calibrate_edge_probe (sweep, rank_bgn, write_group, read_group, test_bgn, use_read_test, start, start_en, d, short_probe);
+#else
+		bit_chk = rw_mgr_mem_calibrate_edge_probe (sweep, rank_bgn, write_group, read_group, test_bgn, use_read_test, start, start_en, d, 0);
+#endif
+		for (i = 0; i < num_bits; i++, bit_chk >>= 1) {
+#if ENABLE_ADAPTIVE_TEST_COUNT
+			mask = (t_btfld)1 << i;
+			if (!short_probe && ((d == first[i] && (first_short & mask)) || (d == last[i] && (last_short & mask)))) {
+				//USER A full test of an edge found short
+				if (bit_chk & 1) {
+					if (d == first[i]) {
+						first_short &= ~mask;
+					}
+					if (d == last[i]) {
+						last_short &= ~mask;
+					}
+				} else if (first[i] == last[i]) {
+					//USER The bit's only pass fails: it passes nowhere the
+					//USER bisection can reach, so leave it to the full sweep
+					full_sweep |= mask;
+					first_short &= ~mask;
+					last_short &= ~mask;
+					first[i] = -1;
+					last[i] = -1;
+					first_fail[i] = -2;
+					last_fail[i] = 0;
+				} else if (d == first[i]) {
+					first_fail[i] = d;
+					if (d + 1 < last[i]) {
+						first[i] = d + 1;
+					} else {
+						first[i] = last[i];
+						first_short = (first_short & ~mask) | (last_short & mask);
+					}
+				} else {
+					last_fail[i] = d;
+					if (d - 1 > first[i]) {
+						last[i] = d - 1;
+					} else {
+						last[i] = first[i];
+						last_short = (last_short & ~mask) | (first_short & mask);
+					}
+				}
+				continue;
+			}
+#endif
+			if (d > first_fail[i] && d < first[i]) {
+				if (bit_chk & 1) {
+					first[i] = d;
+#if ENABLE_ADAPTIVE_TEST_COUNT
+					first_short = (first_short & ~mask) | (short_probe ? mask : 0);
+#endif
+				} else {
+					first_fail[i] = d;
+				}
+			}
+			if (d > last[i] && d < last_fail[i]) {
+				if (bit_chk & 1) {
+					last[i] = d;
+#if ENABLE_ADAPTIVE_TEST_COUNT
+					last_short = (last_short & ~mask) | (short_probe ? mask : 0);
+#endif
+				} else {
+					last_fail[i] = d;
+				}
+			}
+		}
+	}
+
+#if ENABLE_ADAPTIVE_TEST_COUNT
+	if (full_sweep) {
+		rw_mgr_mem_calibrate_find_edges_all_taps (sweep, rank_bgn, write_group, read_group, test_bgn, use_read_test, start, start_en, max, num_bits, full_sweep, 0, first, last);
+	}
+#endif
+}
+
+//USER Turn the runs found by sweeping DQ into the edges the linear sweep
+//USER records: the last pass is the left edge, and the taps that failed
+//USER before the first pass make up a negative right edge
+static void rw_mgr_mem_calibrate_dq_edges (alt_u32 num_bits, alt_32 *first, alt_32 *last, alt_32 *left_edge, alt_32 *right_edge)
+{
+	alt_u32 i;
+
+	for (i = 0; i < num_bits; i++) {
+		if (last[i] >= 0) {
+			left_edge[i] = last[i];
+			if (first[i] > 0) {
+				right_edge[i] = -first[i];
+			}
+		}
+	}
+}
+
+//USER Same for the runs found by sweeping DQS from start, up to max, after
+//USER the DQ sweep: the last pass is the right edge.  Failing taps before the
+//USER first pass make up a negative left edge for bits that did not pass in
+//USER the DQ sweep, and mark the rest as marginal (-1) until a pass.
+static void rw_mgr_mem_calibrate_dqs_edges (alt_u32 num_bits, alt_32 max, alt_32 illegal, alt_32 *first, alt_32 *last, alt_32 *left_edge, alt_32 *right_edge)
+{
+	alt_u32 i;
+
+	for (i = 0; i < num_bits; i++) {
+		if (right_edge[i] == illegal && first[i] != 0) {
+			if (left_edge[i] != illegal) {
+				right_edge[i] = -1;
+			} else {
+				left_edge[i] = (first[i] > 0) ? -first[i] : -(max + 1);
+			}
+		}
+		if (last[i] >= 0) {
+			right_edge[i] = last[i];
+		}
+	}
+}
+
+#endif
+
+//USER per-bit deskew DQ and center 
+
+#if NEWVERSION_RDDESKEW
+
+alt_u32 rw_mgr_mem_calibrate_vfifo_center (alt_u32 rank_bgn, alt_u32 write_group, alt_u32 read_group, alt_u32 test_bgn, alt_u32 use_read_test, alt_u32 update_fom)
+{
+	alt_u32 i, p, min_index;
+#if !ENABLE_COARSE_EDGE_SEARCH || QDRII || RLDRAMX
+	alt_u32 d;
+#endif
+	//USER Store these as signed since there are comparisons with signed numbers
+#if !ENABLE_COARSE_EDGE_SEARCH
+	t_btfld bit_chk;
+#endif
+	t_btfld sticky_bit_chk;
+	alt_32 left_edge[RW_MGR_MEM_DQ_PER_READ_DQS];
+	alt_32 right_edge[RW_MGR_MEM_DQ_PER_READ_DQS];
+	alt_32 final_dq[RW_MGR_MEM_DQ_PER_READ_DQS];
+#if ENABLE_COARSE_EDGE_SEARCH
+	alt_32 first_pass[RW_MGR_MEM_DQ_PER_READ_DQS];
+	alt_32 last_pass[RW_MGR_MEM_DQ_PER_READ_DQS];
+#endif
+	alt_32 mid;
+	alt_32 orig_mid_min, mid_min;
+	alt_32 new_dqs, start_dqs, start_dqs_en, shift_dq, final_dqs, final_dqs_en;
+	alt_32 dq_margin, dqs_margin;
+#if !ENABLE_COARSE_EDGE_SEARCH
+	alt_u32 stop;
+#endif
+
+	TRACE_FUNC("%lu %lu", read_group, test_bgn);
+#if BFM_MODE	
+	if (use_read_test) {
+		BFM_STAGE("vfifo_center");
+	} else {
+		BFM_STAGE("vfifo_center_after_writes");
+	}
+#endif	
+	
+	ALTERA_ASSERT(read_group < RW_MGR_MEM_IF_READ_DQS_WIDTH);
+	ALTERA_ASSERT(write_group < RW_MGR_MEM_IF_WRITE_DQS_WIDTH);
+
+	start_dqs = READ_SCC_DQS_IN_DELAY(read_group);
+	if (IO_SHIFT_DQS_EN_WHEN_SHIFT_DQS) {
+		start_dqs_en = READ_SCC_DQS_EN_DELAY(read_group);
+	}
+	
+	select_curr_shadow_reg_using_rank(rank_bgn);
+
+	//USER per-bit deskew 
+		
+	//USER set the left and right edge of each bit to an illegal value 
+	//USER use (IO_IO_IN_DELAY_MAX + 1) as an illegal value 
+	sticky_bit_chk = 0;
+	for (i = 0; i < RW_MGR_MEM_DQ_PER_READ_DQS; i++) {
+		left_edge[i]  = IO_IO_IN_DELAY_MAX + 1;
+		right_edge[i] = IO_IO_IN_DELAY_MAX + 1;
+	}
+	
+#if ENABLE_COARSE_EDGE_SEARCH
+	//USER Search for the left edge of the window for each bit
+	rw_mgr_mem_calibrate_find_edges (EDGE_SWEEP_DQ_IN, rank_bgn, write_group, read_group, test_bgn, use_read_test, 0, 0,
+		IO_IO_IN_DELAY_MAX, RW_MGR_MEM_DQ_PER_READ_DQS, param->read_correct_mask, 0, first_pass, last_pass);
+	rw_mgr_mem_calibrate_dq_edges (RW_MGR_MEM_DQ_PER_READ_DQS, first_pass, last_pass, left_edge, right_edge);
+#else
+	//USER Search for the left edge of the window for each bit
+	for (d = 0; d <= IO_IO_IN_DELAY_MAX; d++) {
+		scc_mgr_apply_group_dq_in_delay (write_group, test_bgn, d);
+
+		IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
+
+		//USER Stop searching when the read test doesn't pass AND when we've seen a passing read on every bit
+		if (use_read_test) {
+			stop = !rw_mgr_mem_calibrate_read_test (rank_bgn, read_group, NUM_READ_PB_TESTS, PASS_ONE_BIT, &bit_chk, 0, 0);
+		} else {
+			rw_mgr_mem_calibrate_write_test (rank_bgn, write_group, 0, PASS_ONE_BIT, &bit_chk, 0);    
+			bit_chk = bit_chk >> (RW_MGR_MEM_DQ_PER_READ_DQS * (read_group - (write_group * RW_MGR_MEM_IF_READ_DQS_WIDTH / RW_MGR_MEM_IF_WRITE_DQS_WIDTH)));
+			stop = (bit_chk == 0);                                      
+		}
+		sticky_bit_chk = sticky_bit_chk | bit_chk;
+		stop = stop && (sticky_bit_chk == param->read_correct_mask);
+		DPRINT(2, "vfifo_center(left): dtap=%lu => " BTFLD_FMT " == " BTFLD_FMT " && %lu", d, sticky_bit_chk, param->read_correct_mask, stop);
+		
+		if (stop == 1) {
+			break;
+		} else {
+			for (i = 0; i < RW_MGR_MEM_DQ_PER_READ_DQS; i++) {
+				if (bit_chk & 1) {
+					//USER Remember a passing test as the left_edge
+					left_edge[i] = d;
+				} else {
+					//USER If a left edge has not been seen yet, then a future passing test will mark this edge as the right edge 
+					if (left_edge[i] == IO_IO_IN_DELAY_MAX + 1) {
+						right_edge[i] = -(d + 1);
+					}
+				}
+				DPRINT(2, "vfifo_center[l,d=%lu]: bit_chk_test=%d left_edge[%lu]: %ld right_edge[%lu]: %ld",
+				       d, (int)(bit_chk & 1), i, left_edge[i], i, right_edge[i]);
+				bit_chk = bit_chk >> 1;
+			}
+		}
+	}
+#endif
+
+	//USER Reset DQ delay chains to 0 
+	scc_mgr_apply_group_dq_in_delay (write_group, test_bgn, 0);
+	sticky_bit_chk = 0;
+	for (i = RW_MGR_MEM_DQ_PER_READ_DQS - 1;; i--) {
+
+		DPRINT(2, "vfifo_center: left_edge[%lu]: %ld right_edge[%lu]: %ld", i, left_edge[i], i, right_edge[i]);
+
+		//USER Check for cases where we haven't found the left edge, which makes our assignment of the the 
+		//USER right edge invalid.  Reset it to the illegal value. 
+		if ((left_edge[i] == IO_IO_IN_DELAY_MAX + 1) && (right_edge[i] != IO_IO_IN_DELAY_MAX + 1)) {
+			right_edge[i] = IO_IO_IN_DELAY_MAX + 1;
+			DPRINT(2, "vfifo_center: reset right_edge[%lu]: %ld", i, right_edge[i]);
+		}
+		
+		//USER Reset sticky bit (except for bits where we have seen both the left and right edge) 
+		sticky_bit_chk = sticky_bit_chk << 1;
+		if ((left_edge[i] != IO_IO_IN_DELAY_MAX + 1) && (right_edge[i] != IO_IO_IN_DELAY_MAX + 1)) {
+			sticky_bit_chk = sticky_bit_chk | 1;
+		}
+
+		if (i == 0)
+		{
+			break;
+		}
+	}
+	
+#if ENABLE_COARSE_EDGE_SEARCH
+	//USER Search for the right edge of the window for each bit 
+	rw_mgr_mem_calibrate_find_edges (EDGE_SWEEP_DQS_IN, rank_bgn, write_group, read_group, test_bgn, use_read_test, start_dqs, IO_SHIFT_DQS_EN_WHEN_SHIFT_DQS ? start_dqs_en : 0,
+		IO_DQS_IN_DELAY_MAX - start_dqs, RW_MGR_MEM_DQ_PER_READ_DQS, param->read_correct_mask, sticky_bit_chk, first_pass, last_pass);
+	rw_mgr_mem_calibrate_dqs_edges (RW_MGR_MEM_DQ_PER_READ_DQS, IO_DQS_IN_DELAY_MAX - start_dqs, IO_IO_IN_DELAY_MAX + 1,
+		first_pass, last_pass, left_edge, right_edge);
+#else
+	//USER Search for the right edge of the window for each bit 
+	for (d = 0; d <= IO_DQS_IN_DELAY_MAX - start_dqs; d++) {
+		scc_mgr_set_dqs_bus_in_delay(read_group, d + start_dqs);
+		if (IO_SHIFT_DQS_EN_WHEN_SHIFT_DQS) {
+			alt_u32 delay = d + start_dqs_en;
+			if (delay > IO_DQS_EN_DELAY_MAX) {
+				delay = IO_DQS_EN_DELAY_MAX;
+			}
+			scc_mgr_set_dqs_en_delay(read_group, delay);
+		}
+		scc_mgr_load_dqs (read_group);
+
+		IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
+
+		//USER Stop searching when the read test doesn't pass AND when we've seen a passing read on every bit 
+		if (use_read_test) {
 			stop = !rw_mgr_mem_calibrate_read_test (rank_bgn, read_group, NUM_READ_PB_TESTS, PASS_ONE_BIT, &bit_chk, 0, 0);
 		} else {
 			rw_mgr_mem_calibrate_write_test (rank_bgn, write_group, 0, PASS_ONE_BIT, &bit_chk, 0);    
@@ -5258,6 +5901,7 @@ alt_u32 rw_mgr_mem_calibrate_vfifo_center (alt_u32 rank_bgn, alt_u32 write_group
 			}
 		}
 	}
+#endif
 
 	// Store all observed margins
 #if ENABLE_TCL_DEBUG
@@ -5364,7 +6008,6 @@ alt_u32 rw_mgr_mem_calibrate_vfifo_center (alt_u32 rank_bgn, alt_u32 write_group
 		DPRINT(2, "vfifo_center: after: shift_dq[%lu]=%ld", i, shift_dq);
 		final_dq[i] = READ_SCC_DQ_IN_DELAY(p) + shift_dq;
 		scc_mgr_set_dq_in_delay(write_group, p, final_dq[i]);
-		scc_mgr_load_dq (p);
 		
 		DPRINT(2, "vfifo_center: margin[%lu]=[%ld,%ld]", i,
 		       left_edge[i] - shift_dq + (-mid_min),
@@ -5377,6 +6020,7 @@ alt_u32 rw_mgr_mem_calibrate_vfifo_center (alt_u32 rank_bgn, alt_u32 write_group
 			dqs_margin = right_edge[i] + shift_dq - (-mid_min);
 		}
 	}
+	scc_mgr_load_all_dq ();
 
 #if ENABLE_DQS_IN_CENTERING	
 	final_dqs = new_dqs;
@@ -5831,7 +6475,7 @@ alt_u32 rw_mgr_mem_calibrate_vfifo (alt_u32 read_group, alt_u32 test_bgn)
 			
 #if DDRX
 #if !AP_MODE
-			if (!(gbl->phy_debug_mode_flags & PHY_DEBUG_DISABLE_GUARANTEED_READ)) {
+			if (!(PHY_DEBUG_MODE_FLAGS & PHY_DEBUG_DISABLE_GUARANTEED_READ)) {
 				if (!rw_mgr_mem_calibrate_read_test_patterns_all_ranks (read_group, 1, &bit_chk)) {
 					DPRINT(1, "Guaranteed read test failed: g=%lu p=%lu d=%lu", read_group, p, d);
 					break;
@@ -6043,7 +6687,7 @@ alt_u32 rw_mgr_mem_calibrate_vfifo (alt_u32 g, alt_u32 test_bgn)
 
 		rw_mgr_mem_calibrate_read_load_patterns_all_ranks ();
 #if DDRX
-		if (!(gbl->phy_debug_mode_flags & PHY_DEBUG_DISABLE_GUARANTEED_READ)) {
+		if (!(PHY_DEBUG_MODE_FLAGS & PHY_DEBUG_DISABLE_GUARANTEED_READ)) {
 			if (!rw_mgr_mem_calibrate_read_test_patterns_all_ranks (read_group, 1, &bit_chk)) {
 				break;
 			}
@@ -6376,6 +7020,10 @@ void rw_mgr_mem_calibrate_write_test_issue (alt_u32 group, alt_u32 test_dm)
 
 	if(quick_write_mode) {
 		IOWR_32DIRECT (RW_MGR_LOAD_CNTR_0, 0, 0x08);
+#if ENABLE_ADAPTIVE_TEST_COUNT
+	} else if (gbl->short_test) {
+		IOWR_32DIRECT (RW_MGR_LOAD_CNTR_0, 0, SHORT_WRITE_TEST_LOOPS);
+#endif
 	} else {
 #if ENABLE_NON_DES_CAL
 		IOWR_32DIRECT (RW_MGR_LOAD_CNTR_0, 0, 0x08); // Break this up for refresh purposes
@@ -7239,6 +7887,10 @@ alt_u32 rw_mgr_mem_calibrate_writes_center (alt_u32 rank_bgn, alt_u32 write_grou
 	t_btfld sticky_bit_chk;
 	alt_32 left_edge[RW_MGR_MEM_DQ_PER_WRITE_DQS];
 	alt_32 right_edge[RW_MGR_MEM_DQ_PER_WRITE_DQS];
+#if ENABLE_COARSE_EDGE_SEARCH
+	alt_32 first_pass[RW_MGR_MEM_DQ_PER_WRITE_DQS];
+	alt_32 last_pass[RW_MGR_MEM_DQ_PER_WRITE_DQS];
+#endif
 	alt_32 mid;
 	alt_32 mid_min, orig_mid_min;
 	alt_32 new_dqs, start_dqs, shift_dq;
@@ -7246,7 +7898,9 @@ alt_u32 rw_mgr_mem_calibrate_writes_center (alt_u32 rank_bgn, alt_u32 write_grou
 	alt_32 new_dq[RW_MGR_MEM_DQ_PER_WRITE_DQS];
 #endif
 	alt_32 dq_margin, dqs_margin, dm_margin;
+#if !ENABLE_COARSE_EDGE_SEARCH
 	alt_u32 stop;
+#endif
 
 	TRACE_FUNC("%lu %lu", write_group, test_bgn);
 	BFM_STAGE("writes_center");
@@ -7269,6 +7923,12 @@ alt_u32 rw_mgr_mem_calibrate_writes_center (alt_u32 rank_bgn, alt_u32 write_grou
 		right_edge[i] = IO_IO_OUT1_DELAY_MAX + 1;
 	}
 	
+#if ENABLE_COARSE_EDGE_SEARCH
+	//USER Search for the left edge of the window for each bit
+	rw_mgr_mem_calibrate_find_edges (EDGE_SWEEP_DQ_OUT1, rank_bgn, write_group, 0, test_bgn, 0, 0, 0,
+		IO_IO_OUT1_DELAY_MAX, RW_MGR_MEM_DQ_PER_WRITE_DQS, param->write_correct_mask, 0, first_pass, last_pass);
+	rw_mgr_mem_calibrate_dq_edges (RW_MGR_MEM_DQ_PER_WRITE_DQS, first_pass, last_pass, left_edge, right_edge);
+#else
 	//USER Search for the left edge of the window for each bit
 	for (d = 0; d <= IO_IO_OUT1_DELAY_MAX; d++) {
 		scc_mgr_apply_group_dq_out1_delay (write_group, test_bgn, d);
@@ -7301,6 +7961,7 @@ alt_u32 rw_mgr_mem_calibrate_writes_center (alt_u32 rank_bgn, alt_u32 write_grou
 			}
 		}
 	}
+#endif
 
 	//USER Reset DQ delay chains to 0 
 	scc_mgr_apply_group_dq_out1_delay (write_group, test_bgn, 0);
@@ -7328,6 +7989,13 @@ alt_u32 rw_mgr_mem_calibrate_writes_center (alt_u32 rank_bgn, alt_u32 write_grou
 		}
 	}
 	
+#if ENABLE_COARSE_EDGE_SEARCH
+	//USER Search for the right edge of the window for each bit 
+	rw_mgr_mem_calibrate_find_edges (EDGE_SWEEP_DQS_OUT1, rank_bgn, write_group, 0, test_bgn, 0, start_dqs, 0,
+		IO_IO_OUT1_DELAY_MAX - start_dqs, RW_MGR_MEM_DQ_PER_WRITE_DQS, param->write_correct_mask, sticky_bit_chk, first_pass, last_pass);
+	rw_mgr_mem_calibrate_dqs_edges (RW_MGR_MEM_DQ_PER_WRITE_DQS, IO_IO_OUT1_DELAY_MAX - start_dqs, IO_IO_OUT1_DELAY_MAX + 1,
+		first_pass, last_pass, left_edge, right_edge);
+#else
 	//USER Search for the right edge of the window for each bit 
 	for (d = 0; d <= IO_IO_OUT1_DELAY_MAX - start_dqs; d++) {
 		scc_mgr_apply_group_dqs_io_and_oct_out1 (write_group, d + start_dqs);
@@ -7386,6 +8054,7 @@ alt_u32 rw_mgr_mem_calibrate_writes_center (alt_u32 rank_bgn, alt_u32 write_grou
 			}
 		}
 	}
+#endif
 
 #if ENABLE_TCL_DEBUG
 	// Store all observed margins
@@ -7476,7 +8145,6 @@ alt_u32 rw_mgr_mem_calibrate_writes_center (alt_u32 rank_bgn, alt_u32 write_grou
 #endif
 		DPRINT(2, "write_center: after: shift_dq[%lu]=%ld", i, shift_dq);
 		scc_mgr_set_dq_out1_delay(write_group, i, READ_SCC_DQ_OUT1_DELAY(i) + shift_dq);
-		scc_mgr_load_dq (i);
 		
 		DPRINT(2, "write_center: margin[%lu]=[%ld,%ld]", i,
 		       left_edge[i] - shift_dq + (-mid_min),
@@ -7489,6 +8157,7 @@ alt_u32 rw_mgr_mem_calibrate_writes_center (alt_u32 rank_bgn, alt_u32 write_grou
 			dqs_margin = right_edge[i] + shift_dq - (-mid_min);
 		}
 	}
+	scc_mgr_load_all_dq ();
 
 	//USER Move DQS 
 	if (QDRII) {
@@ -7892,11 +8561,11 @@ alt_u32 rw_mgr_mem_calibrate_writes_center (alt_u32 rank_bgn, alt_u32 write_grou
 			mid = 0;
 		}
 		scc_mgr_set_dm_out1_delay(write_group, i, mid);
-		scc_mgr_load_dm (i);
 		if ((left_edge[i] - mid) < dm_margin) {
 			dm_margin = left_edge[i] - mid;
 		}
 	}
+	scc_mgr_load_all_dm ();
 #endif
 
 	// Store observed DM margins
@@ -8111,12 +8780,11 @@ alt_u32 rw_mgr_mem_calibrate_writes_center (alt_u32 rank_bgn, alt_u32 write_grou
 				scc_mgr_set_dm_out1_delay(write_group, i, 0);
 			}
 
-			scc_mgr_load_dm (i);
-
 			if (max_working_dm[i] < dm_margin) {
 				dm_margin = max_working_dm[i];
 			}
 		}
+		scc_mgr_load_all_dm ();
 	} else {
 		dm_margin = 0;
 	}
@@ -8168,7 +8836,7 @@ void rw_mgr_mem_calibrate_eye_diag_aid (void)
 alt_u32 rw_mgr_mem_calibrate_full_test (alt_u32 min_correct, t_btfld *bit_chk, alt_u32 test_dm)
 {
 	alt_u32 g;
-	alt_u32 success = 0;
+	alt_u32 success = 1;
 	alt_u32 run_groups = ~param->skip_groups;
 
 	TRACE_FUNC("%lu %lu", min_correct, test_dm);
@@ -8176,7 +8844,10 @@ alt_u32 rw_mgr_mem_calibrate_full_test (alt_u32 min_correct, t_btfld *bit_chk, a
 	for (g = 0; g < RW_MGR_MEM_IF_READ_DQS_WIDTH; g++) {
 		if (run_groups & ((1 << RW_MGR_NUM_DQS_PER_WRITE_GROUP) - 1))
 		{
-			success = rw_mgr_mem_calibrate_write_test_all_ranks (g, test_dm, PASS_ALL_BITS, bit_chk);
+			//USER Every group has to pass, not just the last one tested
+			if (!rw_mgr_mem_calibrate_write_test_all_ranks (g, test_dm, PASS_ALL_BITS, bit_chk)) {
+				success = 0;
+			}
 		}
 		run_groups = run_groups >> RW_MGR_NUM_DQS_PER_WRITE_GROUP;
 	}
@@ -8184,7 +8855,14 @@ alt_u32 rw_mgr_mem_calibrate_full_test (alt_u32 min_correct, t_btfld *bit_chk, a
 	return success;
 }
 
-#if ENABLE_TCL_DEBUG
+#if ENABLE_MARGIN_EXPORT
+margin_export_t margin_export;
+#define MARGIN_EXPORT_SET(item, value) margin_export.item = (value)
+#else
+#define MARGIN_EXPORT_SET(item, value)
+#endif
+
+#if ENABLE_TCL_DEBUG || ENABLE_MARGIN_EXPORT
 // see how far we can push a particular DQ pin before complete failure on input and output sides
 // NOTE: if ever executing a run_*_margining function outside of calibration context you must first issue IOWR_32DIRECT (PHY_MGR_MUX_SEL, 0, 1);
 void run_dq_margining (alt_u32 rank_bgn, alt_u32 write_group)
@@ -8222,7 +8900,7 @@ void run_dq_margining (alt_u32 rank_bgn, alt_u32 write_group)
 
 			ALTERA_ASSERT(dq < RW_MGR_MEM_DATA_WIDTH);
 
-			calibrated_delay =  debug_cal_report->cal_dq_settings[curr_shadow_reg][dq].dq_in_delay;
+			calibrated_delay = READ_SCC_DQ_IN_DELAY(subdq + read_test_bgn);
 
 			working_cnt = 0;
 
@@ -8265,9 +8943,10 @@ void run_dq_margining (alt_u32 rank_bgn, alt_u32 write_group)
 
 			// Store the setting
 			TCLRPT_SET(debug_margin_report->margin_dq_in_margins[curr_shadow_reg][dq].min_working_setting, working_cnt);
+			MARGIN_EXPORT_SET(dq_in[curr_shadow_reg][dq].left, working_cnt);
 
 			// Find the right edge
-			calibrated_delay = debug_cal_report->cal_dqs_in_settings[curr_shadow_reg][read_group].dqs_bus_in_delay;
+			calibrated_delay = READ_SCC_DQS_IN_DELAY(read_group);
 
 			working_cnt = 0;
 			for (delay = calibrated_delay; delay <= IO_DQS_IN_DELAY_MAX; delay++)
@@ -8306,6 +8985,7 @@ void run_dq_margining (alt_u32 rank_bgn, alt_u32 write_group)
 
 			// Store the setting
 			TCLRPT_SET(debug_margin_report->margin_dq_in_margins[curr_shadow_reg][dq].max_working_setting, working_cnt);
+			MARGIN_EXPORT_SET(dq_in[curr_shadow_reg][dq].right, working_cnt);
 
 		}
 	}
@@ -8315,7 +8995,7 @@ void run_dq_margining (alt_u32 rank_bgn, alt_u32 write_group)
 	{
 		dq = write_group*RW_MGR_MEM_DQ_PER_WRITE_DQS + subdq;
 
-		calibrated_delay = debug_cal_report->cal_dq_settings[curr_shadow_reg][dq].dq_out_delay1;
+		calibrated_delay = READ_SCC_DQ_OUT1_DELAY(subdq);
 		working_cnt = 0;
 
 		// Find the left edge
@@ -8355,9 +9035,10 @@ void run_dq_margining (alt_u32 rank_bgn, alt_u32 write_group)
 
 		// Store the setting
 		TCLRPT_SET(debug_margin_report->margin_dq_out_margins[curr_shadow_reg][dq].min_working_setting, working_cnt);
+		MARGIN_EXPORT_SET(dq_out[curr_shadow_reg][dq].left, working_cnt);
 
 		// Find the right edge
-		calibrated_delay = debug_cal_report->cal_dqs_out_settings[curr_shadow_reg][write_group].dqs_out_delay1;
+		calibrated_delay = READ_SCC_DQS_IO_OUT1_DELAY();
 
 		working_cnt = 0;
 		for (delay = calibrated_delay; delay <= IO_IO_OUT1_DELAY_MAX; delay++)
@@ -8403,11 +9084,12 @@ void run_dq_margining (alt_u32 rank_bgn, alt_u32 write_group)
 
 		// Store the setting
 		TCLRPT_SET(debug_margin_report->margin_dq_out_margins[curr_shadow_reg][dq].max_working_setting, working_cnt);
+		MARGIN_EXPORT_SET(dq_out[curr_shadow_reg][dq].right, working_cnt);
 	}
 }
 #endif
 
-#if ENABLE_TCL_DEBUG
+#if ENABLE_TCL_DEBUG || ENABLE_MARGIN_EXPORT
 // NOTE: if ever executing a run_*_margining function outside of calibration context you must first issue IOWR_32DIRECT (PHY_MGR_MUX_SEL, 0, 1);
 void run_dm_margining (alt_u32 rank_bgn, alt_u32 write_group)
 {
@@ -8427,7 +9109,7 @@ void run_dm_margining (alt_u32 rank_bgn, alt_u32 write_group)
 	for (dm = 0; dm < RW_MGR_NUM_DM_PER_WRITE_GROUP; dm++)
 	{
 
-		calibrated_delay = debug_cal_report->cal_dm_settings[curr_shadow_reg][write_group][dm].dm_out_delay1;
+		calibrated_delay = READ_SCC_DM_IO_OUT1_DELAY(dm);
 		working_cnt = 0;
 
 		// Find the left edge
@@ -8462,9 +9144,10 @@ void run_dm_margining (alt_u32 rank_bgn, alt_u32 write_group)
 
 		// Store the setting
 		TCLRPT_SET(debug_margin_report->margin_dm_margins[curr_shadow_reg][write_group][dm].min_working_setting, working_cnt);
+		MARGIN_EXPORT_SET(dm[curr_shadow_reg][write_group][dm].left, working_cnt);
 
 		// Find the right edge
-		calibrated_delay = debug_cal_report->cal_dqs_out_settings[curr_shadow_reg][write_group].dqs_out_delay1;
+		calibrated_delay = READ_SCC_DQS_IO_OUT1_DELAY();
 
 		working_cnt = 0;
 		for (delay = calibrated_delay; delay <= IO_IO_OUT1_DELAY_MAX; delay++)
@@ -8505,6 +9188,7 @@ void run_dm_margining (alt_u32 rank_bgn, alt_u32 write_group)
 
 		// Store the setting
 		TCLRPT_SET(debug_margin_report->margin_dm_margins[curr_shadow_reg][write_group][dm].max_working_setting, working_cnt);
+		MARGIN_EXPORT_SET(dm[curr_shadow_reg][write_group][dm].right, working_cnt);
 
 	}
 }
@@ -8547,22 +9231,24 @@ void mem_precharge_and_activate (void) {}
 #endif
 
 //USER perform all refreshes necessary over all ranks
-#if (ENABLE_NON_DESTRUCTIVE_CALIB || ENABLE_NON_DES_CAL)
+#if (ENABLE_NON_DESTRUCTIVE_CALIB || ENABLE_NON_DES_CAL || ENABLE_READ_RECENTER)
 // Only have DDR3 version for now
 #if DDR3
 alt_u32 mem_refresh_all_ranks (alt_u32 no_validate)
 {
+#if (ENABLE_NON_DESTRUCTIVE_CALIB)	
 	const alt_u32 T_REFI_NS = 3900;                      // JEDEC spec refresh interval in ns (industrial temp)
+#endif
 //	const alt_u32 T_RFC_NS = 350;                        // Worst case REFRESH-REFRESH or REFRESH-ACTIVATE wait time in ns
 	                                                     // Alternatively, we could extract T_RFC from uniphy_gen.tcl
 	const alt_u32 T_RFC_AFI = 350 * AFI_CLK_FREQ / 1000; // T_RFC expressed in mem clk cycles (will be less than 256)
 #if (ENABLE_NON_DESTRUCTIVE_CALIB)	
 	const alt_u32 NUM_REFRESH_POSTING = 8192;            // Number of consecutive refresh commands supported by Micron DDR3 devices
+	alt_u32 elapsed_time;  // In AVL clock cycles
 #else
 	const alt_u32 NUM_REFRESH_POSTING = 8;  
 #endif
 	alt_u32 i;
-	alt_u32 elapsed_time;  // In AVL clock cycles
 	
 #if (ENABLE_NON_DESTRUCTIVE_CALIB)	
 	//USER Reset the refresh interval timer
@@ -8993,6 +9679,219 @@ void mem_skip_calibrate (void)
 	IOWR_32DIRECT (PHY_MGR_PHY_RLAT, 0, gbl->curr_read_lat);
 }
 
+#if ENABLE_CALIB_CACHE || ENABLE_MARGIN_EXPORT
+//USER CRC-32 of the len bytes at data
+static alt_u32 seq_crc32 (const void *data, alt_u32 len)
+{
+	const alt_u8 *p = (const alt_u8 *) data;
+	alt_u32 crc = 0xFFFFFFFF;
+	alt_u32 i, b;
+
+	for (i = 0; i < len; i++) {
+		crc ^= p[i];
+		for (b = 0; b < 8; b++) {
+			crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+		}
+	}
+	return ~crc;
+}
+#endif
+
+#if ENABLE_CALIB_CACHE
+//USER CRC-32 of a cached result, up to but not including the checksum
+static alt_u32 calib_cache_checksum (const calib_cache_t *cache)
+{
+	return seq_crc32(cache, sizeof(*cache) - sizeof(cache->checksum));
+}
+
+//USER Store the settings calibration settled on at CALIB_CACHE_BASE
+
+void mem_save_calibration (void)
+{
+	calib_cache_t cache;
+	calib_cache_group_t *c;
+	volatile alt_u32 *saved = (volatile alt_u32 *) CALIB_CACHE_BASE;
+	alt_u32 g, i;
+
+	TRACE_FUNC();
+
+	cache.magic = CALIB_CACHE_MAGIC;
+	cache.config = CALIB_CACHE_CONFIG;
+	cache.read_lat = gbl->curr_read_lat;
+	cache.fom_in = gbl->fom_in;
+	cache.fom_out = gbl->fom_out;
+
+	for (g = 0; g < RW_MGR_MEM_IF_WRITE_DQS_WIDTH; g++) {
+		c = &cache.group[g];
+		IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, g);
+
+		c->vfifo = gbl->curr_vfifo[g];
+		c->dqs_en_phase = READ_SCC_DQS_EN_PHASE(g);
+		c->dqs_en_delay = READ_SCC_DQS_EN_DELAY(g);
+		c->dqs_in_delay = READ_SCC_DQS_IN_DELAY(g);
+		c->dqdqs_out_phase = READ_SCC_DQDQS_OUT_PHASE(g);
+		c->oct_out1_delay = READ_SCC_OCT_OUT1_DELAY(g);
+		c->dqs_io_out1_delay = READ_SCC_DQS_IO_OUT1_DELAY();
+		for (i = 0; i < RW_MGR_NUM_DM_PER_WRITE_GROUP; i++) {
+			c->dm_out1_delay[i] = READ_SCC_DM_IO_OUT1_DELAY(i);
+		}
+		for (i = 0; i < RW_MGR_MEM_DQ_PER_WRITE_DQS; i++) {
+			c->dq_in_delay[i] = READ_SCC_DQ_IN_DELAY(i);
+			c->dq_out1_delay[i] = READ_SCC_DQ_OUT1_DELAY(i);
+		}
+	}
+
+	cache.checksum = calib_cache_checksum(&cache);
+	for (i = 0; i < sizeof(cache) / sizeof(alt_u32); i++) {
+		saved[i] = ((alt_u32 *) &cache)[i];
+	}
+}
+
+//USER Apply the settings stored by mem_save_calibration on an earlier boot
+//USER and check them with a full write/read test of every group.  Returns
+//USER 0, with the delay chains still to be zeroed by the caller, if there
+//USER is nothing usable stored or the settings no longer pass.
+
+alt_u32 mem_restore_calibration (void)
+{
+	calib_cache_t cache;
+	const calib_cache_group_t *c;
+	volatile alt_u32 *saved = (volatile alt_u32 *) CALIB_CACHE_BASE;
+	alt_u32 g, i, v;
+	t_btfld bit_chk;
+
+	TRACE_FUNC();
+
+	for (i = 0; i < sizeof(cache) / sizeof(alt_u32); i++) {
+		((alt_u32 *) &cache)[i] = saved[i];
+	}
+	if (cache.magic != CALIB_CACHE_MAGIC || cache.config != CALIB_CACHE_CONFIG ||
+	    cache.checksum != calib_cache_checksum(&cache)) {
+		DPRINT(1, "restore_calibration: nothing stored");
+		return 0;
+	}
+
+	select_shadow_regs_for_update(0, 0, 1);
+
+	for (g = 0; g < RW_MGR_MEM_IF_WRITE_DQS_WIDTH; g++) {
+		c = &cache.group[g];
+
+		scc_mgr_set_dqs_en_phase(g, c->dqs_en_phase);
+		scc_mgr_set_dqs_en_delay(g, c->dqs_en_delay);
+		scc_mgr_set_dqs_bus_in_delay(g, c->dqs_in_delay);
+		scc_mgr_set_dqdqs_output_phase(g, c->dqdqs_out_phase);
+		scc_mgr_set_oct_out1_delay(g, c->oct_out1_delay);
+
+		IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, g);
+		scc_mgr_set_dqs_out1_delay(g, c->dqs_io_out1_delay);
+		for (i = 0; i < RW_MGR_NUM_DM_PER_WRITE_GROUP; i++) {
+			scc_mgr_set_dm_out1_delay(g, i, c->dm_out1_delay[i]);
+		}
+		for (i = 0; i < RW_MGR_MEM_DQ_PER_WRITE_DQS; i++) {
+			scc_mgr_set_dq_in_delay(g, i, c->dq_in_delay[i]);
+			scc_mgr_set_dq_out1_delay(g, i, c->dq_out1_delay[i]);
+		}
+		IOWR_32DIRECT (SCC_MGR_DQ_ENA, 0, 0xff);
+		IOWR_32DIRECT (SCC_MGR_DM_ENA, 0, 0xff);
+		IOWR_32DIRECT (SCC_MGR_DQS_IO_ENA, 0, 0);
+
+		//USER The VFIFO only counts up from where reset left it
+		for (v = gbl->curr_vfifo[g]; v != c->vfifo; v %= VFIFO_SIZE) {
+			rw_mgr_incr_vfifo(g, &v);
+		}
+	}
+	IOWR_32DIRECT (SCC_MGR_DQS_ENA, 0, 0xff);
+	IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
+
+	gbl->curr_read_lat = cache.read_lat;
+	IOWR_32DIRECT (PHY_MGR_PHY_RLAT, 0, gbl->curr_read_lat);
+	IOWR_32DIRECT (PHY_MGR_CMD_FIFO_RESET, 0, 0);
+
+	reg_file_set_stage(CAL_STAGE_FULLTEST);
+	if (!rw_mgr_mem_calibrate_full_test (0, &bit_chk, 0) ||
+	    !rw_mgr_mem_calibrate_full_test (0, &bit_chk, 1)) {
+		DPRINT(1, "restore_calibration: stored settings fail, recalibrating");
+		return 0;
+	}
+
+	gbl->fom_in = cache.fom_in;
+	gbl->fom_out = cache.fom_out;
+	return 1;
+}
+#endif
+
+#if ENABLE_MARGIN_EXPORT
+//USER Start a margin export with nothing measured yet
+
+static void margin_export_start (void)
+{
+	alt_u32 i;
+
+	for (i = 0; i < sizeof(margin_export) / sizeof(alt_u32); i++) {
+		((alt_u32 *) &margin_export)[i] = 0;
+	}
+	margin_export.magic = MARGIN_EXPORT_MAGIC;
+	margin_export.size = sizeof(margin_export);
+	margin_export.tap_ps = IO_DELAY_PER_DCHAIN_TAP;
+	margin_export.shadow_regs = NUM_SHADOW_REGS;
+	margin_export.groups = RW_MGR_MEM_IF_WRITE_DQS_WIDTH;
+	margin_export.dq_per_group = RW_MGR_MEM_DQ_PER_WRITE_DQS;
+	margin_export.dm_per_group = RW_MGR_NUM_TRUE_DM_PER_WRITE_GROUP;
+}
+
+//USER Leave the margins at MARGIN_EXPORT_BASE.  A run that measured none,
+//USER such as one restored from the calibration cache, keeps the last ones.
+
+static void margin_export_save (void)
+{
+	volatile alt_u32 *saved = (volatile alt_u32 *) MARGIN_EXPORT_BASE;
+	alt_u32 sr, i;
+
+	for (sr = 0; sr < NUM_SHADOW_REGS; sr++) {
+		if (margin_export.margined[sr]) {
+			break;
+		}
+	}
+	if (sr == NUM_SHADOW_REGS) {
+		return;
+	}
+
+	margin_export.checksum = seq_crc32(&margin_export, sizeof(margin_export) - sizeof(margin_export.checksum));
+	for (i = 0; i < sizeof(margin_export) / sizeof(alt_u32); i++) {
+		saved[i] = ((alt_u32 *) &margin_export)[i];
+	}
+}
+#endif
+
+#if ENABLE_TRACKING_BASELINE
+//USER Leave the DQS enable settings tracking starts from at
+//USER TRK_BASELINE_BASE, as the SCC manager reads them back.  A failed
+//USER calibration leaves no record.
+
+static void tracking_baseline_save (alt_u32 pass)
+{
+	volatile alt_u32 *saved = (volatile alt_u32 *) TRK_BASELINE_BASE;
+	alt_u32 g, groups;
+
+	saved[0] = 0;
+	if (!pass) {
+		return;
+	}
+
+	groups = RW_MGR_MEM_IF_READ_DQS_WIDTH;
+	if (groups > TRK_BASELINE_MAX_GROUPS) {
+		groups = TRK_BASELINE_MAX_GROUPS;
+	}
+
+	saved[1] = groups;
+	for (g = 0; g < groups; g++) {
+		saved[g + 2] = (IORD_32DIRECT (SCC_MGR_DQS_EN_PHASE, g << 2) << 16) |
+			IORD_32DIRECT (SCC_MGR_DQS_EN_DELAY, g << 2);
+	}
+	saved[0] = TRK_BASELINE_MAGIC;
+}
+#endif
+
 
 #if BFM_MODE
 void print_group_settings(alt_u32 group, alt_u32 dq_begin)
@@ -9142,6 +10041,39 @@ void print_report(alt_u32 pass)
 		RPRINT("Error Group   : %lu", gbl->error_group);
 	}
 }
+
+#if ENABLE_CAL_TIMING
+//USER One line per stage and sub-stage that took any time, with its
+//USER slowest group; the per-group figures are in cal_timing
+void print_timing_report(void)
+{
+	static const char *stage_names[CAL_TIMING_STAGES] = {
+		"NIL", "VFIFO", "WLEVEL", "LFIFO", "WRITES", "FULLTEST",
+		"REFRESH", "SKIPPED", "ABORTED", "READ Fine-tuning"
+	};
+	alt_u32 stage, sub_stage, group, ticks, slowest;
+
+	RPRINT("Calibration Timing: %lu us", cal_timing->total / cal_timing->ticks_per_us);
+	for (stage = 0; stage < CAL_TIMING_STAGES; stage++) {
+		for (sub_stage = 0; sub_stage < CAL_TIMING_SUBSTAGES; sub_stage++) {
+			ticks = 0;
+			slowest = 0;
+			for (group = 0; group < MAX_DQS; group++) {
+				ticks += cal_timing->ticks[stage][sub_stage][group];
+				if (cal_timing->ticks[stage][sub_stage][group] > cal_timing->ticks[stage][sub_stage][slowest]) {
+					slowest = group;
+				}
+			}
+			if (ticks == 0) {
+				continue;
+			}
+			RPRINT("Timing ; %-16s ; Substage %lu ; %6lu us ; Slowest group %lu ; %6lu us",
+			       stage_names[stage], sub_stage, ticks / cal_timing->ticks_per_us,
+			       slowest, cal_timing->ticks[stage][sub_stage][slowest] / cal_timing->ticks_per_us);
+		}
+	}
+}
+#endif
 #endif //RUNTIME_CAL_REPORT
 
 //USER Memory calibration entry point
@@ -9189,6 +10121,10 @@ alt_u32 mem_calibrate (void)
 		//USER Set VFIFO and LFIFO to instant-on settings in skip calibration mode 
 
 		mem_skip_calibrate ();
+#if ENABLE_CALIB_CACHE
+	} else if (mem_restore_calibration ()) {
+		//USER Last boot's settings still pass, nothing to sweep
+#endif
 	} else {
 		for (i = 0; i < NUM_CALIB_REPEAT; i++) {
 		
@@ -9245,7 +10181,7 @@ alt_u32 mem_calibrate (void)
 						if (!rw_mgr_mem_calibrate_vfifo (read_group, read_test_bgn)) {
 							group_failed = 1;
 							
-							if (!(gbl->phy_debug_mode_flags & PHY_DEBUG_SWEEP_ALL_GROUPS)) {
+							if (!(PHY_DEBUG_MODE_FLAGS & PHY_DEBUG_SWEEP_ALL_GROUPS)) {
 								return 0;
 							}
 						}
@@ -9261,7 +10197,7 @@ alt_u32 mem_calibrate (void)
 							if (!rw_mgr_mem_calibrate_wlevel (write_group, write_test_bgn)) {
 								group_failed = 1;
 								
-								if (!(gbl->phy_debug_mode_flags & PHY_DEBUG_SWEEP_ALL_GROUPS)) {
+								if (!(PHY_DEBUG_MODE_FLAGS & PHY_DEBUG_SWEEP_ALL_GROUPS)) {
 									return 0;
 								}
 							}
@@ -9286,7 +10222,7 @@ alt_u32 mem_calibrate (void)
 							
 									if (!rw_mgr_mem_calibrate_writes (rank_bgn, write_group, write_test_bgn)) {
 										sr_failed = 1;
-										if (!(gbl->phy_debug_mode_flags & PHY_DEBUG_SWEEP_ALL_GROUPS)) {
+										if (!(PHY_DEBUG_MODE_FLAGS & PHY_DEBUG_SWEEP_ALL_GROUPS)) {
 											return 0;
 										}
 									}
@@ -9312,7 +10248,7 @@ alt_u32 mem_calibrate (void)
 							if (!rw_mgr_mem_calibrate_vfifo_end (read_group, read_test_bgn)) {
 								group_failed = 1;
 								
-								if (!(gbl->phy_debug_mode_flags & PHY_DEBUG_SWEEP_ALL_GROUPS)) {
+								if (!(PHY_DEBUG_MODE_FLAGS & PHY_DEBUG_SWEEP_ALL_GROUPS)) {
 									return 0;
 								}
 							}
@@ -9336,8 +10272,8 @@ alt_u32 mem_calibrate (void)
 	tclrpt_populate_fake_margin_data();
 #endif
 #else
-#if ENABLE_TCL_DEBUG
-				if (gbl->phy_debug_mode_flags & PHY_DEBUG_ENABLE_MARGIN_RPT)
+#if ENABLE_TCL_DEBUG || ENABLE_MARGIN_EXPORT
+				if (PHY_DEBUG_MODE_FLAGS & PHY_DEBUG_ENABLE_MARGIN_RPT)
 				{
 					// Run margining
 					for (rank_bgn = 0, sr = 0; rank_bgn < RW_MGR_MEM_NUMBER_OF_RANKS; rank_bgn += NUM_RANKS_PER_SHADOW_REG, ++sr) {
@@ -9363,6 +10299,9 @@ alt_u32 mem_calibrate (void)
 								{
 									run_dm_margining(rank_bgn, write_group);
 								}
+#endif
+#if ENABLE_MARGIN_EXPORT
+								margin_export.margined[sr] |= 1 << write_group;
 #endif
 							}
 						}
@@ -9377,7 +10316,7 @@ alt_u32 mem_calibrate (void)
 				}
 
 #if ENABLE_NON_DESTRUCTIVE_CALIB
-				if (gbl->phy_debug_mode_flags & PHY_DEBUG_ENABLE_NON_DESTRUCTIVE_CALIBRATION) {
+				if (PHY_DEBUG_MODE_FLAGS & PHY_DEBUG_ENABLE_NON_DESTRUCTIVE_CALIBRATION) {
 				  // USER Refresh the memory
 				  if (!mem_refresh_all_ranks(0)) {
 					set_failing_group_stage(write_group, CAL_STAGE_REFRESH, CAL_SUBSTAGE_REFRESH);
@@ -9433,6 +10372,12 @@ alt_u32 mem_calibrate (void)
 
 	//USER Do not remove this line as it makes sure all of our decisions have been applied
 	IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
+
+#if ENABLE_CALIB_CACHE
+	if (((DYNAMIC_CALIB_STEPS) & CALIB_SKIP_ALL) != CALIB_SKIP_ALL) {
+		mem_save_calibration ();
+	}
+#endif
 	return 1;
 }
 #if ENABLE_NON_DES_CAL
@@ -9456,6 +10401,13 @@ alt_u32 run_mem_calibrate(void) {
    // Reset pass/fail status shown on afi_cal_success/fail
    IOWR_32DIRECT (PHY_MGR_CAL_STATUS, 0, PHY_MGR_CAL_RESET);
 
+#if ENABLE_CAL_TIMING
+	cal_timing_start();
+#endif
+#if ENABLE_MARGIN_EXPORT
+	margin_export_start();
+#endif
+
    TRACE_FUNC();
 
 	BFM_STAGE("calibrate");
@@ -9477,7 +10429,7 @@ alt_u32 run_mem_calibrate(void) {
     initialize();
 	
 #if ENABLE_NON_DESTRUCTIVE_CALIB
-	if (gbl->phy_debug_mode_flags & PHY_DEBUG_ENABLE_NON_DESTRUCTIVE_CALIBRATION) {
+	if (PHY_DEBUG_MODE_FLAGS & PHY_DEBUG_ENABLE_NON_DESTRUCTIVE_CALIBRATION) {
 		if (no_init) {
 			rw_mgr_mem_initialize_no_init();
 			// refresh is done as part of rw_mgr_mem_initialize_no_init()
@@ -9507,8 +10459,12 @@ alt_u32 run_mem_calibrate(void) {
 
 	pass = mem_calibrate ();
 
+#if ENABLE_MARGIN_EXPORT
+	margin_export_save();
+#endif
+
 #if ENABLE_NON_DESTRUCTIVE_CALIB
-	if( (gbl->phy_debug_mode_flags & PHY_DEBUG_ENABLE_NON_DESTRUCTIVE_CALIBRATION) ) {
+	if( (PHY_DEBUG_MODE_FLAGS & PHY_DEBUG_ENABLE_NON_DESTRUCTIVE_CALIBRATION) ) {
 	  if (!mem_refresh_all_ranks(0)) {
 		set_failing_group_stage(RW_MGR_MEM_IF_WRITE_DQS_WIDTH, CAL_STAGE_REFRESH, CAL_SUBSTAGE_REFRESH);
 		pass = 0;
@@ -9524,6 +10480,10 @@ alt_u32 run_mem_calibrate(void) {
 
 	IOWR_32DIRECT (PHY_MGR_CMD_FIFO_RESET, 0, 0);
 
+#if ENABLE_TRACKING_BASELINE
+	tracking_baseline_save(pass);
+#endif
+
 	if (pass) {
 		TCLRPT_SET(debug_summary_report->error_stage, CAL_STAGE_NIL);
 		
@@ -9563,7 +10523,7 @@ alt_u32 run_mem_calibrate(void) {
 
 
 	//USER Don't return control of the PHY back to AFI when in debug mode
-	if ((gbl->phy_debug_mode_flags & PHY_DEBUG_IN_DEBUG_MODE) == 0) {
+	if ((PHY_DEBUG_MODE_FLAGS & PHY_DEBUG_IN_DEBUG_MODE) == 0) {
 		rw_mgr_mem_handoff ();
 
 #if HARD_PHY
@@ -9644,8 +10604,15 @@ alt_u32 run_mem_calibrate(void) {
 
 	}
 
+#if ENABLE_CAL_TIMING
+	cal_timing_stop();
+#endif
+
 #if RUNTIME_CAL_REPORT
 	print_report(pass);
+#if ENABLE_CAL_TIMING
+	print_timing_report();
+#endif
 #endif
 
 
@@ -9663,6 +10630,194 @@ alt_u32 run_mem_calibrate(void) {
 
 }
 
+#if ENABLE_READ_RECENTER
+#if ENABLE_CALIB_CACHE
+//USER Bring the read settings of the result mem_save_calibration stored up
+//USER to date, so a warm boot restores the recentered eyes.  A cache with
+//USER nothing usable in it is left alone.
+
+static void mem_update_calibration_reads (alt_u32 update_fom)
+{
+	calib_cache_t cache;
+	calib_cache_group_t *c;
+	volatile alt_u32 *saved = (volatile alt_u32 *) CALIB_CACHE_BASE;
+	alt_u32 g, i;
+
+	for (i = 0; i < sizeof(cache) / sizeof(alt_u32); i++) {
+		((alt_u32 *) &cache)[i] = saved[i];
+	}
+	if (cache.magic != CALIB_CACHE_MAGIC || cache.config != CALIB_CACHE_CONFIG ||
+	    cache.checksum != calib_cache_checksum(&cache)) {
+		return;
+	}
+
+	if (update_fom) {
+		cache.fom_in = gbl->fom_in;
+	}
+	for (g = 0; g < RW_MGR_MEM_IF_READ_DQS_WIDTH; g++) {
+		c = &cache.group[g];
+		IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, g);
+
+		c->dqs_in_delay = READ_SCC_DQS_IN_DELAY(g);
+		for (i = 0; i < RW_MGR_MEM_DQ_PER_READ_DQS; i++) {
+			c->dq_in_delay[i] = READ_SCC_DQ_IN_DELAY(i);
+		}
+	}
+
+	cache.checksum = calib_cache_checksum(&cache);
+	for (i = 0; i < sizeof(cache) / sizeof(alt_u32); i++) {
+		saved[i] = ((alt_u32 *) &cache)[i];
+	}
+}
+#endif
+
+//USER Point the activates in the AC ROM, the only ones the RW manager's
+//USER routines issue, at row: the read patterns are written to and read
+//USER from banks 0 and 3 of it.
+
+static void recenter_pattern_row (alt_u32 row)
+{
+	IOWR_32DIRECT (RW_MGR_AC_ROM_WRITE, __RW_MGR_ac_act_0 << 2, __RW_MGR_CONTENT_ac_act_0 | row);
+	IOWR_32DIRECT (RW_MGR_AC_ROM_WRITE, __RW_MGR_ac_act_1 << 2, __RW_MGR_CONTENT_ac_act_1 | row);
+}
+
+//USER Run the read deskew of every group again on memory in use, keeping
+//USER what it holds (see ENABLE_READ_RECENTER).  The read patterns go to
+//USER RECENTER_PATTERN_ROW, and the activates are put back on row 0 after.  The memory has had no
+//USER refresh since the controller let go of the PHY, so it gets one before
+//USER anything else and again before every read test and the handoff.  A
+//USER group whose eyes are not all found again, or whose new settings fail
+//USER the full read test, goes back to the settings it had.  The read FOM
+//USER in the register file is updated when every group recentered.
+//USER Returns 1 if they all did.
+
+alt_u32 sdram_recenter_reads (void)
+{
+#if !ENABLE_DE1_SOC_PROFILE
+	param_t my_param;
+#endif
+	gbl_t my_gbl;
+	alt_u32 g, i, pass;
+	alt_u32 dqs_in, dq_in[RW_MGR_MEM_DQ_PER_READ_DQS];
+	t_btfld bit_chk;
+
+#if !ENABLE_DE1_SOC_PROFILE
+	param = &my_param;
+	for (i = 0; i < RW_MGR_MEM_NUMBER_OF_RANKS; i++) {
+		param->skip_ranks[i] = 0;
+	}
+	for (i = 0; i < NUM_SHADOW_REGS; ++i) {
+		param->skip_shadow_regs[i] = 0;
+	}
+	param->skip_groups = 0;
+	param->read_correct_mask_vg = ((t_btfld)1 << (RW_MGR_MEM_DQ_PER_READ_DQS / RW_MGR_MEM_VIRTUAL_GROUPS_PER_READ_DQS)) - 1;
+	param->read_correct_mask = ((t_btfld)1 << RW_MGR_MEM_DQ_PER_READ_DQS) - 1;
+#endif
+	gbl = &my_gbl;
+	gbl->phy_debug_mode_flags = STATIC_PHY_DEBUG_MODE_FLAGS;
+	gbl->error_stage = CAL_STAGE_NIL;
+	gbl->fom_in = 0;
+	gbl->live_memory = 1;
+#if ENABLE_ADAPTIVE_TEST_COUNT
+	gbl->short_test = 0;
+#endif
+
+	TRACE_FUNC();
+
+	reg_file_set_stage(CAL_STAGE_VFIFO_AFTER_WRITES);
+	reg_file_set_sub_stage(CAL_SUBSTAGE_VFIFO_CENTER);
+
+#if USE_DQS_TRACKING
+#if HHP_HPS
+	//stop tracking manger
+	alt_u32 ctrlcfg = IORD_32DIRECT(CTRL_CONFIG_REG,0);
+
+	IOWR_32DIRECT(CTRL_CONFIG_REG, 0, ctrlcfg & 0xFFBFFFFF); 
+#else
+	// we need to stall tracking
+	IOWR_32DIRECT (TRK_STALL, 0, TRK_STALL_REQ_VAL);
+	// busy wait for tracking manager to ack stall request
+	while (IORD_32DIRECT (TRK_STALL, 0) != TRK_STALL_ACKED_VAL) {
+	}
+#endif
+#endif
+
+	//USER Take the path to memory as initialize() does, but leave the memory
+	//USER and its mode registers as they are
+#if HARD_PHY
+	IOWR_32DIRECT (PHY_MGR_MUX_SEL, 0, 0x3);
+#else
+	IOWR_32DIRECT (PHY_MGR_MUX_SEL, 0, 1);
+#endif
+	recenter_pattern_row(RECENTER_PATTERN_ROW);
+	mem_refresh_all_ranks(1);
+
+	rw_mgr_mem_calibrate_read_load_patterns (0, 1);
+
+	pass = 1;
+	for (g = 0; g < RW_MGR_MEM_IF_READ_DQS_WIDTH; g++) {
+		reg_file_set_group(g);
+		IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, g);
+		select_shadow_regs_for_update(0, g, 1);
+
+		dqs_in = READ_SCC_DQS_IN_DELAY(g);
+		for (i = 0; i < RW_MGR_MEM_DQ_PER_READ_DQS; i++) {
+			dq_in[i] = READ_SCC_DQ_IN_DELAY(i);
+		}
+
+		if (rw_mgr_mem_calibrate_vfifo_center (0, g, g, 0, 1, 1) &&
+		    rw_mgr_mem_calibrate_read_test (0, g, NUM_READ_TESTS, PASS_ALL_BITS, &bit_chk, 0, 0)) {
+			continue;
+		}
+
+		DPRINT(1, "recenter_reads: group %lu keeps its settings", g);
+		scc_mgr_set_dqs_bus_in_delay(g, dqs_in);
+		scc_mgr_load_dqs (g);
+		for (i = 0; i < RW_MGR_MEM_DQ_PER_READ_DQS; i++) {
+			scc_mgr_set_dq_in_delay(g, i, dq_in[i]);
+		}
+		scc_mgr_load_all_dq ();
+		IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
+		pass = 0;
+	}
+
+	//USER Hand the memory back refreshed and with its banks closed, as
+	//USER rw_mgr_mem_handoff leaves them
+	mem_refresh_all_ranks(1);
+	IOWR_32DIRECT (RW_MGR_RUN_SINGLE_GROUP, 0, __RW_MGR_PRECHARGE_ALL);
+	IOWR_32DIRECT (PHY_MGR_CMD_FIFO_RESET, 0, 0);
+	recenter_pattern_row(0);
+	gbl->live_memory = 0;
+
+#if HARD_PHY
+	IOWR_32DIRECT (PHY_MGR_MUX_SEL, 0, 0x2);
+#else
+	IOWR_32DIRECT (PHY_MGR_MUX_SEL, 0, 0);
+#endif
+#if USE_DQS_TRACKING
+#if HHP_HPS
+	IOWR_32DIRECT(CTRL_CONFIG_REG, 0, ctrlcfg); 
+#else
+	// clear tracking stall flags
+	IOWR_32DIRECT (TRK_STALL, 0, 0);
+#endif	
+#endif
+
+	if (pass) {
+		gbl->fom_in /= 2;
+		if (gbl->fom_in > 0xff) {
+			gbl->fom_in = 0xff;
+		}
+		IOWR_32DIRECT (REG_FILE_FOM, 0, (IORD_32DIRECT (REG_FILE_FOM, 0) & 0xFFFFFF00) | gbl->fom_in);
+	}
+#if ENABLE_CALIB_CACHE
+	mem_update_calibration_reads (pass);
+#endif
+
+	return pass;
+}
+#endif
+
 #if HCX_COMPAT_MODE || ENABLE_INST_ROM_WRITE
 void hc_initialize_rom_data(void)
 {
@@ -10526,32 +11681,34 @@ int sdram_calibration(void)
 int main(void)
 #endif
 {
+#if !ENABLE_DE1_SOC_PROFILE
 	param_t my_param;
+#endif
 	gbl_t my_gbl;
 	alt_u32 pass;
+#if !ENABLE_DE1_SOC_PROFILE || ENABLE_CALIB_CACHE
 	alt_u32 i;
+#endif
 
+#if !ENABLE_DE1_SOC_PROFILE
 	param = &my_param;
+#endif
 	gbl = &my_gbl;
 
-	// Initialize the debug mode flags
-	gbl->phy_debug_mode_flags = 0;
-	// Set the calibration enabled by default
-	gbl->phy_debug_mode_flags |= PHY_DEBUG_ENABLE_CAL_RPT;
-	// Only enable margining by default if requested
-#if ENABLE_MARGIN_REPORT_GEN
-	gbl->phy_debug_mode_flags |= PHY_DEBUG_ENABLE_MARGIN_RPT;
-#endif
-	// Only sweep all groups (regardless of fail state) by default if requested 
-#if ENABLE_SWEEP_ALL_GROUPS
-	gbl->phy_debug_mode_flags |= PHY_DEBUG_SWEEP_ALL_GROUPS;
+#if ENABLE_CALIB_CACHE
+	// The VFIFOs come out of reset at zero
+	for (i = 0; i < RW_MGR_MEM_IF_READ_DQS_WIDTH; i++) {
+		gbl->curr_vfifo[i] = 0;
+	}
 #endif
-	//Set enabled read test by default
-#if DISABLE_GUARANTEED_READ
-	gbl->phy_debug_mode_flags |= PHY_DEBUG_DISABLE_GUARANTEED_READ;
+
+	// Initialize the debug mode flags
+	gbl->phy_debug_mode_flags = STATIC_PHY_DEBUG_MODE_FLAGS;
+#if ENABLE_READ_RECENTER
+	gbl->live_memory = 0;
 #endif
-#if ENABLE_NON_DESTRUCTIVE_CALIB
-	gbl->phy_debug_mode_flags |= PHY_DEBUG_ENABLE_NON_DESTRUCTIVE_CALIBRATION;
+#if ENABLE_ADAPTIVE_TEST_COUNT
+	gbl->short_test = 0;
 #endif
 
 #if BFM_MODE
@@ -10580,7 +11737,11 @@ int main(void)
 #if ENABLE_TCL_DEBUG
 	tclrpt_initialize(&my_debug_data);
 #endif
+#if ENABLE_PRINTF_LOG && !BFM_MODE
+	trace_ring_start();
+#endif
 
+#if !ENABLE_DE1_SOC_PROFILE
    // USER Enable all ranks, groups
    for (i = 0; i < RW_MGR_MEM_NUMBER_OF_RANKS; i++) {
 		param->skip_ranks[i] = 0;
@@ -10589,6 +11750,7 @@ int main(void)
 		param->skip_shadow_regs[i] = 0;
 	}
 	param->skip_groups = 0;
+#endif
 
 	IPRINT("Preparing to start memory calibration");
 
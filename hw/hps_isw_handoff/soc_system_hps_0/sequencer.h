@@ -122,11 +122,155 @@ extern void err_report_internal_error (const char* description, const char* modu
 
 #define NUM_CALIB_REPEAT	1
 
+//USER Keep the calibration result across warm boots and try it before
+//USER sweeping (see mem_restore_calibration).  CALIB_CACHE_BASE must point
+//USER at sizeof(calib_cache_t) bytes of on-chip RAM that survive a warm
+//USER reset and that nothing else uses: not the preloader's image, heap,
+//USER global data or stack, nor the boot ROM's workspace.  The top of
+//USER on-chip RAM holds the stack, so there is no default: the board
+//USER defines it in the room it reserves, with CALIB_CACHE_SIZE (this
+//USER board's is in sdram_io.h).
+#ifndef ENABLE_CALIB_CACHE
+#define ENABLE_CALIB_CACHE	0
+#endif
+
+//USER Measure the read and write margins of every pin after a group
+//USER calibrates (run_dq_margining, run_dm_margining) and leave them at
+//USER MARGIN_EXPORT_BASE, as a margin_export_t, for the OS to read after
+//USER boot.  This adds a full tap sweep per pin to the boot time.  Like
+//USER CALIB_CACHE_BASE, MARGIN_EXPORT_BASE has no default: it must be on-chip
+//USER RAM the board reserves for the record, clear of the preloader's stack,
+//USER and the board defines it with MARGIN_EXPORT_SIZE.
+#ifndef ENABLE_MARGIN_EXPORT
+#define ENABLE_MARGIN_EXPORT	0
+#endif
+
+//USER Leave the DQS enable settings each group calibrated to at
+//USER TRK_BASELINE_BASE, so the OS can see how far DQS tracking has moved
+//USER them since (see TRK_BASELINE_MAGIC and sw/ddr_tracking.c).  The
+//USER register file's defined words end at 0x3C, so the record goes in
+//USER on-chip RAM the board reserves for it, and like CALIB_CACHE_BASE,
+//USER TRK_BASELINE_BASE has no default: the board defines it, with
+//USER TRK_BASELINE_SIZE, and gives it to the OS in its device tree.
+#ifndef ENABLE_TRACKING_BASELINE
+#define ENABLE_TRACKING_BASELINE	0
+#endif
+
+//USER Time each calibration stage, sub-stage and group into cal_timing
+//USER (see cal_timing_t).  CAL_TIMESTAMP() is the counter it reads; where
+//USER none is provided every time reads as 0.
+#ifndef ENABLE_CAL_TIMING
+#define ENABLE_CAL_TIMING	0
+#endif
+#ifndef CAL_TIMESTAMP
+#define CAL_TIMESTAMP_INIT()
+#define CAL_TIMESTAMP()		0
+#define CAL_TIMESTAMP_TICKS_PER_US	1
+#endif
+
 #define NUM_READ_TESTS			7
 #define NUM_READ_PB_TESTS		7
 #define NUM_WRITE_TESTS			15
 #define NUM_WRITE_PB_TESTS		31
 
+//USER Find the per-bit window edges of the read and write deskew by testing
+//USER every COARSE_EDGE_SEARCH_STEP taps and bisecting the taps either side
+//USER of each edge, instead of testing every tap (see
+//USER rw_mgr_mem_calibrate_find_edges).  The edges found are the same as long
+//USER as every bit passes over a single run of taps at least a step wide.
+#ifndef ENABLE_COARSE_EDGE_SEARCH
+#define ENABLE_COARSE_EDGE_SEARCH	0
+#endif
+#ifndef COARSE_EDGE_SEARCH_STEP
+#define COARSE_EDGE_SEARCH_STEP		4
+#endif
+
+//USER With ENABLE_COARSE_EDGE_SEARCH, run the tests at the coarse and the
+//USER bisected taps short, looping SHORT_READ_TEST_LOOPS or
+//USER SHORT_WRITE_TEST_LOOPS times where the read and write tests loop 0x32
+//USER and 0x40 times.  A short test misses more of the failures of a tap near
+//USER an edge than a full one, so every edge a short test found is tested
+//USER again at full length, and stepped in a tap at a time until it passes,
+//USER before it is kept.  Those full tests come on top of the short ones,
+//USER so this runs more tests than the coarse search alone, and more than
+//USER testing every tap: what it saves is the time the memory spends on
+//USER them (on the host model, a sixth more tests for 3% less memory time).
+#ifndef ENABLE_ADAPTIVE_TEST_COUNT
+#define ENABLE_ADAPTIVE_TEST_COUNT	0
+#endif
+#ifndef SHORT_READ_TEST_LOOPS
+#define SHORT_READ_TEST_LOOPS		0x06
+#endif
+#ifndef SHORT_WRITE_TEST_LOOPS
+#define SHORT_WRITE_TEST_LOOPS		0x08
+#endif
+
+//USER Build for nothing but the interface sequencer_defines.h describes, the
+//USER DE1-SoC's single-rank full-rate DDR3 on the Cyclone V hard PHY.  The
+//USER calibration steps, debug mode flags, correct masks and rank, group and
+//USER shadow register skips become constants (see DYNAMIC_CALIB_STEPS,
+//USER PHY_DEBUG_MODE_FLAGS and param), so the compiler folds the loops over
+//USER them and drops the paths they rule out.
+#ifndef ENABLE_DE1_SOC_PROFILE
+#define ENABLE_DE1_SOC_PROFILE	0
+#endif
+
+//USER Provide sdram_recenter_reads, which runs the read deskew of every
+//USER group again on memory that is in use, as temperature moves the read
+//USER eyes over a long uptime.  It leaves the memory's contents alone: no
+//USER reset or mode register writes, the banks refreshed before every read
+//USER test, and writes only where the read patterns live (banks 0 and 3 of
+//USER RECENTER_PATTERN_ROW, which the OS must keep out of use).  Only the
+//USER service is provided, validated on the host model: no board in this
+//USER tree has a caller for it or reserves the row, so none can build it.
+//USER A caller runs it from on-chip RAM while nothing else uses the SDRAM,
+//USER e.g. on a suspend path, since the PHY is the sequencer's until it
+//USER returns.
+#ifndef ENABLE_READ_RECENTER
+#define ENABLE_READ_RECENTER	0
+#endif
+
+//USER RECENTER_PATTERN_ROW is the row the read patterns are written to
+//USER while recentering.  Calibration at boot uses row 0, which the OS owns
+//USER by the time recentering runs.  There is no default: a board defines
+//USER it once its device tree keeps the row from the OS.  With the
+//USER controller's chip-row-bank-column address order, banks 0 and 3 of the
+//USER DE1-SoC's last row, 0x7FFF, are 0x3FFF8000-0x3FFFBFFF.
+
+//USER Leave the DPRINT and IPRINT messages in trace_ring as binary events
+//USER (see trace_ring_t) for a reader to format later, instead of formatting
+//USER them here.  Calibration never waits for the reader: an event that
+//USER finds the ring full is counted as dropped.  Without ENABLE_TCL_DEBUG
+//USER the ring is at TRACE_RING_BASE, where the OS can read it after boot.
+//USER The ring takes (6 + TRACE_RING_WORDS) * 4 bytes, over 4 KB, so as with
+//USER CALIB_CACHE_BASE there is no default: the board reserves on-chip RAM
+//USER for it clear of the preloader's stack and defines its address and
+//USER TRACE_RING_SIZE.
+//USER A calibration leaves about 150 events up to TRACE_LEVEL 1, which fit,
+//USER and over 5000 at level 2, which only a reader draining the ring as
+//USER calibration runs will see all of.
+#ifndef ENABLE_PRINTF_LOG
+#define ENABLE_PRINTF_LOG	0
+#endif
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL		1
+#endif
+#ifndef TRACE_RING_WORDS
+#define TRACE_RING_WORDS	1024	// a power of two
+#endif
+#ifndef TRACE_BARRIER
+#define TRACE_BARRIER()		asm volatile ("" : : : "memory")
+#endif
+
+//USER With ENABLE_TCL_DEBUG, answer the TCLDBG_CAL_STATUS and TCLDBG_QUERY_*
+//USER commands in the response block of debug_batch_t, and take up to
+//USER TCLDBG_BATCH_ENTRIES commands at a time there with TCLDBG_RUN_BATCH,
+//USER so a reader pulls the settings and margins of every pin in a few
+//USER mailbox round trips instead of one per pin.
+#ifndef ENABLE_TCL_BATCH
+#define ENABLE_TCL_BATCH	0
+#endif
+
 #define PASS_ALL_BITS			1
 #define PASS_ONE_BIT			0
 
@@ -229,6 +373,13 @@ extern void err_report_internal_error (const char* description, const char* modu
 #define TRK_STALL_ACKED_VAL    (0x80000000 | TRK_STALL_REQ_VAL)
 #endif // HHP_HPS
 
+//USER The record ENABLE_TRACKING_BASELINE leaves at TRK_BASELINE_BASE of
+//USER the DQS enable settings calibration handed to tracking:
+//USER TRK_BASELINE_MAGIC, the number of groups, then (phase << 16) | delay
+//USER for each group
+#define TRK_BASELINE_MAGIC		0x314b5254	// "TRK1"
+#define TRK_BASELINE_MAX_GROUPS		8
+
 /* PHY manager configuration registers. */
 
 #define PHY_MGR_PHY_RLAT				(BASE_PHY_MGR + 0x4000)
@@ -608,8 +759,179 @@ typedef struct gbl_type {
 	alt_u32 rw_wl_nop_cycles_per_group[RW_MGR_MEM_IF_WRITE_DQS_WIDTH];
 #endif
 	alt_u32 rw_wl_nop_cycles;
+
+#if ENABLE_CALIB_CACHE
+	//USER VFIFO position of each group, counted from reset
+	alt_u32 curr_vfifo[RW_MGR_MEM_IF_READ_DQS_WIDTH];
+#endif
+
+#if ENABLE_READ_RECENTER
+	//USER The memory holds data: refresh it before every read test
+	alt_u32 live_memory;
+#endif
+
+#if ENABLE_ADAPTIVE_TEST_COUNT
+	//USER Run the read and write tests short (see ENABLE_ADAPTIVE_TEST_COUNT)
+	alt_u32 short_test;
+#endif
 } gbl_t;
 
+#if ENABLE_DE1_SOC_PROFILE
+#if !DDR3 || !FULL_RATE || !HARD_PHY || !CYCLONEV || RW_MGR_MEM_NUMBER_OF_RANKS != 1
+#error "the DE1-SoC profile is for a single-rank full-rate DDR3 on the Cyclone V hard PHY"
+#endif
+#if ENABLE_TCL_DEBUG || BFM_MODE
+#error "the DE1-SoC profile fixes the settings the TCL debug interface and the BFM change"
+#endif
+#endif
+
+#if ENABLE_READ_RECENTER
+#ifndef RECENTER_PATTERN_ROW
+#error "read recentering needs RECENTER_PATTERN_ROW, a row this board keeps from the OS"
+#endif
+#if !DDR3 || RW_MGR_MEM_IF_READ_DQS_WIDTH != RW_MGR_MEM_IF_WRITE_DQS_WIDTH || NUM_SHADOW_REGS > 1
+#error "read recentering refreshes DDR3 only and assumes one read group per write group and one shadow register set"
+#endif
+#if !(HCX_COMPAT_MODE || ENABLE_INST_ROM_WRITE) || RECENTER_PATTERN_ROW >= (1 << RW_MGR_MEM_ADDRESS_WIDTH)
+#error "read recentering rewrites the activates in the AC ROM to open RECENTER_PATTERN_ROW, which must be a row of the memory"
+#endif
+#endif
+
+#if ENABLE_ADAPTIVE_TEST_COUNT && !ENABLE_COARSE_EDGE_SEARCH
+#error "the adaptive test count shortens the tests at the coarse edge search's taps"
+#endif
+
+#if ENABLE_CALIB_CACHE
+#if RW_MGR_MEM_IF_READ_DQS_WIDTH != RW_MGR_MEM_IF_WRITE_DQS_WIDTH
+#error "the calibration cache assumes one read group per write group"
+#endif
+
+#define CALIB_CACHE_MAGIC	0x31434c43	// "CLC1"
+
+//USER The interface a cached result belongs to
+#define CALIB_CACHE_CONFIG \
+	((RW_MGR_MEM_IF_WRITE_DQS_WIDTH << 24) | (RW_MGR_MEM_DQ_PER_WRITE_DQS << 16) | AFI_CLK_FREQ)
+
+/* settings of one group, as the SCC register file holds them */
+
+typedef struct calib_cache_group_type {
+	alt_u8 vfifo;
+	alt_u8 dqs_en_phase;
+	alt_u8 dqs_en_delay;
+	alt_u8 dqs_in_delay;
+	alt_u8 dqdqs_out_phase;
+	alt_u8 oct_out1_delay;
+	alt_u8 dqs_io_out1_delay;
+	alt_u8 dm_out1_delay[RW_MGR_NUM_DM_PER_WRITE_GROUP];
+	alt_u8 dq_in_delay[RW_MGR_MEM_DQ_PER_READ_DQS];
+	alt_u8 dq_out1_delay[RW_MGR_MEM_DQ_PER_WRITE_DQS];
+} calib_cache_group_t;
+
+/* a calibration result kept at CALIB_CACHE_BASE; the checksum is last */
+
+typedef struct calib_cache_type {
+	alt_u32 magic;
+	alt_u32 config;
+	alt_u32 read_lat;
+	alt_u32 fom_in;
+	alt_u32 fom_out;
+	calib_cache_group_t group[RW_MGR_MEM_IF_WRITE_DQS_WIDTH];
+	alt_u32 checksum;
+} calib_cache_t;
+#endif
+
+#if ENABLE_MARGIN_EXPORT
+#define MARGIN_EXPORT_MAGIC	0x3147524d	// "MRG1"
+
+/* how many taps past its calibrated setting a pin still passes: left by
+   delaying the pin, right by delaying its DQS (min_working_setting and
+   max_working_setting of the margin report) */
+
+typedef struct margin_export_pin_type {
+	alt_u8 left;
+	alt_u8 right;
+} margin_export_pin_t;
+
+/* the margins of the last calibration that measured any, kept at
+   MARGIN_EXPORT_BASE.  The header says how many of everything follow, so
+   that a reader needs no sequencer_defines.h: dq_in, then dq_out, then dm,
+   each shadow register set in turn, with the checksum (CRC-32 of all the
+   bytes before it) in the last word of size bytes. */
+
+typedef struct margin_export_type {
+	alt_u32 magic;
+	alt_u16 size;
+	alt_u16 tap_ps;				// IO_DELAY_PER_DCHAIN_TAP
+	alt_u8 shadow_regs;
+	alt_u8 groups;
+	alt_u8 dq_per_group;
+	alt_u8 dm_per_group;
+	alt_u32 margined[NUM_SHADOW_REGS];	// write groups measured, by bit
+	margin_export_pin_t dq_in[NUM_SHADOW_REGS][RW_MGR_MEM_DATA_WIDTH];
+	margin_export_pin_t dq_out[NUM_SHADOW_REGS][RW_MGR_MEM_DATA_WIDTH];
+	margin_export_pin_t dm[NUM_SHADOW_REGS][RW_MGR_MEM_IF_WRITE_DQS_WIDTH][RW_MGR_NUM_TRUE_DM_PER_WRITE_GROUP];
+	alt_u32 checksum;
+} margin_export_t;
+#endif
+
+#if ENABLE_CAL_TIMING
+#define CAL_TIMING_STAGES	10	// CAL_STAGE_NIL to CAL_STAGE_VFIFO_AFTER_WRITES
+#define CAL_TIMING_SUBSTAGES	4	// CAL_SUBSTAGE_NIL to 3
+
+/* Where the time of the last run_mem_calibrate() went, in CAL_TIMESTAMP()
+   ticks.  Each interval is charged to the stage, sub-stage and group that
+   REG_FILE_CUR_STAGE showed during it, so work done between groups (read
+   latency, the full test) is charged to the last group set. */
+
+typedef struct cal_timing_type {
+	alt_u32 data_size;
+	alt_u32 ticks_per_us;
+	alt_u32 total;
+	alt_u32 ticks[CAL_TIMING_STAGES][CAL_TIMING_SUBSTAGES][MAX_DQS];
+} cal_timing_t;
+
+extern cal_timing_t *cal_timing;
+#endif
+
+#if ENABLE_PRINTF_LOG
+/* An event is TRACE_EVENT_WORDS words, then one word per argument, each
+   cast to alt_u32.  Strings, fmt among them, are offsets from
+   TRACE_STRING_BASE, which the board defines, into the sequencer's image,
+   so a reader formats fmt with the image's strings at hand.  Without a
+   TRACE_STRING_BASE they are pointers, which must then fit an alt_u32. */
+
+#define TRACE_EVENT_WORDS	3	// info, time (CAL_TIMESTAMP()), fmt
+#define TRACE_EVENT_NARGS(info)	((info) & 0xff)
+#define TRACE_EVENT_LEVEL(info)	(((info) >> 8) & 0xff)
+#define TRACE_EVENT_INFO	0x10000	// IPRINT, not DPRINT
+
+/* Single producer, single consumer: only the sequencer moves head, only
+   the reader moves tail.  Both count words since the ring was started and
+   index buf modulo words; the reader is behind by head - tail words. */
+
+typedef struct trace_ring_type {
+	alt_u32 data_size;
+	alt_u32 words;
+	alt_u32 ticks_per_us;
+	alt_u32 head;
+	alt_u32 tail;
+	alt_u32 dropped;
+	alt_u32 buf[TRACE_RING_WORDS];
+} trace_ring_t;
+
+extern volatile trace_ring_t *trace_ring;
+
+#ifdef TRACE_STRING_BASE
+#define TRACE_STRING(s)		((alt_u32)((s) - (const char *)(TRACE_STRING_BASE)))
+#define TRACE_STRING_AT(w)	((const char *)(TRACE_STRING_BASE) + (int)(w))
+#elif __SIZEOF_POINTER__ > 4
+#error "the trace ring's strings need TRACE_STRING_BASE where pointers are wider than 32 bits"
+#else
+#define TRACE_STRING(s)		((alt_u32)(s))
+#define TRACE_STRING_AT(w)	((const char *)(w))
+#endif
+#endif
+
 // External global variables
 extern gbl_t *gbl;
 extern param_t *param;
@@ -640,9 +962,14 @@ extern void scc_mgr_set_dqdqs_output_phase_all_ranks (alt_u32 write_group, alt_u
 extern inline void scc_mgr_set_dm_out1_delay (alt_u32 write_group, alt_u32 dm, alt_u32 delay);
 extern inline void scc_mgr_set_dm_out2_delay (alt_u32 write_group, alt_u32 dm, alt_u32 delay);
 extern inline void scc_mgr_load_dm (alt_u32 dm);
+extern void scc_mgr_load_all_dq (void);
+extern void scc_mgr_load_all_dm (void);
 extern void rw_mgr_incr_vfifo_auto(alt_u32 grp);
 extern void rw_mgr_decr_vfifo_auto(alt_u32 grp);
 #if HPS_HW
 extern int sdram_calibration(void);
 #endif
+#if ENABLE_READ_RECENTER
+extern alt_u32 sdram_recenter_reads(void);
+#endif
 #endif
@@ -49,7 +49,6 @@
 volatile debug_summary_report_t *debug_summary_report;
 volatile debug_cal_report_t *debug_cal_report;
 volatile debug_margin_report_t *debug_margin_report;
-volatile debug_printf_output_t *debug_printf_output;
 volatile debug_data_t *debug_data;
 
 volatile emif_toolkit_debug_data_t *debug_emif_toolkit_debug_data;
@@ -363,17 +362,6 @@ void tclrpt_initialize_calib_latency(void)
 
 }
 
-void tclrpt_initialize_printf_output(void)
-{
-	// Initialize the pointers
-	debug_printf_output->head = 0;
-	debug_printf_output->count = 0;
-	debug_printf_output->slave_lock = 0;
-	debug_printf_output->master_lock = 0;
-	debug_printf_output->fifo_size = PRINTF_READ_BUFFER_FIFO_WORDS;
-	debug_printf_output->word_size = PRINTF_READ_BUFFER_SIZE;
-}
-
 void tclrpt_initialize_emif_toolkit_debug_data(void)
 {
 	// Initialize the points to the calibration data
@@ -519,7 +507,6 @@ void tclrpt_initialize (debug_data_t *debug_data_ptr)
 		debug_summary_report = 0;
 		debug_cal_report = 0;
 		debug_margin_report = 0;
-		debug_printf_output = 0;
 
 		debug_data = 0;
 	}
@@ -535,11 +522,6 @@ void tclrpt_initialize (debug_data_t *debug_data_ptr)
 		debug_summary_report = &(debug_data->summary_report);
 		debug_cal_report = &(debug_data->cal_report);
 		debug_margin_report = &(debug_data->margin_report);
-#if ENABLE_PRINTF_LOG
-		debug_printf_output = &(debug_data->printf_output);
-#else
-		debug_printf_output = 0;
-#endif
 		debug_emif_toolkit_debug_data = &(debug_data->emif_toolkit_debug_data);
 
 
@@ -555,6 +537,16 @@ void tclrpt_initialize (debug_data_t *debug_data_ptr)
 		debug_data->di_report_ptr = (alt_u32)(&debug_data->di_report);
 #endif
 		debug_data->emif_toolkit_debug_data_ptr = (alt_u32)(&debug_data->emif_toolkit_debug_data);
+#if ENABLE_CAL_TIMING
+		debug_data->cal_timing_ptr = (alt_u32)(&debug_data->cal_timing);
+		debug_data->cal_timing.data_size = sizeof(cal_timing_t);
+#endif
+#if ENABLE_TCL_BATCH
+		debug_data->batch_ptr = (alt_u32)(&debug_data->batch);
+		debug_data->batch.data_size = sizeof(debug_batch_t);
+		debug_data->batch.entries_run = 0;
+		debug_data->batch.response_words = 0;
+#endif
 
 		// Set the sizes of the structs
 		debug_data->data_size = sizeof(debug_data_t);
@@ -584,12 +576,9 @@ void tclrpt_initialize (debug_data_t *debug_data_ptr)
 		}
 
 #if ENABLE_PRINTF_LOG
-		// Initialize the size and pointers
-		debug_data->printf_output_ptr = (alt_u32)debug_printf_output;
-		debug_printf_output->data_size = sizeof(debug_printf_output_t);
-
-		// Initialize the payload
-		tclrpt_initialize_printf_output();
+		// The ring itself is started by trace_ring_start()
+		debug_data->printf_output_ptr = (alt_u32)(&debug_data->printf_output);
+		debug_data->printf_output.data_size = sizeof(trace_ring_t);
 #else
 		debug_data->printf_output_ptr = (alt_u32)0;
 #endif
@@ -635,11 +624,567 @@ void tclrpt_mark_interface_as_illegal_command(void)
 	debug_data->command_status = TCLDBG_TX_STATUS_ILLEGAL_CMD;
 }
 
+#if ENABLE_TCL_BATCH
+// Append an answer to the response block.  There is always room for
+// TCLDBG_MAX_RESPONSE_WORDS: a command sent alone answers from the start
+// of the block, and a batch stops before a command that might not fit.
+static void tclrpt_respond(volatile void *data, alt_u32 size)
+{
+	volatile alt_u32 *words = data;
+	alt_u32 i;
+
+	for (i = 0; i < size / sizeof(alt_u32); i++)
+	{
+		debug_data->batch.response[debug_data->batch.response_words++] = words[i];
+	}
+}
+#endif
+
+// Set by TCLDBG_SET_UPDATE_PARAMETERS to end tclrpt_loop
+static alt_u32 rdimm_control_word_updated;
+
+// Run one command and return the TCLDBG_TX_STATUS_* it answers with, or
+// TCLDBG_TX_STATUS_CMD_READY for TCLDBG_CMD_WAIT_CMD, which answers nothing
+static alt_u32 tclrpt_execute(alt_u32 command, volatile alt_u32 *parameters)
+{
+	alt_u32 rank, status;
+#if ENABLE_DELAY_CHAIN_WRITE || ENABLE_TCL_BATCH
+	alt_u32 group, pin;
+#endif
+#if ENABLE_DELAY_CHAIN_WRITE
+	alt_u32 pin_in_group, value;
+#endif
+#if ENABLE_TCL_BATCH
+	alt_u32 sr;
+#endif
+
+	switch (command)
+	{
+		case TCLDBG_SET_UPDATE_PARAMETERS :
+			rdimm_control_word_updated = 1;
+			status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			break;
+		case TCLDBG_CMD_WAIT_CMD :
+			//wait for commands
+			status = TCLDBG_TX_STATUS_CMD_READY;
+			break;
+		case TCLDBG_CMD_NOP : //NOOP command
+			// Perform no operation
+			status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			break;
+		case TCLDBG_RUN_MEM_CALIBRATE :
+			// Run the full memory calibration
+#if ENABLE_NON_DES_CAL					
+			run_mem_calibrate(0);
+#else
+			run_mem_calibrate();
+#endif
+			status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			break;
+		case TCLDBG_RUN_NON_DES_MEM_CALIBRATE :
+			// Run the full memory calibration
+#if ENABLE_NON_DES_CAL					
+			run_mem_calibrate(1);
+#else
+			run_mem_calibrate();
+#endif
+			status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			break;
+
+		case TCLDBG_RUN_EYE_DIAGRAM_PATTERN :
+			// Generate the pattern to view eye diagrams
+			// This function never returns
+			status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			break;
+		case TCLDBG_MARK_ALL_DQS_GROUPS_AS_VALID :
+			// Mark all groups as being valid for calibration
+			param->skip_groups = 0;
+			tclrpt_update_rank_group_mask();
+			status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			break;
+		case TCLDBG_MARK_GROUP_AS_SKIP :
+			// Mark the specified group as being skipped for calibration
+
+			// Make sure it is a legal group
+			if (parameters[0] < RW_MGR_MEM_IF_WRITE_DQS_WIDTH) {
+				param->skip_groups |= 1 << parameters[0];
+
+				tclrpt_update_rank_group_mask();
+				status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			}
+			else {
+				// Illegal payload detected
+				status = TCLDBG_TX_STATUS_ILLEGAL_CMD;
+			}
+
+			break;
+		case TCLDBG_MARK_ALL_RANKS_AS_VALID :
+			// Mark all ranks as being valid for calibration
+			for (rank = 0; rank < RW_MGR_MEM_NUMBER_OF_RANKS; rank++)
+			{
+				param->skip_ranks[rank] = 0;
+			}
+			tclrpt_update_rank_group_mask();
+			status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			break;
+		case TCLDBG_MARK_RANK_AS_SKIP :
+			// Make sure it is a legal group
+			if (parameters[0] < RW_MGR_MEM_NUMBER_OF_RANKS) {
+				param->skip_ranks[parameters[0]] = 1;
+
+				tclrpt_update_rank_group_mask();
+				status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			}
+			else {
+				// Illegal payload detected
+				status = TCLDBG_TX_STATUS_ILLEGAL_CMD;
+			}
+
+			break;
+		case TCLDBG_ENABLE_MARGIN_REPORT :
+			gbl->phy_debug_mode_flags |= PHY_DEBUG_ENABLE_MARGIN_RPT;
+			status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			break;
+		case TCLDBG_ENABLE_SWEEP_ALL_GROUPS :
+			gbl->phy_debug_mode_flags |= PHY_DEBUG_SWEEP_ALL_GROUPS;
+			status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			break;
+		case TCLDBG_DISABLE_GUARANTEED_READ :
+			gbl->phy_debug_mode_flags |= PHY_DEBUG_DISABLE_GUARANTEED_READ;
+			status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			break;
+		case TCLDBG_SET_NON_DESTRUCTIVE_CALIBRATION:
+		  if (parameters[0]) {
+			gbl->phy_debug_mode_flags |= PHY_DEBUG_ENABLE_NON_DESTRUCTIVE_CALIBRATION;
+		  } else {
+			gbl->phy_debug_mode_flags &= ~(PHY_DEBUG_ENABLE_NON_DESTRUCTIVE_CALIBRATION);
+		  }
+		  status = TCLDBG_TX_STATUS_RESPONSE_READY;
+		  break;
+		#if ENABLE_DELAY_CHAIN_WRITE
+		case TCLDBG_SET_DQ_D1_DELAY :
+			// DQ D1 Delay (I/O buffer to input register)
+			pin = parameters[0];
+			value = parameters[1];
+			group = pin/RW_MGR_MEM_DQ_PER_READ_DQS;
+			pin_in_group = pin%RW_MGR_MEM_DQ_PER_READ_DQS;
+
+			// Make sure parameter values are legal
+			if (pin < RW_MGR_MEM_DATA_WIDTH && value <= IO_IO_IN_DELAY_MAX) {
+				IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, group);
+				scc_mgr_set_dq_in_delay(group, pin_in_group, value);
+				scc_mgr_load_dq (pin_in_group);
+				IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
+				status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			} else {
+				status = TCLDBG_TX_STATUS_ILLEGAL_CMD;
+			}
+			break;
+		case TCLDBG_SET_DQ_D5_DELAY :
+			// DQ D5 Delay (output register to I/O buffer)
+			pin = parameters[0];
+			value = parameters[1];
+			group = pin/RW_MGR_MEM_DQ_PER_WRITE_DQS;
+			pin_in_group = pin%RW_MGR_MEM_DQ_PER_WRITE_DQS;
+
+			// Make sure parameter values are legal
+			if (pin < RW_MGR_MEM_DATA_WIDTH && value <= IO_IO_OUT1_DELAY_MAX) {
+				IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, group);
+				scc_mgr_set_dq_out1_delay(group, pin_in_group, value);
+				scc_mgr_load_dq (pin_in_group);
+				IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
+				status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			} else {
+				status = TCLDBG_TX_STATUS_ILLEGAL_CMD;
+			}
+			break;
+		case TCLDBG_SET_DQ_D6_DELAY :
+			// DQ D6 Delay (output register to I/O buffer)
+			pin = parameters[0];
+			value = parameters[1];
+			group = pin/RW_MGR_MEM_DQ_PER_WRITE_DQS;
+			pin_in_group = pin%RW_MGR_MEM_DQ_PER_WRITE_DQS;
+
+			// Make sure parameter values are legal
+			if (pin < RW_MGR_MEM_DATA_WIDTH && value <= IO_IO_OUT2_DELAY_MAX) {
+				IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, group);
+				scc_mgr_set_dq_out2_delay(group, pin_in_group, value);
+				scc_mgr_load_dq (pin_in_group);
+				IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
+				status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			} else {
+				status = TCLDBG_TX_STATUS_ILLEGAL_CMD;
+			}
+			break;
+		case TCLDBG_SET_DQS_D4_DELAY :
+			// DQS D4 Delay (DQS delay chain)
+			group = parameters[0];
+			value = parameters[1];
+
+			// Make sure parameter values are legal
+			if (group < RW_MGR_MEM_IF_READ_DQS_WIDTH && value <= IO_DQS_IN_DELAY_MAX) {
+				IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, group);
+				scc_mgr_set_dqs_bus_in_delay(group, value);
+				scc_mgr_load_dqs (group);
+				IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
+				status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			} else {
+				status = TCLDBG_TX_STATUS_ILLEGAL_CMD;
+			}
+			break;
+		case TCLDBG_SET_DQDQS_OUTPUT_PHASE :
+			// DQS DQ Output Phase (deg) = DQS Output Phase (deg) - 90
+			group = parameters[0];
+			value = parameters[1];
+
+			// Make sure parameter values are legal
+			if (group < RW_MGR_MEM_IF_READ_DQS_WIDTH && value <= IO_DQDQS_OUT_PHASE_MAX) {
+				IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, group);
+				scc_mgr_set_dqdqs_output_phase_all_ranks (group, value);
+				status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			} else {
+				status = TCLDBG_TX_STATUS_ILLEGAL_CMD;
+			}
+			break;
+		case TCLDBG_SET_DQS_D5_DELAY :
+			// DQS D5 Delay (output register to I/O buffer) = D5 OCT Delay (OCT to I/O buffer)
+			group = parameters[0];
+			value = parameters[1];
+
+			// Make sure parameter values are legal
+			if (group < RW_MGR_MEM_IF_READ_DQS_WIDTH && value <= IO_IO_OUT1_DELAY_MAX) {
+				IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, group);
+				scc_mgr_set_group_dqs_io_and_oct_out1_gradual (group, value);
+				status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			} else {
+				status = TCLDBG_TX_STATUS_ILLEGAL_CMD;
+			}
+			break;
+		case TCLDBG_SET_DQS_D6_DELAY :
+			// DQS D6 Delay (output register to I/O buffer) = D6 OCT Delay (OCT to I/O buffer)
+			group = parameters[0];
+			value = parameters[1];
+
+			// Make sure parameter values are legal
+			if (group < RW_MGR_MEM_IF_READ_DQS_WIDTH && value <= IO_IO_OUT2_DELAY_MAX) {
+				IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, group);
+				scc_mgr_set_group_dqs_io_and_oct_out2_gradual (group, value);
+				status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			} else {
+				status = TCLDBG_TX_STATUS_ILLEGAL_CMD;
+			}
+			break;
+		case TCLDBG_SET_DQS_EN_PHASE :
+			// DQS Enable Phase (deg)
+			group = parameters[0];
+			value = parameters[1];
+
+			// Make sure parameter values are legal
+			if (group < RW_MGR_MEM_IF_READ_DQS_WIDTH && value <= IO_DQS_EN_PHASE_MAX) {
+				IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, group);
+				scc_mgr_set_dqs_en_phase_all_ranks (group, value);
+				status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			} else {
+				status = TCLDBG_TX_STATUS_ILLEGAL_CMD;
+			}
+			break;
+		case TCLDBG_SET_DQS_T11_DELAY :
+			// DQS T11 Delay (DQS post-amble delay)
+			group = parameters[0];
+			value = parameters[1];
+
+			// Make sure parameter values are legal
+			if (group < RW_MGR_MEM_IF_READ_DQS_WIDTH && value <= IO_DQS_EN_DELAY_MAX) {
+				IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, group);
+				scc_mgr_set_dqs_en_delay_all_ranks (group, value);
+				status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			} else {
+				status = TCLDBG_TX_STATUS_ILLEGAL_CMD;
+			}
+			break;
+		case TCLDBG_SET_DM_D5_DELAY :
+			// DM D5 OCT Delay (OCT to I/O buffer)
+			group = parameters[0];
+			pin_in_group = parameters[1];
+			value = parameters[2];
+
+			// Make sure parameter values are legal
+			if (group < RW_MGR_MEM_IF_WRITE_DQS_WIDTH && pin_in_group < RW_MGR_NUM_DM_PER_WRITE_GROUP && value <= IO_IO_OUT1_DELAY_MAX) {
+				IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, group);
+				scc_mgr_set_dm_out1_delay(group, pin_in_group, value);
+				scc_mgr_load_dm (pin_in_group);
+				IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
+				status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			} else {
+				status = TCLDBG_TX_STATUS_ILLEGAL_CMD;
+			}
+			break;
+		case TCLDBG_SET_DM_D6_DELAY :
+			// DM D6 OCT Delay (OCT to I/O buffer)
+			group = parameters[0];
+			pin_in_group = parameters[1];
+			value = parameters[2];
+
+			// Make sure parameter values are legal
+			if (group < RW_MGR_MEM_IF_WRITE_DQS_WIDTH && pin_in_group < RW_MGR_NUM_DM_PER_WRITE_GROUP && value <= IO_IO_OUT2_DELAY_MAX) {
+				IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, group);
+				scc_mgr_set_dm_out2_delay(group, pin_in_group, value);
+				scc_mgr_load_dm (pin_in_group);
+				IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
+				status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			} else {
+				status = TCLDBG_TX_STATUS_ILLEGAL_CMD;
+			}
+			break;
+		case TCLDBG_REMARGIN_DQ :
+			rank = parameters[0];
+			group = parameters[1];
+			// Pre-margining process
+			initialize();
+			rw_mgr_mem_initialize ();
+			mem_config ();
+			
+			IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, group);
+			run_dq_margining(rank, group);
+			
+			// Post-margining process
+			rw_mgr_mem_handoff ();
+			IOWR_32DIRECT (PHY_MGR_MUX_SEL, 0, 0); // Give control back to user logic.
+			status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			break;
+		case TCLDBG_REMARGIN_DM :
+			rank = parameters[0];
+			group = parameters[1];
+			// Pre-margining process
+			initialize();
+			rw_mgr_mem_initialize ();
+			mem_config ();
+			
+			IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, group);
+			run_dm_margining(rank, group);
+			
+			// Post-margining process
+			rw_mgr_mem_handoff ();
+			IOWR_32DIRECT (PHY_MGR_MUX_SEL, 0, 0); // Give control back to user logic.
+			status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			break;
+		case TCLDBG_INCR_VFIFO :
+			// Increment the VFIFO by 1 step
+			group = parameters[0];
+
+			// Make sure parameter values are legal
+			if (group < RW_MGR_MEM_IF_READ_DQS_WIDTH) {
+				rw_mgr_incr_vfifo_auto(group);
+				status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			} else {
+				status = TCLDBG_TX_STATUS_ILLEGAL_CMD;
+			}
+			break;
+		case TCLDBG_DECR_VFIFO :
+			// Decrement the VFIFO by 1 step
+			group = parameters[0];
+
+			// Make sure parameter values are legal
+			if (group < RW_MGR_MEM_IF_READ_DQS_WIDTH) {
+				rw_mgr_decr_vfifo_auto(group);
+				status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			} else {
+				status = TCLDBG_TX_STATUS_ILLEGAL_CMD;
+			}
+			break;
+		case TCLDBG_SELECT_SHADOW_REG :
+			rank = parameters[0];
+			if (rank < RW_MGR_MEM_NUMBER_OF_RANKS) {
+				select_shadow_regs_for_update (rank, 0, 1);
+				status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			} else {
+				status = TCLDBG_TX_STATUS_ILLEGAL_CMD;
+			}
+			break;
+		#endif // ENABLE_DELAY_CHAIN_WRITE
+#if ENABLE_TCL_BATCH
+		case TCLDBG_CAL_STATUS :
+			// Calibration status of a write group in a shadow register
+			group = parameters[0];
+			sr = parameters[1];
+
+			// Make sure parameter values are legal
+			if (group < RW_MGR_MEM_IF_WRITE_DQS_WIDTH && sr < NUM_SHADOW_REGS) {
+				tclrpt_respond(&debug_cal_report->cal_status_per_group[sr][group], sizeof(debug_cal_status_per_group_t));
+				status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			} else {
+				status = TCLDBG_TX_STATUS_ILLEGAL_CMD;
+			}
+			break;
+		case TCLDBG_QUERY_CALIB_MARGINS :
+			// Input then output margins of a DQ pin in a shadow register
+			pin = parameters[0];
+			sr = parameters[1];
+
+			// Make sure parameter values are legal
+			if (pin < RW_MGR_MEM_DATA_WIDTH && sr < NUM_SHADOW_REGS) {
+				tclrpt_respond(&debug_cal_report->cal_dq_in_margins[sr][pin], sizeof(debug_cal_observed_dq_margins_t));
+				tclrpt_respond(&debug_cal_report->cal_dq_out_margins[sr][pin], sizeof(debug_cal_observed_dq_margins_t));
+				status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			} else {
+				status = TCLDBG_TX_STATUS_ILLEGAL_CMD;
+			}
+			break;
+		case TCLDBG_QUERY_DQ_SETTINGS :
+			// Settings of a DQ pin in a shadow register
+			pin = parameters[0];
+			sr = parameters[1];
+
+			// Make sure parameter values are legal
+			if (pin < RW_MGR_MEM_DATA_WIDTH && sr < NUM_SHADOW_REGS) {
+				tclrpt_respond(&debug_cal_report->cal_dq_settings[sr][pin], sizeof(debug_cal_dq_settings_t));
+				status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			} else {
+				status = TCLDBG_TX_STATUS_ILLEGAL_CMD;
+			}
+			break;
+		case TCLDBG_QUERY_DQS_SETTINGS :
+			// Input settings of a read group, then output settings of
+			// its write group, in a shadow register
+			group = parameters[0];
+			sr = parameters[1];
+
+			// Make sure parameter values are legal
+			if (group < RW_MGR_MEM_IF_READ_DQS_WIDTH && sr < NUM_SHADOW_REGS) {
+				tclrpt_respond(&debug_cal_report->cal_dqs_in_settings[sr][group], sizeof(debug_cal_dqs_in_settings_t));
+				tclrpt_respond(&debug_cal_report->cal_dqs_out_settings[sr][group / (RW_MGR_MEM_IF_READ_DQS_WIDTH / RW_MGR_MEM_IF_WRITE_DQS_WIDTH)], sizeof(debug_cal_dqs_out_settings_t));
+				status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			} else {
+				status = TCLDBG_TX_STATUS_ILLEGAL_CMD;
+			}
+			break;
+		case TCLDBG_QUERY_DM_SETTINGS :
+			// Settings of every DM pin of a write group in a shadow register
+			group = parameters[0];
+			sr = parameters[1];
+
+			// Make sure parameter values are legal
+			if (group < RW_MGR_MEM_IF_WRITE_DQS_WIDTH && sr < NUM_SHADOW_REGS) {
+				tclrpt_respond(debug_cal_report->cal_dm_settings[sr][group], sizeof(debug_cal_dm_settings_t) * RW_MGR_NUM_TRUE_DM_PER_WRITE_GROUP);
+				status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			} else {
+				status = TCLDBG_TX_STATUS_ILLEGAL_CMD;
+			}
+			break;
+		case TCLDBG_QUERY_PHY_USER_DEBUG_MODE :
+			tclrpt_respond(&gbl->phy_debug_mode_flags, sizeof(alt_u32));
+			status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			break;
+		case TCLDBG_QUERY_GROUP_AS_SKIP :
+			tclrpt_respond(&param->skip_groups, sizeof(alt_u32));
+			status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			break;
+		case TCLDBG_QUERY_RANK_AS_SKIP :
+			tclrpt_respond(param->skip_ranks, sizeof(alt_u32) * RW_MGR_MEM_NUMBER_OF_RANKS);
+			status = TCLDBG_TX_STATUS_RESPONSE_READY;
+			break;
+#endif // ENABLE_TCL_BATCH
+		default :
+			// Illegal command
+			status = TCLDBG_TX_STATUS_ILLEGAL_CMD;
+			break;
+	}
+
+	return status;
+}
+
+#if ENABLE_TCL_BATCH
+// Run the first count commands of the batch, stopping early when the
+// response block might not hold the next one's answer
+static alt_u32 tclrpt_run_batch(alt_u32 count)
+{
+	volatile debug_batch_entry_t *entry;
+	alt_u32 i;
+
+	if (count > TCLDBG_BATCH_ENTRIES)
+	{
+		return TCLDBG_TX_STATUS_ILLEGAL_CMD;
+	}
+
+	debug_data->batch.response_words = 0;
+	for (i = 0; i < count; i++)
+	{
+		if (debug_data->batch.response_words + TCLDBG_MAX_RESPONSE_WORDS > TCLDBG_BATCH_RESPONSE_WORDS)
+		{
+			break;
+		}
+
+		entry = &debug_data->batch.entry[i];
+		entry->response_offset = debug_data->batch.response_words;
+
+		// A batch cannot wait for commands or hold another batch
+		if (entry->command == TCLDBG_CMD_WAIT_CMD || entry->command == TCLDBG_RUN_BATCH)
+		{
+			entry->status = TCLDBG_TX_STATUS_ILLEGAL_CMD;
+		}
+		else
+		{
+			entry->status = tclrpt_execute(entry->command, entry->parameters);
+		}
+		entry->response_words = debug_data->batch.response_words - entry->response_offset;
+	}
+	debug_data->batch.entries_run = i;
+
+	return TCLDBG_TX_STATUS_RESPONSE_READY;
+}
+#endif
+
+// Answer the mailbox once: take the host's acknowledgement of the last
+// response, or run the command it has written.  Returns non-zero once
+// TCLDBG_SET_UPDATE_PARAMETERS has asked for tclrpt_loop to end.
+alt_u32 tclrpt_poll(void)
+{
+	alt_u32 command, status;
+
+	if (debug_data->command_status == TCLDBG_TX_STATUS_RESPONSE_READY
+			|| debug_data->command_status == TCLDBG_TX_STATUS_ILLEGAL_CMD)
+		switch (debug_data->requested_command)
+		{
+			case TCLDBG_CMD_RESPONSE_ACK :
+				// The TCL interface has read the response
+				// Since the TCL interface has read the response we can mark the interface
+				// As being ready to accept another command
+				tclrpt_mark_interface_as_ready();
+				break;
+		}
+	else if (debug_data->command_status == TCLDBG_TX_STATUS_CMD_READY)
+	{
+		command = debug_data->requested_command;
+#if ENABLE_TCL_BATCH
+		if (command == TCLDBG_RUN_BATCH)
+		{
+			// The entries' status shows how far the batch has got
+			debug_data->command_status = TCLDBG_TX_STATUS_CMD_EXE;
+			status = tclrpt_run_batch(debug_data->command_parameters[0]);
+		}
+		else
+		{
+			debug_data->batch.response_words = 0;
+			status = tclrpt_execute(command, debug_data->command_parameters);
+		}
+#else
+		status = tclrpt_execute(command, debug_data->command_parameters);
+#endif
+
+		if (status != TCLDBG_TX_STATUS_CMD_READY)
+		{
+			// The response must be in place before the status says so
+			TRACE_BARRIER();
+			debug_data->command_status = status;
+		}
+	}
+
+	return rdimm_control_word_updated;
+}
+
 #if !HPS_HW
 void tclrpt_loop(void)
 {
-	alt_u32 rank, group, pin, pin_in_group, value;
-	alt_u32 rdimm_control_word_updated;
 	rdimm_control_word_updated = 0;	
 	// Set up the interface to be ready for access. The initial state is user mode.
 	tclrpt_mark_interface_as_ready();
@@ -657,369 +1202,8 @@ void tclrpt_loop(void)
 	    // AIDIL: Yes since debug is turned on by default, not having this means deep
 	    // powerdown would stall controller
 		user_init_cal_req();
-	    
-		if (debug_data->command_status == TCLDBG_TX_STATUS_RESPONSE_READY
-				|| debug_data->command_status == TCLDBG_TX_STATUS_ILLEGAL_CMD)
-			switch (debug_data->requested_command)
-			{
-				case TCLDBG_CMD_RESPONSE_ACK :
-					// The TCL interface has read the response
-					// Since the TCL interface has read the response we can mark the interface
-					// As being ready to accept another command
-					tclrpt_mark_interface_as_ready();
-					break;
-			}
-		else if (debug_data->command_status == TCLDBG_TX_STATUS_CMD_READY)
-		{
-			switch (debug_data->requested_command)
-			{
-				case TCLDBG_SET_UPDATE_PARAMETERS :
-					rdimm_control_word_updated = 1;
-					tclrpt_mark_interface_as_response_ready();
-					break;
-				case TCLDBG_CMD_WAIT_CMD :
-					//wait for commands
-					break;
-				case TCLDBG_CMD_NOP : //NOOP command
-					// Perform no operation
-					tclrpt_mark_interface_as_response_ready();
-					break;
-				case TCLDBG_RUN_MEM_CALIBRATE :
-					// Run the full memory calibration
-#if ENABLE_NON_DES_CAL					
-					run_mem_calibrate(0);
-#else
-					run_mem_calibrate();
-#endif
-					tclrpt_mark_interface_as_response_ready();
-					break;
-				case TCLDBG_RUN_NON_DES_MEM_CALIBRATE :
-					// Run the full memory calibration
-#if ENABLE_NON_DES_CAL					
-					run_mem_calibrate(1);
-#else
-					run_mem_calibrate();
-#endif
-					tclrpt_mark_interface_as_response_ready();
-					break;
-
-				case TCLDBG_RUN_EYE_DIAGRAM_PATTERN :
-					// Generate the pattern to view eye diagrams
-					// This function never returns
-					tclrpt_mark_interface_as_response_ready();
-					break;
-				case TCLDBG_MARK_ALL_DQS_GROUPS_AS_VALID :
-					// Mark all groups as being valid for calibration
-					param->skip_groups = 0;
-					tclrpt_update_rank_group_mask();
-					tclrpt_mark_interface_as_response_ready();
-					break;
-				case TCLDBG_MARK_GROUP_AS_SKIP :
-					// Mark the specified group as being skipped for calibration
-
-					// Make sure it is a legal group
-					if (debug_data->command_parameters[0] < RW_MGR_MEM_IF_WRITE_DQS_WIDTH) {
-						param->skip_groups |= 1 << debug_data->command_parameters[0];
-
-						tclrpt_update_rank_group_mask();
-						tclrpt_mark_interface_as_response_ready();
-					}
-					else {
-						// Illegal payload detected
-						tclrpt_mark_interface_as_illegal_command();
-					}
-
-					break;
-				case TCLDBG_MARK_ALL_RANKS_AS_VALID :
-					// Mark all ranks as being valid for calibration
-					for (rank = 0; rank < RW_MGR_MEM_NUMBER_OF_RANKS; rank++)
-					{
-						param->skip_ranks[rank] = 0;
-					}
-					tclrpt_update_rank_group_mask();
-					tclrpt_mark_interface_as_response_ready();
-					break;
-				case TCLDBG_MARK_RANK_AS_SKIP :
-					// Make sure it is a legal group
-					if (debug_data->command_parameters[0] < RW_MGR_MEM_NUMBER_OF_RANKS) {
-						param->skip_ranks[debug_data->command_parameters[0]] = 1;
-
-						tclrpt_update_rank_group_mask();
-						tclrpt_mark_interface_as_response_ready();
-					}
-					else {
-						// Illegal payload detected
-						tclrpt_mark_interface_as_illegal_command();
-					}
-
-					break;
-				case TCLDBG_ENABLE_MARGIN_REPORT :
-					gbl->phy_debug_mode_flags |= PHY_DEBUG_ENABLE_MARGIN_RPT;
-					tclrpt_mark_interface_as_response_ready();
-					break;
-				case TCLDBG_ENABLE_SWEEP_ALL_GROUPS :
-					gbl->phy_debug_mode_flags |= PHY_DEBUG_SWEEP_ALL_GROUPS;
-					tclrpt_mark_interface_as_response_ready();
-					break;
-				case TCLDBG_DISABLE_GUARANTEED_READ :
-					gbl->phy_debug_mode_flags |= PHY_DEBUG_DISABLE_GUARANTEED_READ;
-					tclrpt_mark_interface_as_response_ready();
-					break;
-				case TCLDBG_SET_NON_DESTRUCTIVE_CALIBRATION:
-				  if (debug_data->command_parameters[0]) {
-					gbl->phy_debug_mode_flags |= PHY_DEBUG_ENABLE_NON_DESTRUCTIVE_CALIBRATION;
-				  } else {
-					gbl->phy_debug_mode_flags &= ~(PHY_DEBUG_ENABLE_NON_DESTRUCTIVE_CALIBRATION);
-				  }
-				  tclrpt_mark_interface_as_response_ready();
-				  break;
-				#if ENABLE_DELAY_CHAIN_WRITE
-				case TCLDBG_SET_DQ_D1_DELAY :
-					// DQ D1 Delay (I/O buffer to input register)
-					pin = debug_data->command_parameters[0];
-					value = debug_data->command_parameters[1];
-					group = pin/RW_MGR_MEM_DQ_PER_READ_DQS;
-					pin_in_group = pin%RW_MGR_MEM_DQ_PER_READ_DQS;
-
-					// Make sure parameter values are legal
-					if (pin < RW_MGR_MEM_DATA_WIDTH && value <= IO_IO_IN_DELAY_MAX) {
-						IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, group);
-						scc_mgr_set_dq_in_delay(group, pin_in_group, value);
-						scc_mgr_load_dq (pin_in_group);
-						IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
-						tclrpt_mark_interface_as_response_ready();
-					} else {
-						tclrpt_mark_interface_as_illegal_command();
-					}
-					break;
-				case TCLDBG_SET_DQ_D5_DELAY :
-					// DQ D5 Delay (output register to I/O buffer)
-					pin = debug_data->command_parameters[0];
-					value = debug_data->command_parameters[1];
-					group = pin/RW_MGR_MEM_DQ_PER_WRITE_DQS;
-					pin_in_group = pin%RW_MGR_MEM_DQ_PER_WRITE_DQS;
-
-					// Make sure parameter values are legal
-					if (pin < RW_MGR_MEM_DATA_WIDTH && value <= IO_IO_OUT1_DELAY_MAX) {
-						IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, group);
-						scc_mgr_set_dq_out1_delay(group, pin_in_group, value);
-						scc_mgr_load_dq (pin_in_group);
-						IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
-						tclrpt_mark_interface_as_response_ready();
-					} else {
-						tclrpt_mark_interface_as_illegal_command();
-					}
-					break;
-				case TCLDBG_SET_DQ_D6_DELAY :
-					// DQ D6 Delay (output register to I/O buffer)
-					pin = debug_data->command_parameters[0];
-					value = debug_data->command_parameters[1];
-					group = pin/RW_MGR_MEM_DQ_PER_WRITE_DQS;
-					pin_in_group = pin%RW_MGR_MEM_DQ_PER_WRITE_DQS;
-
-					// Make sure parameter values are legal
-					if (pin < RW_MGR_MEM_DATA_WIDTH && value <= IO_IO_OUT2_DELAY_MAX) {
-						IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, group);
-						scc_mgr_set_dq_out2_delay(group, pin_in_group, value);
-						scc_mgr_load_dq (pin_in_group);
-						IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
-						tclrpt_mark_interface_as_response_ready();
-					} else {
-						tclrpt_mark_interface_as_illegal_command();
-					}
-					break;
-				case TCLDBG_SET_DQS_D4_DELAY :
-					// DQS D4 Delay (DQS delay chain)
-					group = debug_data->command_parameters[0];
-					value = debug_data->command_parameters[1];
-
-					// Make sure parameter values are legal
-					if (group < RW_MGR_MEM_IF_READ_DQS_WIDTH && value <= IO_DQS_IN_DELAY_MAX) {
-						IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, group);
-						scc_mgr_set_dqs_bus_in_delay(group, value);
-						scc_mgr_load_dqs (group);
-						IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
-						tclrpt_mark_interface_as_response_ready();
-					} else {
-						tclrpt_mark_interface_as_illegal_command();
-					}
-					break;
-				case TCLDBG_SET_DQDQS_OUTPUT_PHASE :
-					// DQS DQ Output Phase (deg) = DQS Output Phase (deg) - 90
-					group = debug_data->command_parameters[0];
-					value = debug_data->command_parameters[1];
-
-					// Make sure parameter values are legal
-					if (group < RW_MGR_MEM_IF_READ_DQS_WIDTH && value <= IO_DQDQS_OUT_PHASE_MAX) {
-						IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, group);
-						scc_mgr_set_dqdqs_output_phase_all_ranks (group, value);
-						tclrpt_mark_interface_as_response_ready();
-					} else {
-						tclrpt_mark_interface_as_illegal_command();
-					}
-					break;
-				case TCLDBG_SET_DQS_D5_DELAY :
-					// DQS D5 Delay (output register to I/O buffer) = D5 OCT Delay (OCT to I/O buffer)
-					group = debug_data->command_parameters[0];
-					value = debug_data->command_parameters[1];
-
-					// Make sure parameter values are legal
-					if (group < RW_MGR_MEM_IF_READ_DQS_WIDTH && value <= IO_IO_OUT1_DELAY_MAX) {
-						IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, group);
-						scc_mgr_set_group_dqs_io_and_oct_out1_gradual (group, value);
-						tclrpt_mark_interface_as_response_ready();
-					} else {
-						tclrpt_mark_interface_as_illegal_command();
-					}
-					break;
-				case TCLDBG_SET_DQS_D6_DELAY :
-					// DQS D6 Delay (output register to I/O buffer) = D6 OCT Delay (OCT to I/O buffer)
-					group = debug_data->command_parameters[0];
-					value = debug_data->command_parameters[1];
-
-					// Make sure parameter values are legal
-					if (group < RW_MGR_MEM_IF_READ_DQS_WIDTH && value <= IO_IO_OUT2_DELAY_MAX) {
-						IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, group);
-						scc_mgr_set_group_dqs_io_and_oct_out2_gradual (group, value);
-						tclrpt_mark_interface_as_response_ready();
-					} else {
-						tclrpt_mark_interface_as_illegal_command();
-					}
-					break;
-				case TCLDBG_SET_DQS_EN_PHASE :
-					// DQS Enable Phase (deg)
-					group = debug_data->command_parameters[0];
-					value = debug_data->command_parameters[1];
-
-					// Make sure parameter values are legal
-					if (group < RW_MGR_MEM_IF_READ_DQS_WIDTH && value <= IO_DQS_EN_PHASE_MAX) {
-						IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, group);
-						scc_mgr_set_dqs_en_phase_all_ranks (group, value);
-						tclrpt_mark_interface_as_response_ready();
-					} else {
-						tclrpt_mark_interface_as_illegal_command();
-					}
-					break;
-				case TCLDBG_SET_DQS_T11_DELAY :
-					// DQS T11 Delay (DQS post-amble delay)
-					group = debug_data->command_parameters[0];
-					value = debug_data->command_parameters[1];
-
-					// Make sure parameter values are legal
-					if (group < RW_MGR_MEM_IF_READ_DQS_WIDTH && value <= IO_DQS_EN_DELAY_MAX) {
-						IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, group);
-						scc_mgr_set_dqs_en_delay_all_ranks (group, value);
-						tclrpt_mark_interface_as_response_ready();
-					} else {
-						tclrpt_mark_interface_as_illegal_command();
-					}
-					break;
-				case TCLDBG_SET_DM_D5_DELAY :
-					// DM D5 OCT Delay (OCT to I/O buffer)
-					group = debug_data->command_parameters[0];
-					pin_in_group = debug_data->command_parameters[1];
-					value = debug_data->command_parameters[2];
-
-					// Make sure parameter values are legal
-					if (group < RW_MGR_MEM_IF_WRITE_DQS_WIDTH && pin_in_group < RW_MGR_NUM_DM_PER_WRITE_GROUP && value <= IO_IO_OUT1_DELAY_MAX) {
-						IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, group);
-						scc_mgr_set_dm_out1_delay(group, pin_in_group, value);
-						scc_mgr_load_dm (pin_in_group);
-						IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
-						tclrpt_mark_interface_as_response_ready();
-					} else {
-						tclrpt_mark_interface_as_illegal_command();
-					}
-					break;
-				case TCLDBG_SET_DM_D6_DELAY :
-					// DM D6 OCT Delay (OCT to I/O buffer)
-					group = debug_data->command_parameters[0];
-					pin_in_group = debug_data->command_parameters[1];
-					value = debug_data->command_parameters[2];
-
-					// Make sure parameter values are legal
-					if (group < RW_MGR_MEM_IF_WRITE_DQS_WIDTH && pin_in_group < RW_MGR_NUM_DM_PER_WRITE_GROUP && value <= IO_IO_OUT2_DELAY_MAX) {
-						IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, group);
-						scc_mgr_set_dm_out2_delay(group, pin_in_group, value);
-						scc_mgr_load_dm (pin_in_group);
-						IOWR_32DIRECT (SCC_MGR_UPD, 0, 0);
-						tclrpt_mark_interface_as_response_ready();
-					} else {
-						tclrpt_mark_interface_as_illegal_command();
-					}
-					break;
-				case TCLDBG_REMARGIN_DQ :
-					rank = debug_data->command_parameters[0];
-					group = debug_data->command_parameters[1];
-					// Pre-margining process
-					initialize();
-					rw_mgr_mem_initialize ();
-					mem_config ();
-					
-					IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, group);
-					run_dq_margining(rank, group);
-					
-					// Post-margining process
-					rw_mgr_mem_handoff ();
-					IOWR_32DIRECT (PHY_MGR_MUX_SEL, 0, 0); // Give control back to user logic.
-					tclrpt_mark_interface_as_response_ready();
-					break;
-				case TCLDBG_REMARGIN_DM :
-					rank = debug_data->command_parameters[0];
-					group = debug_data->command_parameters[1];
-					// Pre-margining process
-					initialize();
-					rw_mgr_mem_initialize ();
-					mem_config ();
-					
-					IOWR_32DIRECT (SCC_MGR_GROUP_COUNTER, 0, group);
-					run_dm_margining(rank, group);
-					
-					// Post-margining process
-					rw_mgr_mem_handoff ();
-					IOWR_32DIRECT (PHY_MGR_MUX_SEL, 0, 0); // Give control back to user logic.
-					tclrpt_mark_interface_as_response_ready();
-					break;
-				case TCLDBG_INCR_VFIFO :
-					// Increment the VFIFO by 1 step
-					group = debug_data->command_parameters[0];
-
-					// Make sure parameter values are legal
-					if (group < RW_MGR_MEM_IF_READ_DQS_WIDTH) {
-						rw_mgr_incr_vfifo_auto(group);
-						tclrpt_mark_interface_as_response_ready();
-					} else {
-						tclrpt_mark_interface_as_illegal_command();
-					}
-					break;
-				case TCLDBG_DECR_VFIFO :
-					// Decrement the VFIFO by 1 step
-					group = debug_data->command_parameters[0];
-
-					// Make sure parameter values are legal
-					if (group < RW_MGR_MEM_IF_READ_DQS_WIDTH) {
-						rw_mgr_decr_vfifo_auto(group);
-						tclrpt_mark_interface_as_response_ready();
-					} else {
-						tclrpt_mark_interface_as_illegal_command();
-					}
-					break;
-				case TCLDBG_SELECT_SHADOW_REG :
-					rank = debug_data->command_parameters[0];
-					if (rank < RW_MGR_MEM_NUMBER_OF_RANKS) {
-						select_shadow_regs_for_update (rank, 0, 1);
-						tclrpt_mark_interface_as_response_ready();
-					} else {
-						tclrpt_mark_interface_as_illegal_command();
-					}
-					break;
-				#endif // ENABLE_DELAY_CHAIN_WRITE
-				default :
-					// Illegal command
-					tclrpt_mark_interface_as_illegal_command();
-					break;
-			}
-		}
+
+		tclrpt_poll();
 	}
 }
 #endif
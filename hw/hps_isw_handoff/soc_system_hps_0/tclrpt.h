@@ -41,9 +41,6 @@
 // set (although it's not a problem if it is, but this helps catch errors)
 #if ENABLE_TCL_DEBUG
 
-#define PRINTF_READ_BUFFER_SIZE 128/4
-#define PRINTF_READ_BUFFER_FIFO_WORDS 32
-
 #define NUM_DI_SAMPLE 100
 
 #define DI_REPORT_FLAGS_READY 0x00000001
@@ -187,6 +184,11 @@
 // Run memory calibration
 #define TCLDBG_RUN_NON_DES_MEM_CALIBRATE 42
 
+#if ENABLE_TCL_BATCH
+// Run the commands queued in debug_batch_t
+#define TCLDBG_RUN_BATCH 43
+#endif
+
 //*****************************************************************************
 // TCL RX Status Codes
 //*****************************************************************************
@@ -238,6 +240,14 @@
 
 #define COMMAND_PARAM_WORDS 4
 
+#if ENABLE_TCL_BATCH
+#define TCLDBG_BATCH_ENTRIES 64
+#define TCLDBG_BATCH_RESPONSE_WORDS 512
+
+// The most any one command answers with
+#define TCLDBG_MAX_RESPONSE_WORDS 16
+#endif
+
 //*****************************************************************************
 // Debug report structs
 // Margins are reported in terms of delay chain taps.
@@ -440,25 +450,6 @@ typedef struct debug_margin_report_struct {
 	
 } debug_margin_report_t;
 
-typedef alt_u32 printf_read_buffer_t[PRINTF_READ_BUFFER_SIZE];
-
-typedef struct debug_printf_output {
-	alt_u32 data_size;
-
-	alt_u32 fifo_size;
-	alt_u32 word_size;
-
-	alt_u32 head;
-	alt_u32 count;
-	alt_u32 slave_lock;
-	alt_u32 master_lock;
-
-
-	printf_read_buffer_t read_buffer[PRINTF_READ_BUFFER_FIFO_WORDS];
-	printf_read_buffer_t active_word;
-
-} debug_printf_output_t;
-
 typedef struct rw_manager_di_buffer {
 	alt_u32 bit_chk;
 	alt_u32 delay;
@@ -499,6 +490,36 @@ typedef struct emif_toolkit_debug_data {
 	alt_u32 rank_mask_size_ptr;
 } emif_toolkit_debug_data_t;
 
+#if ENABLE_TCL_BATCH
+/* One command of a batch.  The host fills in command and parameters; the
+status (a TCLDBG_TX_STATUS_* code) and where the command's answer went in
+the response block are filled in as it runs. */
+typedef struct debug_batch_entry_struct {
+	alt_u32 command;
+	alt_u32 parameters[COMMAND_PARAM_WORDS];
+	alt_u32 status;
+	alt_u32 response_offset;
+	alt_u32 response_words;
+} debug_batch_entry_t;
+
+/* Command batch and response block.  TCLDBG_RUN_BATCH runs the first
+command_parameters[0] entries in order and answers once for all of them.
+It stops early, with entries_run short, when fewer than
+TCLDBG_MAX_RESPONSE_WORDS words of the response block are left; the host
+reads what is there and sends the rest as another batch.  A command sent
+on its own answers at the start of the response block. */
+typedef struct debug_batch_struct {
+	// Size in 32-bit words of the batch area
+	alt_u32 data_size;
+
+	alt_u32 entries_run;
+	alt_u32 response_words;
+
+	debug_batch_entry_t entry[TCLDBG_BATCH_ENTRIES];
+	alt_u32 response[TCLDBG_BATCH_RESPONSE_WORDS];
+} debug_batch_t;
+#endif
+
 /* This the main debug data structure.  This is where you write
 commands, poll command status, pass command parameters, etc.  Contained
 within this data structure are the reports. The memory address of this 
@@ -537,13 +558,24 @@ typedef struct debug_data_struct {
 	alt_u32 di_report_ptr;
 #endif
 
+#if ENABLE_CAL_TIMING
+	// Time spent per calibration stage, sub-stage and group
+	alt_u32 cal_timing_ptr;
+#endif
+
+#if ENABLE_TCL_BATCH
+	// Command batch and responses
+	alt_u32 batch_ptr;
+#endif
+
 	// Report data structures
 	debug_summary_report_t summary_report;
 	debug_cal_report_t cal_report;
 	debug_margin_report_t margin_report;
 
 #if ENABLE_PRINTF_LOG
-	debug_printf_output_t printf_output;
+	// The trace ring DPRINT and IPRINT leave their events in
+	trace_ring_t printf_output;
 #endif
 
 #if ENABLE_DQSEN_SWEEP
@@ -552,6 +584,14 @@ typedef struct debug_data_struct {
 
 	emif_toolkit_debug_data_t emif_toolkit_debug_data;
 
+#if ENABLE_CAL_TIMING
+	cal_timing_t cal_timing;
+#endif
+
+#if ENABLE_TCL_BATCH
+	debug_batch_t batch;
+#endif
+
 } debug_data_t;
 
 /* TCL io memory */
@@ -559,7 +599,6 @@ typedef struct debug_data_struct {
 volatile extern debug_summary_report_t *debug_summary_report;
 volatile extern debug_cal_report_t *debug_cal_report;
 volatile extern debug_margin_report_t *debug_margin_report;
-volatile extern debug_printf_output_t *debug_printf_output;
 volatile extern debug_data_t *debug_data;
 
 volatile extern emif_toolkit_debug_data_t *debug_emif_toolkit_debug_data;
@@ -568,6 +607,8 @@ volatile extern emif_toolkit_debug_data_t *debug_emif_toolkit_debug_data;
 extern void tclrpt_initialize_debug_status (void);
 extern void tclrpt_initialize (debug_data_t *);
 extern void tclrpt_loop(void);
+extern alt_u32 tclrpt_poll(void);
+extern void tclrpt_mark_interface_as_ready(void);
 extern void tclrpt_initialize_data(void);
 extern void tclrpt_set_group_as_calibration_attempted(alt_u32 write_group);
 
@@ -0,0 +1,200 @@
+/*
+ * Disassemble and run the RW manager's ROMs on the host (rw_rom.h)
+ *
+ * The ROMs are the ones sequencer.c loads (inst_rom_init, ac_rom_init),
+ * or with -I and -A the images the FPGA build initializes them from
+ * (hps_inst_ROM.hex, hps_AC_ROM.hex in Intel HEX), so the two can be
+ * checked against each other.
+ *
+ * Each routine named is run in turn from the counters and jump addresses
+ * -c and -j load, as the sequencer would load them before its RUN write,
+ * and reported in AFI clocks and the time they take at AFI_CLK_FREQ,
+ * with the commands they put on the bus.  With no routine, -d lists the
+ * whole instruction ROM with the routines' entry points marked.  For
+ * example, the delay of delay_for_n_mem_clocks(1000):
+ *
+ *   rw_host -c 0=0xff -c 1=3 -j 0=IDLE_LOOP2 -j 1=IDLE_LOOP2 IDLE_LOOP2
+ *
+ * Usage: rw_host [-I inst.hex] [-A ac.hex] [-c n=count] [-j n=address]
+ *                [-d] [-t] [routine...]
+ *   -I  load the instruction ROM from an Intel HEX image
+ *   -A  load the AC ROM from an Intel HEX image
+ *   -c  load counter n (0-3), as RW_MGR_LOAD_CNTR_n
+ *   -j  load jump address n (0-3) with a routine name or ROM address
+ *   -d  disassemble the instruction ROM
+ *   -t  list every clock of the routines run
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "sequencer_defines.h"
+#include "alt_types.h"
+#include "system.h"
+#include "sequencer.h"
+#include "rw_rom.h"
+
+static struct rw_rom rom;
+
+/*
+ * Load one of the ROMs from an Intel HEX image: one word a data record,
+ * big endian, at the record's address.  Returns how many, or -1.
+ */
+static int load_hex(const char *path, int ac)
+{
+	unsigned int size = ac ? RW_ROM_AC_WORDS : RW_ROM_INST_WORDS;
+	char line[128];
+	unsigned int len, addr, type, byte, i;
+	unsigned long w;
+	int n = 0;
+	FILE *f;
+
+	if ((f = fopen(path, "r")) == NULL) {
+		perror(path);
+		return -1;
+	}
+	while (fgets(line, sizeof(line), f) != NULL) {
+		if (line[0] != ':' ||
+		    sscanf(line + 1, "%2x%4x%2x", &len, &addr, &type) != 3 ||
+		    type != 0)
+			continue;
+		for (i = 0, w = 0; i < len; i++) {
+			if (sscanf(line + 9 + 2 * i, "%2x", &byte) != 1)
+				break;
+			w = w << 8 | byte;
+		}
+		if (i < len || addr >= size) {
+			fprintf(stderr, "%s: bad record %s", path, line);
+			fclose(f);
+			return -1;
+		}
+		rw_rom_load(&rom, ac, addr, w);
+		n++;
+	}
+	fclose(f);
+	return n;
+}
+
+/* A routine name or a ROM address, or -1 */
+static int parse_addr(const char *arg)
+{
+	char *end;
+	unsigned long a;
+
+	if (rw_rom_routine_addr(arg) >= 0)
+		return rw_rom_routine_addr(arg);
+	a = strtoul(arg, &end, 0);
+	return *end == '\0' && a < RW_ROM_INST_WORDS ? (int)a : -1;
+}
+
+static void disasm(void)
+{
+	const char *name;
+	char text[128];
+	int a;
+
+	for (a = 0; a < RW_ROM_INST_WORDS; a++) {
+		if ((name = rw_rom_routine_name(a)) != NULL)
+			printf("%s:\n", name);
+		rw_rom_disasm(text, sizeof(text), &rom, rom.inst[a]);
+		printf("  %02x  %05lx  %s\n", a, rom.inst[a], text);
+	}
+}
+
+static void trace_clock(unsigned long clock, unsigned long addr,
+			unsigned long inst, unsigned long ac)
+{
+	char text[128];
+
+	rw_rom_disasm(text, sizeof(text), &rom, inst);
+	printf("%8lu  %02lx  %s\n", clock, addr, text);
+}
+
+static void run(const char *name, int addr, int trace)
+{
+	struct rw_rom_stats s = { 0 };
+	int c;
+
+	rw_rom_run(&rom, addr, &s, trace ? trace_clock : NULL);
+	printf("%s: %lu clocks, %.3f us%s\n", name, s.max,
+	       (double)s.max / AFI_CLK_FREQ,
+	       s.runaway ? ", never returned" : "");
+	for (c = 0; c < RW_CMDS; c++)
+		if (s.cmds[c])
+			printf("  %-3s %llu\n", rw_rom_cmd_name[c], s.cmds[c]);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *inst_hex = NULL, *ac_hex = NULL;
+	int dis = 0, trace = 0, opt, n, addr;
+	unsigned long i;
+	char *end;
+
+	for (i = 0; i < inst_rom_init_size; i++)
+		rw_rom_load(&rom, 0, i, inst_rom_init[i]);
+	for (i = 0; i < ac_rom_init_size; i++)
+		rw_rom_load(&rom, 1, i, ac_rom_init[i]);
+
+	while ((opt = getopt(argc, argv, "I:A:c:j:dt")) != -1)
+		switch (opt) {
+		case 'I':
+			inst_hex = optarg;
+			break;
+		case 'A':
+			ac_hex = optarg;
+			break;
+		case 'c':
+		case 'j':
+			n = strtol(optarg, &end, 0);
+			if (*end != '=' || n < 0 || n >= RW_ROM_COUNTERS) {
+				fprintf(stderr, "-%c wants n=value\n", opt);
+				return 1;
+			}
+			if (opt == 'c') {
+				rw_rom_load_cntr(&rom, n, strtoul(end + 1, NULL, 0));
+			} else if ((addr = parse_addr(end + 1)) < 0) {
+				fprintf(stderr, "no routine %s\n", end + 1);
+				return 1;
+			} else {
+				rom.jump_add[n] = addr;
+			}
+			break;
+		case 'd':
+			dis = 1;
+			break;
+		case 't':
+			trace = 1;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-I inst.hex] [-A ac.hex] "
+				"[-c n=count] [-j n=address] [-d] [-t] "
+				"[routine...]\n", argv[0]);
+			return 1;
+		}
+
+	if (inst_hex) {
+		for (i = 0; i < RW_ROM_INST_WORDS; i++)
+			rw_rom_load(&rom, 0, i, 0);
+		if (load_hex(inst_hex, 0) < 0)
+			return 1;
+	}
+	if (ac_hex) {
+		for (i = 0; i < RW_ROM_AC_WORDS; i++)
+			rw_rom_load(&rom, 1, i, 0);
+		if (load_hex(ac_hex, 1) < 0)
+			return 1;
+	}
+
+	if (dis)
+		disasm();
+	for (; optind < argc; optind++) {
+		if ((addr = parse_addr(argv[optind])) < 0) {
+			fprintf(stderr, "no routine %s\n", argv[optind]);
+			return 1;
+		}
+		run(argv[optind], addr, trace);
+	}
+	return 0;
+}
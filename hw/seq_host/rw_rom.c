@@ -0,0 +1,266 @@
+/*
+ * Interpreter for the RW manager's instruction and AC ROMs; see rw_rom.h
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sequencer_auto.h"
+#include "rw_rom.h"
+
+const char *const rw_rom_cmd_name[RW_CMDS] = {
+	"DES", "NOP", "MRS", "REF", "PRE", "ACT", "WR", "RD", "ZQ"
+};
+
+#define ROUTINE(name)	{ __RW_MGR_##name, #name }
+
+/* Entry points the sequencer runs, from sequencer_auto.h */
+static const struct {
+	unsigned long addr;
+	const char *name;
+} routines[] = {
+	ROUTINE(IDLE), ROUTINE(RETURN),
+	ROUTINE(MRS0_DLL_RESET), ROUTINE(MRS1), ROUTINE(MRS2), ROUTINE(MRS3),
+	ROUTINE(ZQCL), ROUTINE(MRS0_USER),
+	ROUTINE(MRS0_DLL_RESET_MIRR), ROUTINE(MRS1_MIRR), ROUTINE(MRS2_MIRR),
+	ROUTINE(MRS3_MIRR), ROUTINE(MRS0_USER_MIRR),
+	ROUTINE(ACTIVATE_0_AND_1), ROUTINE(ACTIVATE_0_AND_1_WAIT1),
+	ROUTINE(ACTIVATE_1), ROUTINE(ACTIVATE_0_AND_1_WAIT2),
+	ROUTINE(PRECHARGE_ALL), ROUTINE(REFRESH_ALL), ROUTINE(REFRESH_DELAY),
+	ROUTINE(GUARANTEED_WRITE), ROUTINE(GUARANTEED_WRITE_WAIT2),
+	ROUTINE(GUARANTEED_WRITE_WAIT0), ROUTINE(GUARANTEED_WRITE_WAIT3),
+	ROUTINE(GUARANTEED_WRITE_WAIT1),
+	ROUTINE(LFSR_WR_RD_BANK_0_WL_1), ROUTINE(LFSR_WR_RD_BANK_0),
+	ROUTINE(LFSR_WR_RD_BANK_0_NOP), ROUTINE(LFSR_WR_RD_BANK_0_DQS),
+	ROUTINE(LFSR_WR_RD_BANK_0_DATA), ROUTINE(LFSR_WR_RD_BANK_0_WAIT),
+	ROUTINE(LFSR_WR_RD_DM_BANK_0_WL_1), ROUTINE(LFSR_WR_RD_DM_BANK_0),
+	ROUTINE(LFSR_WR_RD_DM_BANK_0_NOP), ROUTINE(LFSR_WR_RD_DM_BANK_0_DQS),
+	ROUTINE(LFSR_WR_RD_DM_BANK_0_DATA), ROUTINE(LFSR_WR_RD_DM_BANK_0_WAIT),
+	ROUTINE(CLEAR_DQS_ENABLE), ROUTINE(GUARANTEED_READ),
+	ROUTINE(GUARANTEED_READ_CONT),
+	ROUTINE(READ_B2B), ROUTINE(READ_B2B_WAIT1), ROUTINE(READ_B2B_WAIT2),
+	ROUTINE(INIT_RESET_0_CKE_0), ROUTINE(INIT_RESET_1_CKE_0),
+	ROUTINE(RDIMM_CMD), ROUTINE(IDLE_LOOP2), ROUTINE(IDLE_LOOP1),
+	ROUTINE(SGLE_READ),
+};
+
+#define AC(name)	[__RW_MGR_ac_##name] = #name
+
+static const char *const ac_names[RW_ROM_AC_WORDS] = {
+	AC(init_reset_0_cke_0), AC(init_reset_1_cke_0),
+	AC(mrs0_user), AC(mrs0_dll_reset), AC(mrs1), AC(mrs2), AC(mrs3),
+	AC(zqcl), AC(mrs0_user_mirr), AC(mrs0_dll_reset_mirr), AC(mrs1_mirr),
+	AC(mrs2_mirr), AC(mrs3_mirr), AC(des), AC(des_odt_1), AC(nop),
+	AC(act_0), AC(act_1), AC(pre_all), AC(ref),
+	AC(write_bank_0_col_0), AC(write_bank_1_col_0),
+	AC(write_bank_0_col_1), AC(write_bank_1_col_1),
+	AC(write_predata), AC(write_data), AC(write_postdata),
+	AC(write_bank_0_col_0_nodata), AC(write_bank_0_col_0_nodata_wl_1),
+	AC(read_bank_0_0), AC(read_bank_1_0), AC(read_bank_0_1),
+	AC(read_bank_1_1), AC(read_en), AC(read_bank_0_1_norden), AC(rdimm),
+};
+
+/* One word of the instruction ROM, or with ac of the AC ROM */
+void rw_rom_load(struct rw_rom *r, int ac, unsigned long addr,
+		 unsigned long data)
+{
+	if (ac && addr < RW_ROM_AC_WORDS)
+		r->ac[addr] = data;
+	else if (!ac && addr < RW_ROM_INST_WORDS)
+		r->inst[addr] = data;
+	r->loads++;
+}
+
+/* LOAD_CNTR_N sets both the count and what a fall-through reloads */
+void rw_rom_load_cntr(struct rw_rom *r, int n, unsigned long value)
+{
+	r->cntr_load[n] = r->cntr[n] = value & 0xff;
+}
+
+enum rw_rom_cmd rw_rom_cmd(unsigned long ac)
+{
+	/* RAS#, CAS#, WE# as three bits, 1 for high */
+	static const enum rw_rom_cmd by_pins[8] = {
+		RW_CMD_MRS, RW_CMD_REF, RW_CMD_PRE, RW_CMD_ACT,
+		RW_CMD_WR, RW_CMD_RD, RW_CMD_ZQ, RW_CMD_NOP
+	};
+
+	if (ac & RW_AC_CS_N)
+		return RW_CMD_DES;
+	return by_pins[(ac & RW_AC_RAS_N ? 4 : 0) | (ac & RW_AC_CAS_N ? 2 : 0) |
+		       (ac & RW_AC_WE_N ? 1 : 0)];
+}
+
+/* Whether m ran from where r now stands (every run takes a clock) */
+static int memo_hit(const struct rw_rom *r, const struct rw_rom_memo *m)
+{
+	return m->clocks != 0 && m->loads == r->loads &&
+		memcmp(m->cntr, r->cntr, sizeof(m->cntr)) == 0 &&
+		memcmp(m->cntr_load, r->cntr_load, sizeof(m->cntr_load)) == 0 &&
+		memcmp(m->jump_add, r->jump_add, sizeof(m->jump_add)) == 0;
+}
+
+/*
+ * Whether the loop that ends in the jump at p, on counter n, has been
+ * round once from where it is now but for counter n being one more.
+ * Another jump on n inside the loop would make the iterations differ.
+ */
+static int loop_repeats(const struct rw_rom *r, unsigned long p, int n)
+{
+	const struct rw_rom_loop *l = &r->loop[p];
+	unsigned long j = r->jump_add[n] & (RW_ROM_INST_WORDS - 1);
+	int k;
+
+	if (l->run != r->runs || j > p)
+		return 0;
+	for (k = 0; k < RW_ROM_COUNTERS; k++)
+		if (l->cntr[k] != r->cntr[k] + (k == n))
+			return 0;
+	for (; j < p; j++)
+		if (r->inst[j] & RW_ROM_JUMP && RW_ROM_CNTR(r->inst[j]) == n)
+			return 0;
+	return 1;
+}
+
+/*
+ * Run the routine at addr to its return, adding it to s if given.
+ * Returns the AFI clocks it took, RW_ROM_MAX_CLOCKS for one that never
+ * returns.
+ */
+unsigned long rw_rom_run(struct rw_rom *r, unsigned long addr,
+			 struct rw_rom_stats *s, rw_rom_trace_fn *trace)
+{
+	struct rw_rom_memo *m;
+	struct rw_rom_loop *l;
+	unsigned long clocks = 0, inst, ac, c;
+	unsigned long cmds[RW_CMDS] = { 0 };
+	int n, k;
+
+	addr &= RW_ROM_INST_WORDS - 1;
+	m = &r->memo[addr];
+	if (!trace && memo_hit(r, m)) {
+		memcpy(r->cntr, m->cntr_end, sizeof(r->cntr));
+		clocks = m->clocks;
+		memcpy(cmds, m->cmds, sizeof(cmds));
+		goto done;
+	}
+	memcpy(m->cntr, r->cntr, sizeof(m->cntr));
+	memcpy(m->cntr_load, r->cntr_load, sizeof(m->cntr_load));
+	memcpy(m->jump_add, r->jump_add, sizeof(m->jump_add));
+	r->runs++;
+
+	for (;;) {
+		addr &= RW_ROM_INST_WORDS - 1;
+		inst = r->inst[addr];
+		ac = r->ac[RW_ROM_AC(inst)];
+		if (trace)
+			trace(clocks, addr, inst, ac);
+		cmds[rw_rom_cmd(ac)]++;
+		if (++clocks >= RW_ROM_MAX_CLOCKS || inst & RW_ROM_RETURN)
+			break;
+		if (inst & RW_ROM_JUMP) {
+			n = RW_ROM_CNTR(inst);
+			c = r->cntr[n];
+			l = &r->loop[addr];
+			if (c != 0 && !trace && loop_repeats(r, addr, n)) {
+				/* c more times round, then fall through */
+				for (k = 0; k < RW_CMDS; k++)
+					cmds[k] += c * (cmds[k] - l->cmds[k]);
+				clocks += c * (clocks - l->clocks);
+			} else if (c != 0) {
+				l->run = r->runs;
+				memcpy(l->cntr, r->cntr, sizeof(l->cntr));
+				l->clocks = clocks;
+				memcpy(l->cmds, cmds, sizeof(l->cmds));
+				r->cntr[n]--;
+				addr = r->jump_add[n];
+				continue;
+			}
+			r->cntr[n] = r->cntr_load[n];
+		}
+		addr++;
+	}
+	if (clocks > RW_ROM_MAX_CLOCKS)
+		clocks = RW_ROM_MAX_CLOCKS;
+	memcpy(m->cntr_end, r->cntr, sizeof(m->cntr_end));
+	m->clocks = clocks;
+	memcpy(m->cmds, cmds, sizeof(m->cmds));
+	m->loads = r->loads;
+
+done:
+	if (s) {
+		if (s->runs == 0 || clocks < s->min)
+			s->min = clocks;
+		if (clocks > s->max)
+			s->max = clocks;
+		s->runs++;
+		s->clocks += clocks;
+		for (n = 0; n < RW_CMDS; n++)
+			s->cmds[n] += cmds[n];
+		if (clocks >= RW_ROM_MAX_CLOCKS)
+			s->runaway = 1;
+	}
+	return clocks;
+}
+
+const char *rw_rom_routine_name(unsigned long addr)
+{
+	unsigned int i;
+
+	for (i = 0; i < sizeof(routines) / sizeof(routines[0]); i++)
+		if (routines[i].addr == addr)
+			return routines[i].name;
+	return NULL;
+}
+
+const char *rw_rom_ac_name(unsigned long addr)
+{
+	return addr < RW_ROM_AC_WORDS ? ac_names[addr] : NULL;
+}
+
+/* Address of a routine by name, or -1 */
+int rw_rom_routine_addr(const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; i < sizeof(routines) / sizeof(routines[0]); i++)
+		if (strcmp(routines[i].name, name) == 0)
+			return routines[i].addr;
+	return -1;
+}
+
+/*
+ * One instruction as text: what it does to the program counter, then
+ * the AC ROM word it drives, as a command with what goes with it
+ */
+void rw_rom_disasm(char *buf, int size, const struct rw_rom *r,
+		   unsigned long inst)
+{
+	unsigned long addr = RW_ROM_AC(inst), ac = r->ac[addr];
+	enum rw_rom_cmd cmd = rw_rom_cmd(ac);
+	const char *name = rw_rom_ac_name(addr);
+	char flow[16];
+	int n;
+
+	if (inst & RW_ROM_RETURN)
+		strcpy(flow, "ret");
+	else if (inst & RW_ROM_JUMP)
+		sprintf(flow, "jnz c%lu", RW_ROM_CNTR(inst));
+	else
+		strcpy(flow, "");
+
+	n = snprintf(buf, size, "%-7s %-30s %-3s", flow, name ? name : "?",
+		     rw_rom_cmd_name[cmd]);
+	if (n < size && (cmd == RW_CMD_MRS || cmd == RW_CMD_ACT ||
+			 cmd == RW_CMD_WR || cmd == RW_CMD_RD))
+		n += snprintf(buf + n, size - n, " ba %lu a 0x%04lx",
+			      RW_AC_BA(ac), RW_AC_A(ac));
+	if (n < size && !(ac & RW_AC_RESET_N))
+		n += snprintf(buf + n, size - n, " reset");
+	if (n < size && !(ac & RW_AC_CKE))
+		n += snprintf(buf + n, size - n, " cke-low");
+	if (n < size && ac & RW_AC_ODT)
+		n += snprintf(buf + n, size - n, " odt");
+	if (n < size && (RW_ROM_DATA(inst) || RW_AC_DATA(ac)))
+		snprintf(buf + n, size - n, " data %03lx/%lx",
+			 RW_ROM_DATA(inst), RW_AC_DATA(ac));
+}
@@ -0,0 +1,124 @@
+/*
+ * Interpreter for the RW manager's instruction and AC ROMs
+ *
+ * The RW manager runs a routine from the instruction ROM one instruction
+ * per AFI clock, starting where the sequencer's RUN write points it and
+ * ending with the instruction that has RW_ROM_RETURN set.  Each
+ * instruction puts one AC ROM word on the command and address bus.  An
+ * instruction with RW_ROM_JUMP set is "jnz cntrN, jump_add[N]": if the
+ * counter is non-zero it is decremented and the routine goes on at the
+ * jump address, else the counter is reloaded with the value last
+ * written to RW_MGR_LOAD_CNTR_N and the routine falls through.  That is
+ * what the loops' cycle counts in sequencer.c assume, e.g. for the reset
+ * wait of rw_mgr_mem_initialize:
+ *
+ *   num_cycles = (CTR2 + 1) * [(CTR1 + 1) * (2 * (CTR0 + 1) + 1) + 1] + 1
+ *
+ * The word layouts are read off the ROMs (sequencer_auto_*_init.c, the
+ * hps_*_ROM.hex images) against the commands the entries are named for.
+ * The data path bits of either word are kept but not interpreted.
+ *
+ * A routine's run depends only on where it starts and the counters and
+ * jump addresses it starts from, so rw_rom_run keeps the last run from
+ * each entry point and replays it when those match: the sequencer runs
+ * the same few routines from the same settings thousands of times.
+ * Untraced, a loop is stepped through once; when it comes back round to
+ * its jump with every other counter as it was, the iterations left are
+ * all that one again, and are counted at once.
+ * Change the ROMs through rw_rom_load, which forgets those runs.
+ */
+
+#ifndef _RW_ROM_H
+#define _RW_ROM_H
+
+#define RW_ROM_INST_WORDS	128
+#define RW_ROM_AC_WORDS		64
+#define RW_ROM_COUNTERS		4
+
+/* Instruction ROM word */
+#define RW_ROM_RETURN		(1UL << 19)	/* Last instruction */
+#define RW_ROM_JUMP		(1UL << 15)	/* jnz RW_ROM_CNTR */
+#define RW_ROM_CNTR(w)		(((w) >> 13) & 0x3)
+#define RW_ROM_AC(w)		(((w) >> 7) & 0x3f)	/* AC ROM word */
+#define RW_ROM_DATA(w)		((((w) >> 16) & 0x7) << 7 | ((w) & 0x7f))
+
+/* AC ROM word: one clock of the memory's command and address bus */
+#define RW_AC_CS_N		(1UL << 29)
+#define RW_AC_CKE		(1UL << 28)
+#define RW_AC_ODT		(1UL << 27)
+#define RW_AC_DATA(w)		(((w) >> 23) & 0xf)
+#define RW_AC_WE_N		(1UL << 22)
+#define RW_AC_CAS_N		(1UL << 21)
+#define RW_AC_RAS_N		(1UL << 20)
+#define RW_AC_RESET_N		(1UL << 19)
+#define RW_AC_BA(w)		(((w) >> 16) & 0x7)
+#define RW_AC_A(w)		((w) & 0xffff)
+
+/* DDR3 commands, from CS#, RAS#, CAS# and WE# */
+enum rw_rom_cmd {
+	RW_CMD_DES, RW_CMD_NOP, RW_CMD_MRS, RW_CMD_REF, RW_CMD_PRE,
+	RW_CMD_ACT, RW_CMD_WR, RW_CMD_RD, RW_CMD_ZQ, RW_CMDS
+};
+
+extern const char *const rw_rom_cmd_name[RW_CMDS];
+
+/* The last untraced run from one entry point */
+struct rw_rom_memo {
+	unsigned long loads;			/* rw_rom.loads when it ran */
+	unsigned long cntr[RW_ROM_COUNTERS];		/* At the start */
+	unsigned long cntr_load[RW_ROM_COUNTERS];
+	unsigned long jump_add[RW_ROM_COUNTERS];
+	unsigned long cntr_end[RW_ROM_COUNTERS];	/* At the return */
+	unsigned long clocks;
+	unsigned long cmds[RW_CMDS];
+};
+
+/* Where the current run last took a jump back */
+struct rw_rom_loop {
+	unsigned long run;			/* rw_rom.runs when it did */
+	unsigned long cntr[RW_ROM_COUNTERS];	/* Before the jump */
+	unsigned long clocks;
+	unsigned long cmds[RW_CMDS];
+};
+
+struct rw_rom {
+	unsigned long inst[RW_ROM_INST_WORDS];
+	unsigned long ac[RW_ROM_AC_WORDS];
+	unsigned long cntr_load[RW_ROM_COUNTERS];	/* LOAD_CNTR_N */
+	unsigned long cntr[RW_ROM_COUNTERS];		/* Counting down */
+	unsigned long jump_add[RW_ROM_COUNTERS];	/* LOAD_JUMP_ADD_N */
+	unsigned long loads;				/* rw_rom_load calls */
+	struct rw_rom_memo memo[RW_ROM_INST_WORDS];	/* By entry point */
+	unsigned long runs;				/* Not from memo */
+	struct rw_rom_loop loop[RW_ROM_INST_WORDS];	/* By jump address */
+};
+
+/* What one or more runs of a routine took */
+struct rw_rom_stats {
+	unsigned long runs;
+	unsigned long long clocks;	/* AFI clocks */
+	unsigned long min, max;		/* Shortest and longest run */
+	unsigned long long cmds[RW_CMDS];
+	int runaway;			/* Some run hit RW_ROM_MAX_CLOCKS */
+};
+
+/* Far longer than any delay the sequencer asks for */
+#define RW_ROM_MAX_CLOCKS	(1UL << 28)
+
+/* Called for every clock of a traced run */
+typedef void rw_rom_trace_fn(unsigned long clock, unsigned long addr,
+			     unsigned long inst, unsigned long ac);
+
+void rw_rom_load(struct rw_rom *r, int ac, unsigned long addr,
+		 unsigned long data);
+void rw_rom_load_cntr(struct rw_rom *r, int n, unsigned long value);
+unsigned long rw_rom_run(struct rw_rom *r, unsigned long addr,
+			 struct rw_rom_stats *s, rw_rom_trace_fn *trace);
+enum rw_rom_cmd rw_rom_cmd(unsigned long ac);
+const char *rw_rom_routine_name(unsigned long addr);
+const char *rw_rom_ac_name(unsigned long addr);
+int rw_rom_routine_addr(const char *name);
+void rw_rom_disasm(char *buf, int size, const struct rw_rom *r,
+		   unsigned long inst);
+
+#endif
@@ -0,0 +1,35 @@
+/*
+ * Host stand-in for U-Boot's <asm/arch/sdram.h>
+ *
+ * sequencer.c only needs the PHYCTRL fields it writes in
+ * initialize_hps_phy(); the offsets are those of the Cyclone V SDRAM
+ * controller group.
+ */
+
+#ifndef _SEQ_HOST_SDRAM_H
+#define _SEQ_HOST_SDRAM_H
+
+#define SDR_FIELD_SET(lsb, width, x) \
+	(((x) << (lsb)) & ((((alt_u32)1 << (width)) - 1) << (lsb)))
+
+#define SDR_CTRLGRP_PHYCTRL_PHYCTRL_0_OFFSET	0x150
+#define SDR_CTRLGRP_PHYCTRL_PHYCTRL_1_OFFSET	0x154
+#define SDR_CTRLGRP_PHYCTRL_PHYCTRL_2_OFFSET	0x158
+
+#define SDR_CTRLGRP_PHYCTRL_PHYCTRL_0_ACDELAYEN_SET(x)		SDR_FIELD_SET(0, 2, x)
+#define SDR_CTRLGRP_PHYCTRL_PHYCTRL_0_DQDELAYEN_SET(x)		SDR_FIELD_SET(2, 2, x)
+#define SDR_CTRLGRP_PHYCTRL_PHYCTRL_0_DQSDELAYEN_SET(x)		SDR_FIELD_SET(4, 2, x)
+#define SDR_CTRLGRP_PHYCTRL_PHYCTRL_0_DQSLOGICDELAYEN_SET(x)	SDR_FIELD_SET(6, 2, x)
+#define SDR_CTRLGRP_PHYCTRL_PHYCTRL_0_RESETDELAYEN_SET(x)	SDR_FIELD_SET(8, 1, x)
+#define SDR_CTRLGRP_PHYCTRL_PHYCTRL_0_LPDDRDIS_SET(x)		SDR_FIELD_SET(9, 1, x)
+#define SDR_CTRLGRP_PHYCTRL_PHYCTRL_0_ADDLATSEL_SET(x)		SDR_FIELD_SET(10, 1, x)
+#define SDR_CTRLGRP_PHYCTRL_PHYCTRL_0_SAMPLECOUNT_19_0_SET(x)	SDR_FIELD_SET(12, 20, x)
+#define SDR_CTRLGRP_PHYCTRL_PHYCTRL_0_SAMPLECOUNT_19_0_WIDTH	20
+#define SDR_CTRLGRP_PHYCTRL_PHYCTRL_1_SAMPLECOUNT_31_20_SET(x)	SDR_FIELD_SET(0, 12, x)
+#define SDR_CTRLGRP_PHYCTRL_PHYCTRL_1_LONGIDLESAMPLECOUNT_19_0_SET(x) \
+	SDR_FIELD_SET(12, 20, x)
+#define SDR_CTRLGRP_PHYCTRL_PHYCTRL_1_LONGIDLESAMPLECOUNT_19_0_WIDTH 20
+#define SDR_CTRLGRP_PHYCTRL_PHYCTRL_2_LONGIDLESAMPLECOUNT_31_20_SET(x) \
+	SDR_FIELD_SET(0, 12, x)
+
+#endif
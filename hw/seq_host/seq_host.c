@@ -0,0 +1,520 @@
+/*
+ * Run the preloader's DDR3 calibration on the host against seq_model
+ *
+ * sequencer.c is compiled unchanged except for the register accessors
+ * (sdram_io.h, SEQ_HOST), so the same search runs, in the same order,
+ * as on the board.  Prints where the register traffic and the time go
+ * by calibration stage, and the settings calibration settled on.
+ *
+ * With -w the model is warm-reset and calibrated again, which exercises
+ * the calibration cache (ENABLE_CALIB_CACHE): each warm boot should
+ * restore the previous result unless -d has moved the board too far.
+ *
+ * Built with ENABLE_MARGIN_EXPORT (seq_host_margins), every group's pins
+ * are margined after it calibrates, and -m saves the record the
+ * sequencer leaves for the OS, for sw/ddr_margins -f to decode.
+ *
+ * seq_host_coarse (ENABLE_COARSE_EDGE_SEARCH) runs the same calibration
+ * in fewer tests; make compare VARIANT=... checks it and the other
+ * variants settle on the same settings.
+ * seq_host_de1soc (ENABLE_DE1_SOC_PROFILE) runs it unchanged from code
+ * specialized for this board; make profile compares its size and time.
+ *
+ * With -r the board drifts after the last boot and the reads are
+ * recentered on memory in use (ENABLE_READ_RECENTER), round after round,
+ * each reporting the read margin the drift left and the recentering
+ * restored, and anything that would have cost the memory its contents.
+ *
+ * seq_host_trace (ENABLE_PRINTF_LOG) leaves the sequencer's messages in
+ * its trace ring as binary events; -l drains the ring after each boot and
+ * round and formats them here, as a reader on the board would.
+ *
+ * The model runs every RW manager routine through the ROMs the sequencer
+ * loads (rw_rom.h), so each stage also reports mem_us, the time the
+ * memory spent on its routines at AFI_CLK_FREQ; -i breaks that down by
+ * routine.  tests counts the test routines once per group they ran on.
+ *
+ * With -n every burst the routines read or write gets timing noise, so
+ * tests near an eye edge pass or fail by chance, the more likely to fail
+ * the longer they are.  seq_host_adaptive (ENABLE_ADAPTIVE_TEST_COUNT)
+ * runs the coarse edge search's tests short but at the edges it keeps;
+ * make noise checks it keeps the margins of seq_host_coarse in less
+ * mem_us, though in more tests.
+ *
+ * On the board the sequencer's globals live on a stack nothing clears;
+ * -f fills the stack below main with a byte before each boot and round,
+ * so a global read before it is set shows up as a changed result.
+ *
+ * Usage: seq_host [-s seed] [-w warm boots] [-r rounds] [-d ps] [-q] [-t]
+ *                 [-l] [-i] [-m file] [-n ps] [-N seed] [-e ps] [-f byte]
+ *   -s  seed for the modeled board's skews (default 1)
+ *   -w  warm boots after the first (default 0)
+ *   -r  read recentering rounds after the last boot (default 0)
+ *   -d  drift every pin by up to this much before each warm boot and
+ *       recentering round
+ *   -q  only the per-stage report
+ *   -t  also the sequencer's own per-group timing (ENABLE_CAL_TIMING)
+ *   -l  also the sequencer's messages (ENABLE_PRINTF_LOG)
+ *   -i  also the clocks and commands of each RW manager routine
+ *   -m  write the margin record to file after the last boot
+ *   -n  timing noise of every burst, in ps of deviation (default 0)
+ *   -N  seed for the noise (default 1)
+ *   -e  narrow the read eye of each group's first DQ pin to this wide
+ *   -f  fill the stack with this byte before calibrating (default none)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "sequencer_defines.h"
+#include "alt_types.h"
+#include "system.h"
+#include "sdram_io.h"
+#include "sequencer.h"
+#include "seq_model.h"
+
+static const char *stage_name[SEQ_MODEL_STAGES] = {
+	[CAL_STAGE_NIL] = "init",
+	[CAL_STAGE_VFIFO] = "vfifo",
+	[CAL_STAGE_WLEVEL] = "wlevel",
+	[CAL_STAGE_LFIFO] = "lfifo",
+	[CAL_STAGE_WRITES] = "writes",
+	[CAL_STAGE_FULLTEST] = "fulltest",
+	[CAL_STAGE_REFRESH] = "refresh",
+	[CAL_STAGE_CAL_SKIPPED] = "skipped",
+	[CAL_STAGE_CAL_ABORTED] = "aborted",
+	[CAL_STAGE_VFIFO_AFTER_WRITES] = "vfifo_end",
+};
+
+static void print_stages(void)
+{
+	const struct seq_model_stage_stats *s;
+	struct seq_model_stage_stats t = { 0 };
+	int i;
+
+	printf("%-10s %9s %9s %8s %7s %10s %10s\n", "stage", "reads",
+	       "writes", "updates", "tests", "us", "mem_us");
+	for (i = 0; i < SEQ_MODEL_STAGES; i++) {
+		s = &seq_model.stats[i];
+		if (s->reads + s->writes == 0)
+			continue;
+		printf("%-10s %9lu %9lu %8lu %7lu %10.1f %10.1f\n",
+		       stage_name[i] ? stage_name[i] : "?", s->reads, s->writes,
+		       s->scc_updates, s->tests, s->ns / 1e3,
+		       (double)s->clocks / AFI_CLK_FREQ);
+		t.reads += s->reads;
+		t.writes += s->writes;
+		t.scc_updates += s->scc_updates;
+		t.tests += s->tests;
+		t.ns += s->ns;
+		t.clocks += s->clocks;
+	}
+	printf("%-10s %9lu %9lu %8lu %7lu %10.1f %10.1f\n", "total",
+	       t.reads, t.writes, t.scc_updates, t.tests, t.ns / 1e3,
+	       (double)t.clocks / AFI_CLK_FREQ);
+}
+
+/*
+ * What each RW manager routine cost the memory: AFI clocks per run and in
+ * all, and the commands it put on the bus, by the routine's entry point
+ */
+static void print_routines(void)
+{
+	static const enum rw_rom_cmd cmds[] = {
+		RW_CMD_ACT, RW_CMD_WR, RW_CMD_RD, RW_CMD_PRE, RW_CMD_REF,
+		RW_CMD_MRS, RW_CMD_ZQ
+	};
+	const struct rw_rom_stats *s;
+	struct rw_rom_stats t = { 0 };
+	const char *name;
+	unsigned int a, c;
+
+	if (!seq_model.rom_loaded) {
+		printf("no routines: the RW manager's ROM was never loaded\n");
+		return;
+	}
+	printf("%-26s %6s %6s %6s %10s %9s", "routine", "runs", "min", "max",
+	       "clocks", "mem_us");
+	for (c = 0; c < sizeof(cmds) / sizeof(cmds[0]); c++)
+		printf(" %6s", rw_rom_cmd_name[cmds[c]]);
+	printf("\n");
+	for (a = 0; a < RW_ROM_INST_WORDS; a++) {
+		s = &seq_model.routine[a];
+		if (s->runs == 0)
+			continue;
+		name = rw_rom_routine_name(a);
+		printf("%-26s %6lu %6lu %6lu %10llu %9.1f", name ? name : "?",
+		       s->runs, s->min, s->max, s->clocks,
+		       (double)s->clocks / AFI_CLK_FREQ);
+		for (c = 0; c < sizeof(cmds) / sizeof(cmds[0]); c++)
+			printf(" %6llu", s->cmds[cmds[c]]);
+		printf("%s\n", s->runaway ? " never returned" : "");
+		t.runs += s->runs;
+		t.clocks += s->clocks;
+		for (c = 0; c < RW_CMDS; c++)
+			t.cmds[c] += s->cmds[c];
+	}
+	printf("%-26s %6lu %6s %6s %10llu %9.1f", "total", t.runs, "", "",
+	       t.clocks, (double)t.clocks / AFI_CLK_FREQ);
+	for (c = 0; c < sizeof(cmds) / sizeof(cmds[0]); c++)
+		printf(" %6llu", t.cmds[cmds[c]]);
+	printf("\n");
+}
+
+static void print_settings(void)
+{
+	const struct seq_model_group_regs *r;
+	int g, i;
+
+	printf("fom in %lu out %lu\n", seq_model.regs[REG_FILE_FOM / 4] & 0xff,
+	       (seq_model.regs[REG_FILE_FOM / 4] >> 8) & 0xff);
+	printf("read latency %lu\n", seq_model.read_lat);
+	printf("grp vfifo phase en_dly dqs_in dqs_out dm_out  dq_in   dq_out1\n");
+	for (g = 0; g < SEQ_MODEL_GROUPS; g++) {
+		r = &seq_model.live[g];
+		printf("%3d %5u %5lu %6lu %6lu %7lu %6lu ", g, seq_model.vfifo[g],
+		       r->dqs_en_phase, r->dqs_en_delay, r->dqs_in,
+		       r->io_out1[SEQ_MODEL_DQS_PIN],
+		       r->io_out1[SEQ_MODEL_DM_PIN]);
+		for (i = 0; i < SEQ_MODEL_DQ; i++)
+			printf("%c%lu", i ? ',' : ' ', r->io_in[i]);
+		for (i = 0; i < SEQ_MODEL_DQ; i++)
+			printf("%c%lu", i ? ',' : ' ', r->io_out1[i]);
+		printf("\n");
+	}
+}
+
+static void print_timing(void)
+{
+	unsigned long t;
+	int st, sub, g;
+
+	printf("sequencer timing: %.1f us\n",
+	       (double)cal_timing->total / cal_timing->ticks_per_us);
+	printf("%-10s %3s", "stage", "sub");
+	for (g = 0; g < MAX_DQS; g++)
+		printf("   group %d", g);
+	printf("\n");
+	for (st = 0; st < CAL_TIMING_STAGES; st++)
+		for (sub = 0; sub < CAL_TIMING_SUBSTAGES; sub++) {
+			for (g = 0, t = 0; g < MAX_DQS; g++)
+				t += cal_timing->ticks[st][sub][g];
+			if (t == 0)
+				continue;
+			printf("%-10s %3d", stage_name[st], sub);
+			for (g = 0; g < MAX_DQS; g++)
+				printf(" %9.1f", (double)cal_timing->ticks[st][sub][g] /
+				       cal_timing->ticks_per_us);
+			printf("\n");
+		}
+}
+
+static unsigned char *put32(unsigned char *p, unsigned long v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+	p[2] = v >> 16;
+	p[3] = v >> 24;
+	return p + 4;
+}
+
+/*
+ * Write the margin record as the board lays it out: alt_u32 is as wide
+ * as a long here, so the words are packed down to 32 bits and the size
+ * and checksum done again
+ */
+static int save_margins(const char *path)
+{
+	const margin_export_t *m = (const margin_export_t *)seq_model.margins;
+	unsigned char buf[256], *p = buf, *size;
+	unsigned long crc;
+	int i, b;
+	FILE *f;
+
+	if (m->magic != MARGIN_EXPORT_MAGIC) {
+		fprintf(stderr, "no margins were measured\n");
+		return -1;
+	}
+	p = put32(p, m->magic);
+	size = p;
+	p += 2;
+	*p++ = m->tap_ps;
+	*p++ = m->tap_ps >> 8;
+	*p++ = m->shadow_regs;
+	*p++ = m->groups;
+	*p++ = m->dq_per_group;
+	*p++ = m->dm_per_group;
+	for (i = 0; i < NUM_SHADOW_REGS; i++)
+		p = put32(p, m->margined[i]);
+	memcpy(p, m->dq_in, sizeof(m->dq_in));
+	p += sizeof(m->dq_in);
+	memcpy(p, m->dq_out, sizeof(m->dq_out));
+	p += sizeof(m->dq_out);
+	memcpy(p, m->dm, sizeof(m->dm));
+	p += sizeof(m->dm);
+	while ((p - buf) % 4)
+		*p++ = 0;
+	size[0] = (p - buf + 4);
+	size[1] = (p - buf + 4) >> 8;
+
+	for (crc = 0xffffffff, i = 0; i < p - buf; i++)
+		for (crc ^= buf[i], b = 0; b < 8; b++)
+			crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+	p = put32(p, ~crc);
+
+	if ((f = fopen(path, "wb")) == NULL) {
+		perror(path);
+		return -1;
+	}
+	fwrite(buf, 1, p - buf, f);
+	return fclose(f);
+}
+
+/*
+ * Print one event's message: each conversion in fmt takes the next
+ * argument word, converted to the type its length modifier and
+ * conversion call for (a string from its TRACE_STRING offset)
+ */
+static void print_event(const char *fmt, const unsigned long *arg, int nargs)
+{
+	char spec[32];
+	const char *p, *conv;
+	int len, n = 0;
+	unsigned long a;
+
+	for (p = fmt; *p; p = conv + 1) {
+		if (*p != '%' || p[1] == '%') {
+			putchar(*p);
+			conv = p + (*p == '%');
+			continue;
+		}
+		conv = p + 1 + strspn(p + 1, "-+ #0123456789.");
+		len = strspn(conv, "hlLqjzt");
+		conv += len;
+		if (*conv == '\0' || conv - p + 2 > (int)sizeof(spec))
+			break;
+		memcpy(spec, p, conv - p + 1);
+		spec[conv - p + 1] = '\0';
+		a = n < nargs ? arg[n++] : 0;
+
+		switch (*conv) {
+		case 's':
+			printf(spec, TRACE_STRING_AT(a));
+			break;
+		case 'c':
+			printf(spec, (int)a);
+			break;
+		case 'd':
+		case 'i':
+			if (len == 0)
+				printf(spec, (int)a);
+			else if (len == 1)
+				printf(spec, (long)a);
+			else
+				printf(spec, (long long)(long)a);
+			break;
+		default:
+			if (len == 0)
+				printf(spec, (unsigned int)a);
+			else if (len == 1)
+				printf(spec, a);
+			else
+				printf(spec, (unsigned long long)a);
+			break;
+		}
+	}
+}
+
+/*
+ * Drain the trace ring: the consumer side of trace_ring_t, which takes
+ * the events up to head and hands their words back by moving tail
+ */
+static void print_trace(void)
+{
+	volatile trace_ring_t *r = (volatile trace_ring_t *)seq_model.trace;
+	unsigned long head, tail, info, w[TRACE_EVENT_WORDS + 255];
+	static unsigned long start;
+	unsigned long events = 0;
+	int i, n;
+
+	if (r->data_size != sizeof(trace_ring_t)) {
+		printf("no trace: build seq_host_trace\n");
+		return;
+	}
+	head = r->head;
+	__sync_synchronize();
+	for (tail = r->tail; tail != head; tail += TRACE_EVENT_WORDS + n) {
+		info = r->buf[tail % r->words];
+		n = TRACE_EVENT_NARGS(info);
+		for (i = 0; i < TRACE_EVENT_WORDS + n; i++)
+			w[i] = r->buf[(tail + i) % r->words];
+		if (tail == 0)
+			start = w[1];
+		if (info & TRACE_EVENT_INFO)
+			printf("%10.1f info ", (double)(w[1] - start) /
+			       r->ticks_per_us);
+		else
+			printf("%10.1f dbg%lu ", (double)(w[1] - start) /
+			       r->ticks_per_us, TRACE_EVENT_LEVEL(info));
+		print_event(TRACE_STRING_AT(w[2]), w + TRACE_EVENT_WORDS, n);
+		printf("\n");
+		events++;
+	}
+	__sync_synchronize();
+	r->tail = tail;
+	printf("trace: %lu events, %lu dropped\n", events, r->dropped);
+}
+
+/* Leave fill in the stack the sequencer's frames will take over */
+static void __attribute__((noinline)) fill_stack(int fill)
+{
+	unsigned char stack[1 << 16];
+
+	memset(stack, fill, sizeof(stack));
+	__asm__ __volatile__("" : : "r"(stack) : "memory");
+}
+
+/*
+ * Drift the board and recenter its reads with the memory in use.
+ * Returns 0 unless every group recentered and the memory kept its
+ * contents.
+ */
+static int recenter(int round, int drift, int quiet, int trace,
+		    int routines, int fill)
+{
+	int before, pass;
+
+	seq_model_drift(drift);
+	before = seq_model_read_margin();
+	seq_model_in_use(1);
+	if (fill >= 0)
+		fill_stack(fill);
+	pass = sdram_recenter_reads();
+	seq_model_finish();
+	seq_model_in_use(0);
+
+	printf("\nrecenter %d: read margin %d ps after drift, %d ps after "
+	       "recentering%s\n", round, before, seq_model_read_margin(),
+	       pass ? "" : ", some groups kept their settings");
+	printf("memory in use: %lu refreshes, %lu tests without one, "
+	       "%lu resets or mode register writes, %lu routines outside "
+	       "row 0x%x\n",
+	       seq_model.in_use_refreshes, seq_model.in_use_unrefreshed,
+	       seq_model.in_use_inits, seq_model.in_use_rows,
+	       RECENTER_PATTERN_ROW);
+	print_stages();
+	if (routines)
+		print_routines();
+	if (!quiet)
+		print_settings();
+	if (trace)
+		print_trace();
+	return pass && seq_model.in_use_unrefreshed == 0 &&
+		seq_model.in_use_inits == 0 && seq_model.in_use_rows == 0;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int seed = 1;
+	int quiet = 0, timing = 0, trace = 0, warm = 0, rounds = 0, drift = 0;
+	int routines = 0, noise = 0, narrow = 0, fill = -1;
+	unsigned int noise_seed = 1;
+	int opt;
+	int pass = 0, boot, round;
+	unsigned long failing;
+	const char *margins = NULL;
+
+	while ((opt = getopt(argc, argv, "s:w:r:d:qtlim:n:N:e:f:")) != -1)
+		switch (opt) {
+		case 's':
+			seed = strtoul(optarg, NULL, 0);
+			break;
+		case 'w':
+			warm = atoi(optarg);
+			break;
+		case 'r':
+			rounds = atoi(optarg);
+			break;
+		case 'd':
+			drift = atoi(optarg);
+			break;
+		case 'q':
+			quiet = 1;
+			break;
+		case 't':
+			timing = 1;
+			break;
+		case 'l':
+			trace = 1;
+			break;
+		case 'i':
+			routines = 1;
+			break;
+		case 'm':
+			margins = optarg;
+			break;
+		case 'n':
+			noise = atoi(optarg);
+			break;
+		case 'N':
+			noise_seed = strtoul(optarg, NULL, 0);
+			break;
+		case 'e':
+			narrow = atoi(optarg);
+			break;
+		case 'f':
+			fill = strtoul(optarg, NULL, 0) & 0xff;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-s seed] [-w warm boots] "
+				"[-r rounds] [-d ps] [-q] [-t] [-l] [-i] "
+				"[-m file] [-n ps] [-N seed] [-e ps] [-f byte]\n",
+				argv[0]);
+			return 1;
+		}
+
+	seq_model_init(seed);
+	seq_model_narrow(narrow);
+	seq_model_noise(noise, noise_seed);
+	for (boot = 0; boot <= warm; boot++) {
+		if (boot > 0) {
+			seq_model_drift(drift);
+			seq_model_warm_reset();
+			printf("\n");
+		}
+		if (fill >= 0)
+			fill_stack(fill);
+		pass = sdram_calibration();
+		seq_model_finish();
+
+		printf("%s boot: ", boot ? "warm" : "cold");
+		if (pass) {
+			printf("calibration passed%s\n",
+			       seq_model.stats[CAL_STAGE_VFIFO].tests ? "" :
+			       ", restored from cache");
+		} else {
+			failing = seq_model.regs[REG_FILE_FAILING_STAGE / 4];
+			printf("calibration failed: stage %lu sub-stage %lu "
+			       "group %lu\n", failing & 0xff,
+			       (failing >> 8) & 0xff, (failing >> 16) & 0xff);
+		}
+		printf("read margin %d ps\n", seq_model_read_margin());
+		printf("write margin %d ps\n", seq_model_write_margin());
+		print_stages();
+		if (routines)
+			print_routines();
+		if (timing)
+			print_timing();
+		if (!quiet)
+			print_settings();
+		if (trace)
+			print_trace();
+	}
+	for (round = 1; pass && round <= rounds; round++)
+		pass = recenter(round, drift, quiet, trace, routines,
+				 fill);
+	if (margins && save_margins(margins) < 0)
+		return 1;
+	return !pass;
+}
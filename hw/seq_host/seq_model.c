@@ -0,0 +1,592 @@
+/*
+ * Register-level model of the HPS SDRAM PHY managers; see seq_model.h
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sequencer_defines.h"
+#include "alt_types.h"
+#include "system.h"
+#include "sequencer.h"
+#include "sequencer_auto.h"
+#include "seq_model.h"
+
+struct seq_model seq_model;
+
+/* One memory clock, in the picoseconds the delay chains are given in */
+#define CLOCK_PS	(1000000 / AFI_CLK_FREQ)
+
+/* DDR3-1600 part run at 400 MHz, as configured in soc_system.qsys */
+#define MEM_T_WL	8
+#define MEM_T_RL	11
+
+#define ALL_FAIL	((1UL << SEQ_MODEL_DQ) - 1)
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Uniform in [lo, hi] */
+static int pick(int lo, int hi)
+{
+	return lo + rand() % (hi - lo + 1);
+}
+
+/*
+ * A board with the skews of a short DE1-SoC-like layout: gate windows a
+ * few clocks into the VFIFO, eyes of about a quarter of the clock with
+ * the DQ pins spread around the DQS edge.  The reserve taps the
+ * sequencer starts from (IO_DQS_IN_RESERVE, IO_DQS_OUT_RESERVE) land
+ * inside every eye, as the guaranteed read and write need them to.
+ */
+void seq_model_init(unsigned int seed)
+{
+	struct seq_model *m = &seq_model;
+	struct seq_model_board_group *b;
+	int g, i;
+
+	memset(m, 0, sizeof(*m));
+	srand(seed);
+
+	m->gate_window_ps = CLOCK_PS * 3 / 4;
+	m->read_lat_base = MEM_T_RL + 1;
+	for (g = 0; g < SEQ_MODEL_GROUPS; g++) {
+		b = &m->board[g];
+		b->gate_ps = pick(3 * CLOCK_PS, 8 * CLOCK_PS);
+		for (i = 0; i < SEQ_MODEL_DQ; i++) {
+			b->read_skew_ps[i] = pick(-75, 75);
+			b->read_half_ps[i] = pick(250, 310);
+		}
+		for (i = 0; i <= SEQ_MODEL_DQ; i++) {
+			b->write_skew_ps[i] = pick(-75, 75);
+			b->write_half_ps[i] = pick(250, 310);
+		}
+	}
+
+	seq_model_warm_reset();
+}
+
+/*
+ * What a warm reset does to the PHY: delay chains, FIFOs and registers
+ * back to their reset values and the statistics restarted, while the
+ * board and the cache area stay as they were
+ */
+void seq_model_warm_reset(void)
+{
+	struct seq_model *m = &seq_model;
+
+	memset(m->staged, 0, sizeof(m->staged));
+	memset(m->live, 0, sizeof(m->live));
+	memset(m->load_pins, 0, sizeof(m->load_pins));
+	memset(m->vfifo, 0, sizeof(m->vfifo));
+	memset(m->regs, 0, sizeof(m->regs));
+	memset(m->stats, 0, sizeof(m->stats));
+	memset(m->routine, 0, sizeof(m->routine));
+	memset(&m->rom, 0, sizeof(m->rom));
+	m->scc_group = m->load_group = 0;
+	m->read_lat = m->fail_mask = 0;
+	m->rom_loaded = 0;
+	m->stage = 0;
+
+	m->regs[(DATA_MGR_MEM_T_WL & 0xfffff) / 4] = MEM_T_WL;
+	m->regs[(DATA_MGR_MEM_T_RL & 0xfffff) / 4] = MEM_T_RL;
+	m->regs[(PHY_MGR_MEM_T_WL & 0xfffff) / 4] = MEM_T_WL;
+	m->regs[(PHY_MGR_MEM_T_RL & 0xfffff) / 4] = MEM_T_RL;
+	m->stage_start_ns = now_ns();
+}
+
+/*
+ * Move every eye and gate window by about ps, as temperature would:
+ * each pin gets a random share of it, in either direction
+ */
+void seq_model_drift(int ps)
+{
+	struct seq_model_board_group *b;
+	int g, i;
+
+	if (ps <= 0)
+		return;
+	for (g = 0; g < SEQ_MODEL_GROUPS; g++) {
+		b = &seq_model.board[g];
+		b->gate_ps += pick(-ps, ps);
+		for (i = 0; i < SEQ_MODEL_DQ; i++)
+			b->read_skew_ps[i] += pick(-ps, ps);
+		for (i = 0; i <= SEQ_MODEL_DQ; i++)
+			b->write_skew_ps[i] += pick(-ps, ps);
+	}
+}
+
+/*
+ * Narrow the read eye of the first DQ pin of every group to ps wide,
+ * with the tap the sequencer first reads it at, IO_DQS_IN_RESERVE, one
+ * tap inside its edge.  With ps about COARSE_EDGE_SEARCH_STEP taps, the
+ * coarse edge search passes it at that one tap, where noise can fail the
+ * full test of it.
+ */
+void seq_model_narrow(int ps)
+{
+	struct seq_model_board_group *b;
+	int g;
+
+	if (ps <= 0)
+		return;
+	for (g = 0; g < SEQ_MODEL_GROUPS; g++) {
+		b = &seq_model.board[g];
+		b->read_half_ps[0] = ps / 2;
+		b->read_skew_ps[0] = -IO_DQS_IN_RESERVE *
+			IO_DELAY_PER_DCHAIN_TAP + ps / 2 -
+			IO_DELAY_PER_DCHAIN_TAP;
+	}
+}
+
+/*
+ * Start or stop treating the memory as holding data.  Starting also
+ * restarts the statistics, so they show what the sequencer did on
+ * memory in use.
+ */
+void seq_model_in_use(int in_use)
+{
+	struct seq_model *m = &seq_model;
+
+	if (in_use) {
+		memset(m->stats, 0, sizeof(m->stats));
+		memset(m->routine, 0, sizeof(m->routine));
+		m->stage_start_ns = now_ns();
+		m->refreshed = 0;
+		m->in_use_inits = m->in_use_unrefreshed = 0;
+		m->in_use_refreshes = m->in_use_rows = 0;
+	}
+	m->in_use = in_use;
+}
+
+/*
+ * The least read margin of any DQ pin at the live settings, in ps: how
+ * far the DQS edge sits inside the pin's eye, negative where it is out
+ */
+int seq_model_read_margin(void)
+{
+	const struct seq_model_group_regs *r;
+	const struct seq_model_board_group *b;
+	int g, i, s, margin = 0x7fffffff;
+
+	for (g = 0; g < SEQ_MODEL_GROUPS; g++) {
+		r = &seq_model.live[g];
+		b = &seq_model.board[g];
+		for (i = 0; i < SEQ_MODEL_DQ; i++) {
+			s = ((int)r->dqs_in - (int)r->io_in[i]) *
+				IO_DELAY_PER_DCHAIN_TAP + b->read_skew_ps[i];
+			if (b->read_half_ps[i] - abs(s) < margin)
+				margin = b->read_half_ps[i] - abs(s);
+		}
+	}
+	return margin;
+}
+
+/* The same for writes, from the DQS output edge */
+int seq_model_write_margin(void)
+{
+	const struct seq_model_group_regs *r;
+	const struct seq_model_board_group *b;
+	int g, i, s, margin = 0x7fffffff;
+
+	for (g = 0; g < SEQ_MODEL_GROUPS; g++) {
+		r = &seq_model.live[g];
+		b = &seq_model.board[g];
+		for (i = 0; i < SEQ_MODEL_DQ; i++) {
+			s = ((int)r->io_out1[SEQ_MODEL_DQS_PIN] -
+			     (int)r->io_out1[i]) * IO_DELAY_PER_DCHAIN_TAP +
+				b->write_skew_ps[i];
+			if (b->write_half_ps[i] - abs(s) < margin)
+				margin = b->write_half_ps[i] - abs(s);
+		}
+	}
+	return margin;
+}
+
+/*
+ * Give every burst a timing jitter, normal with a deviation of ps, drawn
+ * from a generator of its own seeded with seed: seq_model_drift's draws
+ * stay what they were.  0 turns it off.
+ */
+void seq_model_noise(int ps, unsigned int seed)
+{
+	seq_model.noise_ps = ps;
+	seq_model.noise_state = seed;
+}
+
+/* Charge the time since the last stage change to the stage that ran */
+static void close_stage(struct seq_model *m)
+{
+	unsigned long long t = now_ns();
+
+	m->stats[m->stage].ns += t - m->stage_start_ns;
+	m->stage_start_ns = t;
+}
+
+void seq_model_finish(void)
+{
+	close_stage(&seq_model);
+}
+
+/* The sequencer's own stage timer (ENABLE_CAL_TIMING) reads the same clock */
+unsigned long seq_model_timestamp(void)
+{
+	return now_ns();
+}
+
+/* Whether a group's DQS gate opens on the read burst */
+static int gate_open(const struct seq_model *m, int g)
+{
+	const struct seq_model_group_regs *r = &m->live[g];
+	int pos;
+
+	pos = m->vfifo[g] * CLOCK_PS +
+		r->dqs_en_phase * IO_DELAY_PER_OPA_TAP +
+		r->dqs_en_delay * IO_DELAY_PER_DQS_EN_DCHAIN_TAP -
+		m->board[g].gate_ps;
+	pos %= SEQ_MODEL_VFIFO * CLOCK_PS;
+	if (pos < 0)
+		pos += SEQ_MODEL_VFIFO * CLOCK_PS;
+	return pos < m->gate_window_ps;
+}
+
+/*
+ * Whether a pin sampled s ps from the center of its eye, half ps either
+ * side, fails a test of bursts bursts.  Without noise that is whether s
+ * is out of the eye.  With it, each burst is sampled at s plus its own
+ * jitter and any one sampled out of the eye fails the test, so a longer
+ * test fails more often near the edges.
+ */
+static int eye_fails(struct seq_model *m, int s, int half,
+		     unsigned long bursts)
+{
+	double sigma = m->noise_ps * M_SQRT2, ok;
+
+	if (m->noise_ps <= 0 || bursts == 0)
+		return abs(s) > half;
+	ok = 0.5 * (erfc((s - half) / sigma) - erfc((s + half) / sigma));
+	return (double)rand_r(&m->noise_state) / RAND_MAX >
+		pow(ok, bursts);
+}
+
+/* Fail mask of the read capture registers, one bit per DQ pin */
+static unsigned long read_capture(struct seq_model *m, int g)
+{
+	const struct seq_model_group_regs *r = &m->live[g];
+	const struct seq_model_board_group *b = &m->board[g];
+	unsigned long fail = 0;
+	int i, s;
+
+	for (i = 0; i < SEQ_MODEL_DQ; i++) {
+		s = ((int)r->dqs_in - (int)r->io_in[i]) *
+			IO_DELAY_PER_DCHAIN_TAP + b->read_skew_ps[i];
+		if (eye_fails(m, s, b->read_half_ps[i], m->read_bursts))
+			fail |= 1UL << i;
+	}
+	return fail;
+}
+
+/* The same for the data the DRAM latched on a write */
+static unsigned long write_capture(struct seq_model *m, int g)
+{
+	const struct seq_model_group_regs *r = &m->live[g];
+	const struct seq_model_board_group *b = &m->board[g];
+	unsigned long fail = 0;
+	int i, s;
+
+	for (i = 0; i < SEQ_MODEL_DQ; i++) {
+		s = ((int)r->io_out1[SEQ_MODEL_DQS_PIN] - (int)r->io_out1[i]) *
+			IO_DELAY_PER_DCHAIN_TAP + b->write_skew_ps[i];
+		if (eye_fails(m, s, b->write_half_ps[i], m->write_bursts))
+			fail |= 1UL << i;
+	}
+	return fail;
+}
+
+/* A misplaced DM masks the wrong beats, which corrupts every pin */
+static int dm_ok(const struct seq_model *m, int g)
+{
+	const struct seq_model_group_regs *r = &m->live[g];
+	const struct seq_model_board_group *b = &m->board[g];
+	int s;
+
+	s = ((int)r->io_out1[SEQ_MODEL_DQS_PIN] -
+	     (int)r->io_out1[SEQ_MODEL_DM_PIN]) * IO_DELAY_PER_DCHAIN_TAP +
+		b->write_skew_ps[SEQ_MODEL_DQ];
+	return abs(s) <= b->write_half_ps[SEQ_MODEL_DQ];
+}
+
+/* The routines that test the gate and the eyes */
+static int is_test(unsigned long inst)
+{
+	return inst == __RW_MGR_READ_B2B ||
+		inst == __RW_MGR_LFSR_WR_RD_BANK_0 ||
+		inst == __RW_MGR_LFSR_WR_RD_BANK_0_WL_1 ||
+		inst == __RW_MGR_LFSR_WR_RD_DM_BANK_0 ||
+		inst == __RW_MGR_LFSR_WR_RD_DM_BANK_0_WL_1;
+}
+
+/* The routines that reset the memory or rewrite its mode registers */
+static int is_init(unsigned long inst)
+{
+	return inst == __RW_MGR_INIT_RESET_0_CKE_0 ||
+		inst == __RW_MGR_INIT_RESET_1_CKE_0 ||
+		inst == __RW_MGR_MRS0_DLL_RESET ||
+		inst == __RW_MGR_MRS0_DLL_RESET_MIRR ||
+		inst == __RW_MGR_MRS0_USER ||
+		inst == __RW_MGR_MRS0_USER_MIRR ||
+		inst == __RW_MGR_MRS1 ||
+		inst == __RW_MGR_MRS1_MIRR ||
+		inst == __RW_MGR_MRS2 ||
+		inst == __RW_MGR_MRS2_MIRR ||
+		inst == __RW_MGR_MRS3 ||
+		inst == __RW_MGR_MRS3_MIRR ||
+		inst == __RW_MGR_ZQCL;
+}
+
+/* Whether every activate in the AC ROM opens RECENTER_PATTERN_ROW */
+static int pattern_row_only(const struct seq_model *m)
+{
+	int i;
+
+	for (i = 0; i < RW_ROM_AC_WORDS; i++)
+		if (rw_rom_cmd(m->rom.ac[i]) == RW_CMD_ACT &&
+		    RW_AC_A(m->rom.ac[i]) != RECENTER_PATTERN_ROW)
+			return 0;
+	return 1;
+}
+
+/* What running inst, which activated acts rows, does to memory that
+   holds data */
+static void in_use_check(struct seq_model *m, unsigned long inst,
+			 unsigned long long acts)
+{
+	if (acts && !pattern_row_only(m))
+		m->in_use_rows++;
+	if (is_init(inst)) {
+		m->in_use_inits++;
+	} else if (inst == __RW_MGR_REFRESH_ALL) {
+		m->in_use_refreshes++;
+		m->refreshed = 1;
+	} else if (is_test(inst)) {
+		if (!m->refreshed)
+			m->in_use_unrefreshed++;
+		m->refreshed = 0;
+	}
+}
+
+/* Fail mask of one test routine on one group */
+static unsigned long run_group(struct seq_model *m, unsigned long inst, int g)
+{
+	unsigned long fail;
+
+	switch (inst) {
+	case __RW_MGR_GUARANTEED_READ:
+		/* Reads back the fixed pattern without needing the gate */
+		return read_capture(m, g);
+	case __RW_MGR_READ_B2B:
+		fail = read_capture(m, g);
+		break;
+	case __RW_MGR_LFSR_WR_RD_BANK_0:
+	case __RW_MGR_LFSR_WR_RD_BANK_0_WL_1:
+		fail = read_capture(m, g) | write_capture(m, g);
+		break;
+	case __RW_MGR_LFSR_WR_RD_DM_BANK_0:
+	case __RW_MGR_LFSR_WR_RD_DM_BANK_0_WL_1:
+		fail = read_capture(m, g) | write_capture(m, g);
+		if (!dm_ok(m, g))
+			fail = ALL_FAIL;
+		break;
+	default:
+		/* Initialization, refresh, idle loops: nothing to check */
+		return 0;
+	}
+
+	m->stats[m->stage].tests++;
+	if (!gate_open(m, g) ||
+	    m->read_lat < m->read_lat_base + m->vfifo[g])
+		return ALL_FAIL;
+	return fail;
+}
+
+/*
+ * The time a routine takes counts once however many groups it runs on:
+ * the groups run it side by side
+ */
+static void rw_mgr_run(struct seq_model *m, unsigned long inst, int g, int all)
+{
+	struct rw_rom_stats *s = &m->routine[inst % RW_ROM_INST_WORDS];
+	unsigned long long rd = s->cmds[RW_CMD_RD], wr = s->cmds[RW_CMD_WR];
+	unsigned long long act = s->cmds[RW_CMD_ACT];
+
+	m->read_bursts = m->write_bursts = 0;
+	if (m->rom_loaded) {
+		m->stats[m->stage].clocks += rw_rom_run(&m->rom, inst, s, NULL);
+		m->read_bursts = s->cmds[RW_CMD_RD] - rd;
+		m->write_bursts = s->cmds[RW_CMD_WR] - wr;
+	}
+	if (m->in_use)
+		in_use_check(m, inst, s->cmds[RW_CMD_ACT] - act);
+	if (!all) {
+		m->fail_mask = g < SEQ_MODEL_GROUPS ? run_group(m, inst, g) : 0;
+		return;
+	}
+	m->fail_mask = 0;
+	for (g = 0; g < SEQ_MODEL_GROUPS; g++)
+		m->fail_mask |= run_group(m, inst, g);
+}
+
+/* ENA marks what the next UPD moves from the staging registers */
+static void scc_update(struct seq_model *m)
+{
+	struct seq_model_group_regs *s, *l;
+	int g, i;
+
+	for (g = 0; g < SEQ_MODEL_GROUPS; g++) {
+		s = &m->staged[g];
+		l = &m->live[g];
+		if (m->load_group & 1U << g) {
+			l->dqs_in = s->dqs_in;
+			l->dqs_en_phase = s->dqs_en_phase;
+			l->dqs_en_delay = s->dqs_en_delay;
+			l->dqdqs_out_phase = s->dqdqs_out_phase;
+			l->oct_out1 = s->oct_out1;
+		}
+		for (i = 0; i < SEQ_MODEL_PINS; i++)
+			if (m->load_pins[g] & 1U << i) {
+				l->io_out1[i] = s->io_out1[i];
+				l->io_in[i] = s->io_in[i];
+			}
+		m->load_pins[g] = 0;
+	}
+	m->load_group = 0;
+	m->stats[m->stage].scc_updates++;
+}
+
+/* Pins of the current group given to an ENA: one, or all for 0xff */
+static void scc_load_pins(struct seq_model *m, unsigned long pin,
+			  unsigned int first, unsigned int count)
+{
+	unsigned int mask = (1U << count) - 1;
+
+	if (m->scc_group >= SEQ_MODEL_GROUPS)
+		return;
+	if (pin == 0xff)
+		m->load_pins[m->scc_group] |= mask << first;
+	else if (pin < count)
+		m->load_pins[m->scc_group] |= 1U << (first + pin);
+}
+
+/* Per-group register of the staging set, or NULL */
+static unsigned long *scc_reg(struct seq_model *m, unsigned long addr)
+{
+	struct seq_model_group_regs *s;
+	unsigned long base = addr & ~0xffUL, idx = (addr & 0xff) / 4;
+
+	if (base == SCC_MGR_IO_OUT1_DELAY || base == SCC_MGR_IO_IN_DELAY) {
+		if (m->scc_group >= SEQ_MODEL_GROUPS || idx >= SEQ_MODEL_PINS)
+			return NULL;
+		s = &m->staged[m->scc_group];
+		return base == SCC_MGR_IO_IN_DELAY ? &s->io_in[idx] :
+			&s->io_out1[idx];
+	}
+
+	if (idx >= SEQ_MODEL_GROUPS)
+		return NULL;
+	s = &m->staged[idx];
+	switch (base) {
+	case SCC_MGR_DQS_IN_DELAY:
+		return &s->dqs_in;
+	case SCC_MGR_DQS_EN_PHASE:
+		return &s->dqs_en_phase;
+	case SCC_MGR_DQS_EN_DELAY:
+		return &s->dqs_en_delay;
+	case SCC_MGR_DQDQS_OUT_PHASE:
+		return &s->dqdqs_out_phase;
+	case SCC_MGR_OCT_OUT1_DELAY:
+		return &s->oct_out1;
+	}
+	return NULL;
+}
+
+unsigned long seq_model_read(unsigned long addr)
+{
+	struct seq_model *m = &seq_model;
+	unsigned long *reg;
+
+	m->stats[m->stage].reads++;
+	addr &= 0xfffff;
+	if (addr == RW_MGR_RUN_SINGLE_GROUP)
+		return m->fail_mask;
+	if ((reg = scc_reg(m, addr)) != NULL)
+		return *reg;
+	return m->regs[addr / 4];
+}
+
+void seq_model_write(unsigned long addr, unsigned long data)
+{
+	struct seq_model *m = &seq_model;
+	unsigned long *reg;
+	unsigned int g;
+
+	m->stats[m->stage].writes++;
+	addr &= 0xfffff;
+	m->regs[addr / 4] = data;
+
+	if (addr == REG_FILE_CUR_STAGE) {
+		if ((data & 0xff) != m->stage && (data & 0xff) < SEQ_MODEL_STAGES) {
+			close_stage(m);
+			m->stage = data & 0xff;
+		}
+	} else if (addr >= RW_MGR_RUN_SINGLE_GROUP &&
+		   addr < RW_MGR_RUN_ALL_GROUPS) {
+		rw_mgr_run(m, data, (addr - RW_MGR_RUN_SINGLE_GROUP) / 4, 0);
+	} else if (addr >= RW_MGR_RUN_ALL_GROUPS &&
+		   addr < RW_MGR_LOAD_CNTR_0) {
+		rw_mgr_run(m, data, 0, 1);
+	} else if (addr >= RW_MGR_LOAD_CNTR_0 && addr <= RW_MGR_LOAD_CNTR_3) {
+		rw_rom_load_cntr(&m->rom, (addr - (RW_MGR_LOAD_CNTR_0)) / 4,
+				 data);
+	} else if (addr >= RW_MGR_LOAD_JUMP_ADD_0 &&
+		   addr <= RW_MGR_LOAD_JUMP_ADD_3) {
+		m->rom.jump_add[(addr - (RW_MGR_LOAD_JUMP_ADD_0)) / 4] = data;
+	} else if (addr >= RW_MGR_INST_ROM_WRITE &&
+		   addr < RW_MGR_INST_ROM_WRITE + RW_ROM_INST_WORDS * 4) {
+		rw_rom_load(&m->rom, 0, (addr - (RW_MGR_INST_ROM_WRITE)) / 4,
+			    data);
+		m->rom_loaded = 1;
+	} else if (addr >= RW_MGR_AC_ROM_WRITE &&
+		   addr < RW_MGR_AC_ROM_WRITE + RW_ROM_AC_WORDS * 4) {
+		rw_rom_load(&m->rom, 1, (addr - (RW_MGR_AC_ROM_WRITE)) / 4,
+			    data);
+	} else if (addr == PHY_MGR_CMD_INC_VFIFO_HARD_PHY) {
+		for (g = 0; g < SEQ_MODEL_GROUPS; g++)
+			if (data == g || data == 0xff)
+				m->vfifo[g] = (m->vfifo[g] + 1) % SEQ_MODEL_VFIFO;
+	} else if (addr == PHY_MGR_PHY_RLAT) {
+		m->read_lat = data;
+	} else if (addr == SCC_MGR_GROUP_COUNTER) {
+		m->scc_group = data;
+	} else if (addr == SCC_MGR_DQS_ENA) {
+		if (data == 0xff)
+			m->load_group = (1U << SEQ_MODEL_GROUPS) - 1;
+		else if (data < SEQ_MODEL_GROUPS)
+			m->load_group |= 1U << data;
+	} else if (addr == SCC_MGR_DQS_IO_ENA) {
+		scc_load_pins(m, 0, SEQ_MODEL_DQS_PIN, 1);
+	} else if (addr == SCC_MGR_DQ_ENA) {
+		scc_load_pins(m, data, 0, SEQ_MODEL_DQ);
+	} else if (addr == SCC_MGR_DM_ENA) {
+		scc_load_pins(m, data, SEQ_MODEL_DM_PIN, 1);
+	} else if (addr == SCC_MGR_UPD) {
+		scc_update(m);
+	} else if ((reg = scc_reg(m, addr)) != NULL) {
+		*reg = data;
+	}
+}
@@ -0,0 +1,152 @@
+/*
+ * Register-level model of the HPS SDRAM PHY managers, for running
+ * sequencer.c on a host (see sdram_io.h, SEQ_HOST)
+ *
+ * The sequencer drives the model through the same Avalon addresses it
+ * uses on the board.  The model keeps:
+ *
+ *   SCC manager   the delay-chain settings, staged per group and made
+ *                 live only by an ENA write followed by an UPD write,
+ *                 as on the scan chains
+ *   PHY manager   a VFIFO pointer per group and the read latency
+ *   RW manager    which of the instruction ROM's test routines ran on
+ *                 which group, answered with a per-DQ-pin fail mask,
+ *                 and the ROMs the sequencer loads, each routine run
+ *                 through rw_rom.h to count the AFI clocks it takes
+ *
+ * and everything else as plain read-back registers, plus a few words
+ * that a warm reset leaves alone for the calibration cache and the
+ * margin export.  Tests pass or fail from the live settings against a
+ * fixed board: each group has a DQS gate window in read round-trip time,
+ * and each DQ pin a read eye and a write eye, offset from the DQS edge
+ * by a per-pin skew.  Delays are in the picoseconds of
+ * sequencer_defines.h.
+ *
+ * seq_model_noise adds timing noise to the read and write eyes: a test's
+ * chance of failing a pin near an eye edge then grows with the bursts
+ * the routine's run through rw_rom.h reads and writes.
+ *
+ * Between seq_model_in_use(1) and seq_model_in_use(0) the memory is
+ * taken to hold data, and the model counts what would lose it: reset and
+ * mode register routines, tests run without a refresh since the last, and
+ * routines that open a row other than RECENTER_PATTERN_ROW.
+ */
+
+#ifndef _SEQ_MODEL_H
+#define _SEQ_MODEL_H
+
+#include "rw_rom.h"
+
+#define SEQ_MODEL_GROUPS	4	/* RW_MGR_MEM_IF_READ_DQS_WIDTH */
+#define SEQ_MODEL_DQ		8	/* RW_MGR_MEM_DQ_PER_READ_DQS */
+#define SEQ_MODEL_PINS		10	/* 8 DQ, DQS at 8, DM at 9 */
+#define SEQ_MODEL_DQS_PIN	8
+#define SEQ_MODEL_DM_PIN	9
+#define SEQ_MODEL_VFIFO		16	/* VFIFO_SIZE */
+#define SEQ_MODEL_STAGES	16	/* Low byte of REG_FILE_CUR_STAGE */
+#define SEQ_MODEL_CACHE_WORDS	32	/* Room for a calib_cache_t */
+#define SEQ_MODEL_MARGIN_WORDS	64	/* Room for a margin_export_t */
+#define SEQ_MODEL_TRACE_WORDS	1032	/* Room for a trace_ring_t */
+#define SEQ_MODEL_BASELINE_WORDS	16	/* Room for the tracking baseline */
+
+/* Settings held per group by the SCC manager */
+struct seq_model_group_regs {
+	unsigned long dqs_in;		/* DQS_IN_DELAY */
+	unsigned long dqs_en_phase;	/* DQS_EN_PHASE */
+	unsigned long dqs_en_delay;	/* DQS_EN_DELAY */
+	unsigned long dqdqs_out_phase;	/* DQDQS_OUT_PHASE */
+	unsigned long oct_out1;		/* OCT_OUT1_DELAY */
+	unsigned long io_out1[SEQ_MODEL_PINS];	/* IO_OUT1_DELAY by pin */
+	unsigned long io_in[SEQ_MODEL_PINS];	/* IO_IN_DELAY by pin */
+};
+
+/* What the board looks like to one group */
+struct seq_model_board_group {
+	int gate_ps;		/* Start of the DQS gate window */
+	int read_skew_ps[SEQ_MODEL_DQ];	/* DQ eye center from DQS, reads */
+	int read_half_ps[SEQ_MODEL_DQ];	/* Half the read eye */
+	int write_skew_ps[SEQ_MODEL_DQ + 1];	/* Same for writes, DM last */
+	int write_half_ps[SEQ_MODEL_DQ + 1];
+};
+
+/* Accesses and time per calibration stage (CAL_STAGE_* in sequencer.h) */
+struct seq_model_stage_stats {
+	unsigned long reads, writes;
+	unsigned long scc_updates;	/* SCC_MGR_UPD writes */
+	unsigned long tests;		/* RW manager test routines, once per
+					   group they ran on */
+	unsigned long long ns;		/* Host time spent in the stage */
+	unsigned long long clocks;	/* AFI clocks the routines ran for */
+};
+
+struct seq_model {
+	/* Board */
+	struct seq_model_board_group board[SEQ_MODEL_GROUPS];
+	int gate_window_ps;		/* Width of every DQS gate window */
+	int read_lat_base;		/* PHY_RLAT needed at VFIFO 0 */
+
+	/* SCC manager: staged and live settings */
+	unsigned long scc_group;	/* GROUP_COUNTER */
+	struct seq_model_group_regs staged[SEQ_MODEL_GROUPS];
+	struct seq_model_group_regs live[SEQ_MODEL_GROUPS];
+	unsigned int load_group;	/* Groups given DQS_ENA, by bit */
+	unsigned int load_pins[SEQ_MODEL_GROUPS];	/* Pins given an ENA */
+
+	/* PHY and RW managers */
+	unsigned int vfifo[SEQ_MODEL_GROUPS];
+	unsigned long read_lat;		/* PHY_MGR_PHY_RLAT */
+	unsigned long fail_mask;	/* Read back from the RW manager */
+	struct rw_rom rom;		/* As loaded, counters running */
+	int rom_loaded;			/* INST_ROM_WRITE since reset */
+
+	/* Timing noise (seq_model_noise) */
+	int noise_ps;			/* Deviation of each burst's jitter */
+	unsigned int noise_state;	/* rand_r state of its draws */
+	unsigned long read_bursts;	/* RD and WR commands of the routine */
+	unsigned long write_bursts;	/* running, when the ROM is loaded */
+
+	/* Everything else reads back what was last written */
+	unsigned long regs[0x100000 / 4];
+
+	/* Kept by seq_model_warm_reset(), for CALIB_CACHE_BASE,
+	   MARGIN_EXPORT_BASE, TRACE_RING_BASE and TRK_BASELINE_BASE */
+	unsigned long cache[SEQ_MODEL_CACHE_WORDS];
+	unsigned long margins[SEQ_MODEL_MARGIN_WORDS];
+	unsigned long trace[SEQ_MODEL_TRACE_WORDS];
+	unsigned long baseline[SEQ_MODEL_BASELINE_WORDS];
+
+	/* While the memory holds data (seq_model_in_use), what would have
+	   lost it */
+	int in_use;
+	int refreshed;			/* REFRESH_ALL since the last test */
+	unsigned long in_use_inits;	/* Reset and mode register routines */
+	unsigned long in_use_unrefreshed;	/* Tests with no refresh
+						   before them */
+	unsigned long in_use_refreshes;	/* REFRESH_ALL routines */
+	unsigned long in_use_rows;	/* Routines that opened a row other
+					   than RECENTER_PATTERN_ROW */
+
+	/* Statistics */
+	unsigned int stage;		/* Current CAL_STAGE_* */
+	unsigned long long stage_start_ns;
+	struct seq_model_stage_stats stats[SEQ_MODEL_STAGES];
+	struct rw_rom_stats routine[RW_ROM_INST_WORDS];	/* By where the
+							   RUN started it */
+};
+
+extern struct seq_model seq_model;
+
+void seq_model_init(unsigned int seed);
+void seq_model_warm_reset(void);
+void seq_model_drift(int ps);
+void seq_model_narrow(int ps);
+void seq_model_in_use(int in_use);
+void seq_model_noise(int ps, unsigned int seed);
+int seq_model_read_margin(void);
+int seq_model_write_margin(void);
+void seq_model_finish(void);
+unsigned long seq_model_timestamp(void);
+unsigned long seq_model_read(unsigned long addr);
+void seq_model_write(unsigned long addr, unsigned long data);
+
+#endif
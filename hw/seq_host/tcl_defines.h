@@ -0,0 +1,14 @@
+/*
+ * sequencer_defines.h for tcl_host: the same interface, with the TCL debug
+ * report and mailbox (ENABLE_TCL_DEBUG) built in
+ *
+ * sequencer_defines.h is generated with ENABLE_TCL_DEBUG 0 and is included
+ * by name from beside sequencer.c, so it cannot be shadowed on the include
+ * path.  This is included ahead of every file with -include instead, and
+ * its include guard keeps the later includes from setting the flag back.
+ */
+
+#include "sequencer_defines.h"
+
+#undef ENABLE_TCL_DEBUG
+#define ENABLE_TCL_DEBUG 1
@@ -0,0 +1,267 @@
+/*
+ * Pull the calibration report through the tclrpt debug mailbox on the host
+ *
+ * Built with ENABLE_TCL_DEBUG (tcl_defines.h) and ENABLE_TCL_BATCH, the
+ * sequencer keeps its report in debug_data and answers the mailbox from
+ * tclrpt_poll.  After calibrating against seq_model, this stands in for
+ * the TCL scripts on the far side of the JTAG master: it only reads and
+ * writes debug_data's words, and the sequencer's side of the mailbox is
+ * stepped, one tclrpt_poll, before each read of the status it waits on.
+ *
+ * The report (every group's status, DQS and DM settings, every pin's
+ * settings and margins) is pulled twice, a command at a time and in
+ * batches of up to TCLDBG_BATCH_ENTRIES, and both must answer the same.
+ * Each is reported in mailbox round trips, a command and the
+ * acknowledgement of its response, and in words moved over the link.
+ *
+ * Usage: tcl_host [-s seed] [-v]
+ *   -s  seed for the modeled board's skews (default 1)
+ *   -v  also list every query and its answer
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "sequencer_defines.h"
+#include "alt_types.h"
+#include "system.h"
+#include "sequencer.h"
+#include "tclrpt.h"
+#include "seq_model.h"
+
+#define MAX_QUERIES	256
+#define MAX_ANSWER	(MAX_QUERIES * TCLDBG_MAX_RESPONSE_WORDS)
+
+/* Far more steps than any answer takes */
+#define MAX_POLLS	16
+
+struct query {
+	alt_u32 command;
+	alt_u32 index;		/* Pin or group, command_parameters[0] */
+	alt_u32 sr;		/* Shadow register, command_parameters[1] */
+};
+
+/* What one way of pulling the report got, and what it cost */
+struct pull {
+	alt_u32 answer[MAX_ANSWER];
+	alt_u32 words[MAX_QUERIES];	/* Of answer, by query */
+	unsigned long size;
+	unsigned long round_trips;
+	unsigned long link_words;
+};
+
+static struct query query[MAX_QUERIES];
+static int queries;
+static struct pull single, batched;
+static struct pull *cur;
+
+static alt_u32 rd(volatile alt_u32 *p)
+{
+	cur->link_words++;
+	return *p;
+}
+
+static void wr(volatile alt_u32 *p, alt_u32 v)
+{
+	cur->link_words++;
+	*p = v;
+}
+
+/* The status once it is ready for a command, or has a response */
+static int wait_status(int response)
+{
+	alt_u32 s;
+	int n;
+
+	for (n = 0; n < MAX_POLLS; n++) {
+		tclrpt_poll();
+		s = rd(&debug_data->command_status);
+		if (response ? s == TCLDBG_TX_STATUS_RESPONSE_READY ||
+			       s == TCLDBG_TX_STATUS_ILLEGAL_CMD :
+			       s == TCLDBG_TX_STATUS_CMD_READY)
+			return s;
+	}
+	fprintf(stderr, "mailbox stuck at status %lu\n", s);
+	exit(1);
+}
+
+/* Send a command, returning the status it answers with */
+static alt_u32 send(alt_u32 command, const alt_u32 *param, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		wr(&debug_data->command_parameters[i], param[i]);
+	wr(&debug_data->requested_command, command);
+	return wait_status(1);
+}
+
+static void ack(void)
+{
+	wr(&debug_data->requested_command, TCLDBG_CMD_RESPONSE_ACK);
+	wait_status(0);
+	cur->round_trips++;
+}
+
+static void add(alt_u32 command, alt_u32 index, alt_u32 sr)
+{
+	query[queries].command = command;
+	query[queries].index = index;
+	query[queries].sr = sr;
+	queries++;
+}
+
+static void plan(void)
+{
+	alt_u32 sr, i;
+
+	for (sr = 0; sr < NUM_SHADOW_REGS; sr++) {
+		for (i = 0; i < RW_MGR_MEM_IF_WRITE_DQS_WIDTH; i++) {
+			add(TCLDBG_CAL_STATUS, i, sr);
+			add(TCLDBG_QUERY_DM_SETTINGS, i, sr);
+		}
+		for (i = 0; i < RW_MGR_MEM_IF_READ_DQS_WIDTH; i++)
+			add(TCLDBG_QUERY_DQS_SETTINGS, i, sr);
+		for (i = 0; i < RW_MGR_MEM_DATA_WIDTH; i++) {
+			add(TCLDBG_QUERY_DQ_SETTINGS, i, sr);
+			add(TCLDBG_QUERY_CALIB_MARGINS, i, sr);
+		}
+	}
+	add(TCLDBG_QUERY_PHY_USER_DEBUG_MODE, 0, 0);
+	add(TCLDBG_QUERY_GROUP_AS_SKIP, 0, 0);
+	add(TCLDBG_QUERY_RANK_AS_SKIP, 0, 0);
+}
+
+static void illegal(int q)
+{
+	fprintf(stderr, "query %d (command %lu %lu %lu) was illegal\n", q,
+		query[q].command, query[q].index, query[q].sr);
+	exit(1);
+}
+
+static void pull_single(void)
+{
+	alt_u32 param[2], n, i;
+	int q;
+
+	cur = &single;
+	for (q = 0; q < queries; q++) {
+		param[0] = query[q].index;
+		param[1] = query[q].sr;
+		if (send(query[q].command, param, 2) !=
+		    TCLDBG_TX_STATUS_RESPONSE_READY)
+			illegal(q);
+		n = rd(&debug_data->batch.response_words);
+		for (i = 0; i < n; i++)
+			cur->answer[cur->size++] =
+				rd(&debug_data->batch.response[i]);
+		cur->words[q] = n;
+		ack();
+	}
+}
+
+static void pull_batched(void)
+{
+	volatile debug_batch_entry_t *e;
+	alt_u32 param[1], run, n, i;
+	int q = 0;
+
+	cur = &batched;
+	while (q < queries) {
+		n = queries - q;
+		if (n > TCLDBG_BATCH_ENTRIES)
+			n = TCLDBG_BATCH_ENTRIES;
+		for (i = 0; i < n; i++) {
+			e = &debug_data->batch.entry[i];
+			wr(&e->command, query[q + i].command);
+			wr(&e->parameters[0], query[q + i].index);
+			wr(&e->parameters[1], query[q + i].sr);
+		}
+		param[0] = n;
+		if (send(TCLDBG_RUN_BATCH, param, 1) !=
+		    TCLDBG_TX_STATUS_RESPONSE_READY) {
+			fprintf(stderr, "batch of %lu was illegal\n", n);
+			exit(1);
+		}
+
+		/* The answers are in order, so only their sizes are needed */
+		run = rd(&debug_data->batch.entries_run);
+		for (i = 0; i < run; i++) {
+			e = &debug_data->batch.entry[i];
+			if (rd(&e->status) != TCLDBG_TX_STATUS_RESPONSE_READY)
+				illegal(q + i);
+			cur->words[q + i] = rd(&e->response_words);
+		}
+		n = rd(&debug_data->batch.response_words);
+		for (i = 0; i < n; i++)
+			cur->answer[cur->size++] =
+				rd(&debug_data->batch.response[i]);
+		ack();
+		q += run;
+	}
+}
+
+static void list(void)
+{
+	unsigned long at = 0;
+	alt_u32 i;
+	int q;
+
+	for (q = 0; q < queries; q++) {
+		printf("%2lu %2lu sr%lu:", query[q].command, query[q].index,
+		       query[q].sr);
+		for (i = 0; i < single.words[q]; i++)
+			printf(" %lu", single.answer[at++]);
+		printf("\n");
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int seed = 1;
+	int verbose = 0, opt;
+
+	while ((opt = getopt(argc, argv, "s:v")) != -1)
+		switch (opt) {
+		case 's':
+			seed = strtoul(optarg, NULL, 0);
+			break;
+		case 'v':
+			verbose = 1;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-s seed] [-v]\n", argv[0]);
+			return 1;
+		}
+
+	seq_model_init(seed);
+	if (!sdram_calibration()) {
+		fprintf(stderr, "calibration failed\n");
+		return 1;
+	}
+	seq_model_finish();
+
+	/* The sequencer's side, as tclrpt_loop starts */
+	tclrpt_mark_interface_as_ready();
+
+	plan();
+	pull_single();
+	pull_batched();
+	if (verbose)
+		list();
+
+	printf("%d queries, %lu words of answers\n", queries, single.size);
+	printf("one at a time: %4lu round trips, %6lu words over the link\n",
+	       single.round_trips, single.link_words);
+	printf("batched:       %4lu round trips, %6lu words over the link\n",
+	       batched.round_trips, batched.link_words);
+	if (single.size != batched.size ||
+	    memcmp(single.words, batched.words, sizeof(single.words)) ||
+	    memcmp(single.answer, batched.answer, sizeof(single.answer))) {
+		printf("the answers differ\n");
+		return 1;
+	}
+	printf("same answers\n");
+	return 0;
+}
@@ -10,7 +10,7 @@
  *        0    |  Red  |  Red component of background color (0-255)
  *        1    | Green |  Green component
  *        2    | Blue  |  Blue component
- *        3    |  ---  |  Unused
+ *        3    | Radius|  Radius of ball in pixels (reset: 16)
  *        4    | x LSB |  X coordinate of ball (least significant byte)
  *        5    | x MSB |  X coordinate of ball (most significant byte)
  *        6    | y LSB |  Y coordinate of ball (least significant byte)
@@ -40,7 +40,8 @@ module vga_ball (
 
 	logic [7:0] background_r, background_g, background_b;
 	logic [15:0] x, y;
-	logic [9:0] r;
+	logic [7:0] radius;
+	logic [15:0] r;
 
   logic [11:0] vga_x;
   logic [11:0] vga_y;
@@ -62,11 +63,13 @@ module vga_ball (
 		background_b <= 8'h80;
 		x <= 16'h0;
 		y <= 16'h0;
+		radius <= 8'd16;
 		end else if (chipselect && write)
 		case (address)
 			3'h0: background_r <= writedata;
 			3'h1: background_g <= writedata;
 			3'h2: background_b <= writedata;
+			3'h3: radius <= writedata;
 			3'h4: x[7:0] <= writedata;
 			3'h5: x[15:8] <= writedata;
 			3'h6: y[7:0] <= writedata;
@@ -74,7 +77,7 @@ module vga_ball (
 		endcase
 
 	always_comb begin
-    r = 10'd256; // radius^2 = 16^2
+    r = radius * radius;
 
     vga_x = hcount[10:1];
     vga_y = vcount[9:0];
@@ -0,0 +1,26 @@
+#ifndef _ANIM_H
+#define _ANIM_H
+
+/*
+ * Compiled vga_ball animations
+ *
+ * animc turns a keyframe description (see bounce.anim) into a stream of
+ * per-frame register deltas that animplay pushes to the device with one
+ * VGA_BALL_WRITE_REGS per frame.  All work is done at compile time:
+ * playback only copies the changed bytes out of the stream.
+ *
+ * File layout, multi-byte fields little-endian:
+ *
+ *   header   "VGAA", u8 version, u8 nregs, u16 reserved,
+ *            u32 frames, u32 stream bytes
+ *   stream   per frame: u8 mask, then one byte for each set mask bit,
+ *            lowest register first; mask 0 means nothing changed.
+ *            The first frame writes every register, so the stream can
+ *            be started, or looped, from any device state.
+ */
+
+#define ANIM_MAGIC       "VGAA"
+#define ANIM_VERSION     1
+#define ANIM_HEADER_SIZE 16
+
+#endif
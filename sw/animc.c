@@ -0,0 +1,315 @@
+/*
+ * Keyframe animation compiler for vga_ball
+ *
+ * Reads a text description of an animation and writes the register
+ * stream described in anim.h.  The description is a list of lines; '#'
+ * starts a comment:
+ *
+ *   frames N                 length in display frames (16.8 ms each);
+ *                            defaults to one past the last key
+ *   key F name=value ...     keyframe at frame F, in increasing order
+ *
+ * where the names are
+ *   x=, y=      ball centre in pixels (0-1023)
+ *   r=          ball radius in pixels (0-255)
+ *   bg=RRGGBB   background color, in hex
+ *   ease=       linear (default), in, out or inout: the shape of the
+ *               move into this key for the properties it sets
+ *
+ * Each property is interpolated on its own between the keys that set it
+ * and holds its first or last value outside them.  A property no key
+ * sets keeps the state the driver leaves after probing.
+ *
+ * Usage: animc [-v] input.anim output.vgaa
+ *   -v  report stream size and bus writes per frame
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include "vga_ball.h"
+#include "anim.h"
+
+enum { T_X, T_Y, T_R, T_RED, T_GREEN, T_BLUE, NTRACKS };
+enum { EASE_LINEAR, EASE_IN, EASE_OUT, EASE_INOUT };
+
+struct key {
+    long frame;
+    double value;
+    int ease;          /* Shape of the segment that ends at this key */
+};
+
+struct track {
+    double initial;    /* Value when no key sets the property */
+    double max;        /* Largest value its register can hold */
+    struct key *keys;
+    int n, cap;
+};
+
+static struct track tracks[NTRACKS] = {
+    [T_X]     = { 0, 1023 },
+    [T_Y]     = { 0, 1023 },
+    [T_R]     = { 16, 255 },
+    [T_RED]   = { 0xf9, 255 },
+    [T_GREEN] = { 0xe4, 255 },
+    [T_BLUE]  = { 0xb7, 255 },
+};
+
+static const char *path;
+static int lineno;
+
+static void die(const char *msg)
+{
+    fprintf(stderr, "%s:%d: %s\n", path, lineno, msg);
+    exit(1);
+}
+
+static void add_key(int t, long frame, double value, int ease)
+{
+    struct track *tr = &tracks[t];
+
+    if (value < 0 || value > tr->max)
+        die("value out of range");
+    if (tr->n == tr->cap)
+    {
+        tr->cap = tr->cap ? 2 * tr->cap : 16;
+        if ((tr->keys = realloc(tr->keys, tr->cap * sizeof(*tr->keys))) == NULL)
+            die("out of memory");
+    }
+    tr->keys[tr->n].frame = frame;
+    tr->keys[tr->n].value = value;
+    tr->keys[tr->n].ease = ease;
+    tr->n++;
+}
+
+static double number(const char *s)
+{
+    char *end;
+    double v = strtod(s, &end);
+
+    if (end == s || *end)
+        die("expected a number");
+    return v;
+}
+
+/* One line of the description; *last_key is the previous key's frame */
+static void parse_line(char *line, long *frames, long *last_key)
+{
+    static const char *const ease_names[] = { "linear", "in", "out", "inout" };
+    static const char *const ws = " \t\r\n";
+    double value[NTRACKS];
+    int set[NTRACKS] = { 0 };
+    int ease = EASE_LINEAR, t;
+    char *tok, *val, *end;
+    unsigned long rgb;
+    long frame;
+
+    if ((tok = strchr(line, '#')) != NULL)
+        *tok = '\0';
+    if ((tok = strtok(line, ws)) == NULL)
+        return;
+
+    if (strcmp(tok, "frames") == 0)
+    {
+        if ((tok = strtok(NULL, ws)) == NULL ||
+            (*frames = strtol(tok, &end, 10)) <= 0 || *end)
+            die("frames needs a positive count");
+        return;
+    }
+    if (strcmp(tok, "key") != 0)
+        die("expected 'frames' or 'key'");
+
+    if ((tok = strtok(NULL, ws)) == NULL ||
+        (frame = strtol(tok, &end, 10)) < 0 || *end)
+        die("key needs a frame number");
+    if (frame <= *last_key)
+        die("keys must be in increasing frame order");
+    *last_key = frame;
+
+    while ((tok = strtok(NULL, ws)) != NULL)
+    {
+        if ((val = strchr(tok, '=')) == NULL)
+            die("expected name=value");
+        *val++ = '\0';
+
+        if (strcmp(tok, "x") == 0)
+            value[T_X] = number(val), set[T_X] = 1;
+        else if (strcmp(tok, "y") == 0)
+            value[T_Y] = number(val), set[T_Y] = 1;
+        else if (strcmp(tok, "r") == 0)
+            value[T_R] = number(val), set[T_R] = 1;
+        else if (strcmp(tok, "bg") == 0)
+        {
+            rgb = strtoul(val, &end, 16);
+            if (strlen(val) != 6 || *end)
+                die("bg needs six hex digits");
+            value[T_RED] = rgb >> 16;
+            value[T_GREEN] = (rgb >> 8) & 0xff;
+            value[T_BLUE] = rgb & 0xff;
+            set[T_RED] = set[T_GREEN] = set[T_BLUE] = 1;
+        }
+        else if (strcmp(tok, "ease") == 0)
+        {
+            for (ease = 0; ease < 4 && strcmp(val, ease_names[ease]); ease++)
+                ;
+            if (ease == 4)
+                die("ease is linear, in, out or inout");
+        }
+        else
+            die("unknown property");
+    }
+
+    for (t = 0; t < NTRACKS; t++)
+        if (set[t])
+            add_key(t, frame, value[t], ease);
+}
+
+static double eased(int ease, double t)
+{
+    switch (ease)
+    {
+    case EASE_IN:
+        return t * t;
+    case EASE_OUT:
+        return t * (2 - t);
+    case EASE_INOUT:
+        return t * t * (3 - 2 * t);
+    }
+    return t;
+}
+
+/* Value of a property at a frame; *cur remembers the segment reached */
+static int track_value(const struct track *tr, long frame, int *cur)
+{
+    const struct key *a, *b;
+    double t;
+
+    if (tr->n == 0)
+        return lround(tr->initial);
+    while (*cur < tr->n && tr->keys[*cur].frame <= frame)
+        (*cur)++;
+    if (*cur == 0)
+        return lround(tr->keys[0].value);
+    if (*cur == tr->n)
+        return lround(tr->keys[tr->n - 1].value);
+
+    a = &tr->keys[*cur - 1];
+    b = &tr->keys[*cur];
+    t = (double)(frame - a->frame) / (b->frame - a->frame);
+    return lround(a->value + (b->value - a->value) * eased(b->ease, t));
+}
+
+static void put_u32(unsigned char *p, unsigned long v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned char header[ANIM_HEADER_SIZE] = {
+        'V', 'G', 'A', 'A', ANIM_VERSION, VGA_BALL_NREGS, 0, 0
+    };
+    unsigned char regs[VGA_BALL_NREGS], prev[VGA_BALL_NREGS];
+    unsigned char *stream, *p, mask;
+    int cur[NTRACKS] = { 0 };
+    long frames = 0, last_key = -1, frame, writes = 0, ioctls = 0;
+    char line[1024];
+    int verbose = 0, opt, i;
+    unsigned int x, y;
+    FILE *in, *out;
+
+    while ((opt = getopt(argc, argv, "v")) != -1)
+        switch (opt)
+        {
+        case 'v':
+            verbose = 1;
+            break;
+        default:
+            goto usage;
+        }
+    if (optind != argc - 2)
+        goto usage;
+
+    path = argv[optind];
+    if ((in = fopen(path, "r")) == NULL)
+    {
+        perror(path);
+        return 1;
+    }
+    while (fgets(line, sizeof(line), in))
+    {
+        lineno++;
+        parse_line(line, &frames, &last_key);
+    }
+    fclose(in);
+    if (frames == 0)
+        frames = last_key + 1;
+    if (frames == 0)
+        die("no keys and no frame count");
+
+    /* Worst case every register changes on every frame */
+    if ((stream = malloc(frames * (1 + VGA_BALL_NREGS))) == NULL)
+        die("out of memory");
+
+    for (p = stream, frame = 0; frame < frames; frame++)
+    {
+        /*
+         * Positions go to whole pixels: the peripheral ignores the six
+         * fraction bits, and leaving them clear keeps the LSBs from
+         * changing on frames where the picture does not
+         */
+        x = track_value(&tracks[T_X], frame, &cur[T_X]) << 6;
+        y = track_value(&tracks[T_Y], frame, &cur[T_Y]) << 6;
+        regs[VGA_BALL_REG_RED] = track_value(&tracks[T_RED], frame, &cur[T_RED]);
+        regs[VGA_BALL_REG_GREEN] = track_value(&tracks[T_GREEN], frame, &cur[T_GREEN]);
+        regs[VGA_BALL_REG_BLUE] = track_value(&tracks[T_BLUE], frame, &cur[T_BLUE]);
+        regs[VGA_BALL_REG_RADIUS] = track_value(&tracks[T_R], frame, &cur[T_R]);
+        regs[VGA_BALL_REG_X_LSB] = x;
+        regs[VGA_BALL_REG_X_MSB] = x >> 8;
+        regs[VGA_BALL_REG_Y_LSB] = y;
+        regs[VGA_BALL_REG_Y_MSB] = y >> 8;
+
+        for (mask = 0, i = 0; i < VGA_BALL_NREGS; i++)
+            if (frame == 0 || regs[i] != prev[i])
+                mask |= 1 << i;
+        *p++ = mask;
+        for (i = 0; i < VGA_BALL_NREGS; i++)
+            if (mask & (1 << i))
+            {
+                *p++ = regs[i];
+                writes++;
+            }
+        ioctls += mask != 0;
+        memcpy(prev, regs, sizeof(prev));
+    }
+
+    put_u32(header + 8, frames);
+    put_u32(header + 12, p - stream);
+    if ((out = fopen(argv[optind + 1], "wb")) == NULL)
+    {
+        perror(argv[optind + 1]);
+        return 1;
+    }
+    if (fwrite(header, sizeof(header), 1, out) != 1 ||
+        fwrite(stream, p - stream, 1, out) != 1 || fclose(out))
+    {
+        perror(argv[optind + 1]);
+        return 1;
+    }
+
+    if (verbose)
+        printf("%ld frames, %ld stream bytes, %ld register writes in "
+               "%ld ioctls (%.2f writes/frame)\n", frames, (long)(p - stream),
+               writes, ioctls, (double)writes / frames);
+    free(stream);
+    return 0;
+
+usage:
+    fprintf(stderr, "usage: %s [-v] input.anim output.vgaa\n", argv[0]);
+    return 1;
+}
@@ -0,0 +1,197 @@
+/*
+ * Play a compiled vga_ball animation (see anim.h and animc)
+ *
+ * Maps the stream, checks it once up front, then at the start of every
+ * VGA frame copies that frame's changed registers into a single
+ * VGA_BALL_WRITE_REGS.  A frame where nothing changed costs no system
+ * call at all.
+ *
+ * Usage: animplay [-m] [-f] [-d device] [-l loops] file.vgaa
+ *   -m  play into the software model and report its bus writes
+ *   -f  do not wait for frames, to measure the playback cost itself
+ *   -l  play this many times, 0 for until interrupted (default 1)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "anim.h"
+#include "vga_trace.h"
+#include "vga_model.h"
+#include "frame_sched.h"
+
+static volatile sig_atomic_t done;
+
+static void handle_sigint(int sig)
+{
+    done = 1;
+}
+
+static unsigned long get_u32(const unsigned char *p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (unsigned long)p[3] << 24;
+}
+
+/*
+ * Map an animation and return its stream, or NULL if the file is not
+ * one or any frame would run past the end: playback does not check
+ */
+static const unsigned char *load_anim(const char *path, unsigned long *frames)
+{
+    const unsigned char *data, *p, *end;
+    unsigned long f, size;
+    struct stat st;
+    unsigned char mask;
+    int fd, i;
+
+    if ((fd = open(path, O_RDONLY)) == -1 || fstat(fd, &st) == -1)
+        return NULL;
+    if (st.st_size < ANIM_HEADER_SIZE)
+    {
+        close(fd);
+        return NULL;
+    }
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return NULL;
+
+    *frames = get_u32(data + 8);
+    size = get_u32(data + 12);
+    if (memcmp(data, ANIM_MAGIC, 4) || data[4] != ANIM_VERSION ||
+        data[5] != VGA_BALL_NREGS || size != st.st_size - ANIM_HEADER_SIZE)
+        goto bad;
+
+    p = data + ANIM_HEADER_SIZE;
+    end = p + size;
+    for (f = 0; f < *frames; f++)
+    {
+        if (p == end)
+            goto bad;
+        mask = *p++;
+        for (i = 0; i < VGA_BALL_NREGS; i++)
+            p += (mask >> i) & 1;
+        if (p > end)
+            goto bad;
+    }
+    if (p == end)
+        return data + ANIM_HEADER_SIZE;
+
+bad:
+    munmap((void *)data, st.st_size);
+    return NULL;
+}
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *device = "/dev/vga_ball";
+    const unsigned char *stream, *p;
+    unsigned long frames, f, played = 0, ioctls = 0, errors = 0;
+    int use_model = 0, fast = 0, fd = -1, opt, i;
+    long loops = 1, loop;
+    struct vga_model model;
+    struct frame_sched fs;
+    vga_ball_regs_t r;
+    long long start, elapsed;
+
+    while ((opt = getopt(argc, argv, "mfd:l:")) != -1)
+        switch (opt)
+        {
+        case 'm':
+            use_model = 1;
+            break;
+        case 'f':
+            fast = 1;
+            break;
+        case 'd':
+            device = optarg;
+            break;
+        case 'l':
+            loops = atol(optarg);
+            break;
+        default:
+            goto usage;
+        }
+    if (optind != argc - 1)
+        goto usage;
+
+    if ((stream = load_anim(argv[optind], &frames)) == NULL)
+    {
+        fprintf(stderr, "%s: not a vga_ball animation\n", argv[optind]);
+        return 1;
+    }
+
+    if (use_model)
+        vga_model_init(&model);
+    else if ((fd = open(device, O_RDWR)) == -1)
+    {
+        fprintf(stderr, "could not open %s\n", device);
+        return 1;
+    }
+
+    // Log every command for vga_replay if asked to
+    const char *trace = getenv("VGA_BALL_TRACE");
+    if (trace && vga_trace_start(trace))
+        fprintf(stderr, "could not open trace %s\n", trace);
+
+    signal(SIGINT, handle_sigint);
+    frame_sched_init(&fs, VGA_FRAME_NS);
+    start = now_ns();
+
+    for (loop = 0; !done && (loops == 0 || loop < loops); loop++)
+        for (p = stream, f = 0; f < frames && !done; f++, played++)
+        {
+            if (!fast)
+                frame_sched_wait(&fs);
+            if ((r.mask = *p++) == 0)
+                continue;
+            for (i = 0; i < VGA_BALL_NREGS; i++)
+                if (r.mask & (1 << i))
+                    r.regs[i] = *p++;
+
+            if (use_model)
+                errors += vga_model_ioctl(&model, VGA_BALL_WRITE_REGS, &r) != 0;
+            else
+                errors += vga_trace_ioctl(fd, VGA_BALL_WRITE_REGS, &r) != 0;
+            ioctls++;
+        }
+    elapsed = now_ns() - start;
+
+    vga_trace_stop();
+    printf("frames: %lu  ioctls: %lu  errors: %lu  elapsed: %.3f s\n",
+           played, ioctls, errors, elapsed / 1e9);
+    if (fast && played)
+        printf("playback cost: %lld ns/frame\n", elapsed / (long long)played);
+    else if (!fast)
+        frame_sched_report(&fs, stdout);
+    if (use_model)
+        printf("model: %lu bus writes (%.2f/frame), bg %02x %02x %02x, "
+               "r %u, x %04x y %04x\n", model.bus_writes,
+               played ? (double)model.bus_writes / played : 0.0,
+               model.background.red, model.background.green,
+               model.background.blue, model.radius,
+               model.position.x, model.position.y);
+
+    if (fd != -1)
+        close(fd);
+    return errors != 0;
+
+usage:
+    fprintf(stderr, "usage: %s [-m] [-f] [-d device] [-l loops] file.vgaa\n",
+            argv[0]);
+    return 1;
+}
@@ -0,0 +1,300 @@
+/*
+ * Structure-of-arrays ball physics with vectorized integration and a
+ * uniform-grid spatial hash for collisions
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "ball_physics.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define BALL_SIMD_NEON
+const char ball_physics_simd_name[] = "neon";
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define BALL_SIMD_SSE
+const char ball_physics_simd_name[] = "sse2";
+#else
+const char ball_physics_simd_name[] = "none";
+#endif
+
+/* Vector loads assume 16-byte alignment */
+static float *alloc_floats(int n)
+{
+    void *p;
+
+    if (posix_memalign(&p, 16, n * sizeof(float)))
+        return NULL;
+    return p;
+}
+
+int ball_world_init(struct ball_world *w, int cap,
+                    float width, float height, float radius)
+{
+    int cells;
+
+    memset(w, 0, sizeof(*w));
+    w->cap = cap;
+    w->width = width;
+    w->height = height;
+    w->radius = radius;
+    w->simd = 1;
+
+    w->cell = 2 * radius;
+    w->grid_w = (int)(width / w->cell) + 1;
+    w->grid_h = (int)(height / w->cell) + 1;
+    cells = w->grid_w * w->grid_h;
+
+    w->x = alloc_floats(cap);
+    w->y = alloc_floats(cap);
+    w->dx = alloc_floats(cap);
+    w->dy = alloc_floats(cap);
+    w->cell_start = malloc((cells + 1) * sizeof(int));
+    w->cell_ball = malloc(cap * sizeof(int));
+    w->ball_cell = malloc(cap * sizeof(int));
+
+    if (!w->x || !w->y || !w->dx || !w->dy ||
+        !w->cell_start || !w->cell_ball || !w->ball_cell)
+    {
+        ball_world_free(w);
+        return -1;
+    }
+    return 0;
+}
+
+void ball_world_free(struct ball_world *w)
+{
+    free(w->x);
+    free(w->y);
+    free(w->dx);
+    free(w->dy);
+    free(w->cell_start);
+    free(w->cell_ball);
+    free(w->ball_cell);
+    memset(w, 0, sizeof(*w));
+}
+
+/* Returns the new ball's index, or -1 if the world is full */
+int ball_world_add(struct ball_world *w, float x, float y, float dx, float dy)
+{
+    if (w->n == w->cap)
+        return -1;
+    w->x[w->n] = x;
+    w->y[w->n] = y;
+    w->dx[w->n] = dx;
+    w->dy[w->n] = dy;
+    return w->n++;
+}
+
+/*
+ * Advance one coordinate of balls [from, to) and bounce any that left
+ * [lo, hi] back inside, reversing their velocity
+ */
+static void move_axis_scalar(float *p, float *v, int from, int to,
+                             float lo, float hi)
+{
+    int i;
+
+    for (i = from; i < to; i++)
+    {
+        float q = p[i] + v[i];
+
+        if (q < lo)
+        {
+            q = 2 * lo - q;
+            v[i] = -v[i];
+        }
+        else if (q > hi)
+        {
+            q = 2 * hi - q;
+            v[i] = -v[i];
+        }
+        p[i] = q;
+    }
+}
+
+#if defined(BALL_SIMD_NEON)
+
+/* Four balls per iteration; returns how many were handled */
+static int move_axis_simd(float *p, float *v, int n, float lo, float hi)
+{
+    float32x4_t vlo = vdupq_n_f32(lo), vhi = vdupq_n_f32(hi);
+    float32x4_t lo2 = vdupq_n_f32(2 * lo), hi2 = vdupq_n_f32(2 * hi);
+    int i;
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        float32x4_t vel = vld1q_f32(v + i);
+        float32x4_t q = vaddq_f32(vld1q_f32(p + i), vel);
+        uint32x4_t under = vcltq_f32(q, vlo);
+        uint32x4_t over = vcgtq_f32(q, vhi);
+
+        q = vbslq_f32(under, vsubq_f32(lo2, q), q);
+        q = vbslq_f32(over, vsubq_f32(hi2, q), q);
+        vel = vbslq_f32(vorrq_u32(under, over), vnegq_f32(vel), vel);
+        vst1q_f32(p + i, q);
+        vst1q_f32(v + i, vel);
+    }
+    return i;
+}
+
+#elif defined(BALL_SIMD_SSE)
+
+static inline __m128 select_ps(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+/* Four balls per iteration; returns how many were handled */
+static int move_axis_simd(float *p, float *v, int n, float lo, float hi)
+{
+    __m128 vlo = _mm_set1_ps(lo), vhi = _mm_set1_ps(hi);
+    __m128 lo2 = _mm_set1_ps(2 * lo), hi2 = _mm_set1_ps(2 * hi);
+    __m128 sign = _mm_set1_ps(-0.0f);
+    int i;
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        __m128 vel = _mm_load_ps(v + i);
+        __m128 q = _mm_add_ps(_mm_load_ps(p + i), vel);
+        __m128 under = _mm_cmplt_ps(q, vlo);
+        __m128 over = _mm_cmpgt_ps(q, vhi);
+
+        q = select_ps(under, _mm_sub_ps(lo2, q), q);
+        q = select_ps(over, _mm_sub_ps(hi2, q), q);
+        vel = _mm_xor_ps(vel, _mm_and_ps(_mm_or_ps(under, over), sign));
+        _mm_store_ps(p + i, q);
+        _mm_store_ps(v + i, vel);
+    }
+    return i;
+}
+
+#else
+
+static int move_axis_simd(float *p, float *v, int n, float lo, float hi)
+{
+    return 0;
+}
+
+#endif
+
+/* Move every ball one step and reflect it off the edges of the box */
+void ball_world_integrate(struct ball_world *w)
+{
+    float r = w->radius;
+    int done_x = 0, done_y = 0;
+
+    if (w->simd)
+    {
+        done_x = move_axis_simd(w->x, w->dx, w->n, r, w->width - r);
+        done_y = move_axis_simd(w->y, w->dy, w->n, r, w->height - r);
+    }
+    move_axis_scalar(w->x, w->dx, done_x, w->n, r, w->width - r);
+    move_axis_scalar(w->y, w->dy, done_y, w->n, r, w->height - r);
+}
+
+static inline int clamp_cell(float p, float cell, int max)
+{
+    int c = (int)(p / cell);
+
+    return c < 0 ? 0 : c >= max ? max - 1 : c;
+}
+
+/* Sort balls into grid cells with a counting sort */
+static void build_grid(struct ball_world *w)
+{
+    int cells = w->grid_w * w->grid_h;
+    int i, c, sum = 0;
+
+    memset(w->cell_start, 0, (cells + 1) * sizeof(int));
+    for (i = 0; i < w->n; i++)
+    {
+        c = clamp_cell(w->y[i], w->cell, w->grid_h) * w->grid_w +
+            clamp_cell(w->x[i], w->cell, w->grid_w);
+        w->ball_cell[i] = c;
+        w->cell_start[c]++;
+    }
+
+    /* cell_start[c] becomes the end of cell c, then counts back down */
+    for (c = 0; c < cells; c++)
+    {
+        sum += w->cell_start[c];
+        w->cell_start[c] = sum;
+    }
+    w->cell_start[cells] = w->n;
+    for (i = w->n - 1; i >= 0; i--)
+        w->cell_ball[--w->cell_start[w->ball_cell[i]]] = i;
+}
+
+/* Elastic collision between two equal-mass balls, if they touch */
+static inline void resolve(struct ball_world *w, int a, int b, float dmin2)
+{
+    float nx = w->x[b] - w->x[a];
+    float ny = w->y[b] - w->y[a];
+    float d2 = nx * nx + ny * ny;
+    float dot, k;
+
+    if (d2 >= dmin2 || d2 == 0)
+        return;
+
+    /* Only bounce balls that are moving toward each other */
+    dot = (w->dx[b] - w->dx[a]) * nx + (w->dy[b] - w->dy[a]) * ny;
+    if (dot >= 0)
+        return;
+
+    /* Exchange the velocity components along the line of centers */
+    k = dot / d2;
+    w->dx[a] += k * nx;
+    w->dy[a] += k * ny;
+    w->dx[b] -= k * nx;
+    w->dy[b] -= k * ny;
+    w->collisions++;
+}
+
+/* Test each pair once against the cell itself and four of its neighbors */
+static void collide_cells(struct ball_world *w, int c, int d, float dmin2)
+{
+    int i, j;
+
+    for (i = w->cell_start[c]; i < w->cell_start[c + 1]; i++)
+        for (j = (c == d ? i + 1 : w->cell_start[d]);
+             j < w->cell_start[d + 1]; j++)
+            resolve(w, w->cell_ball[i], w->cell_ball[j], dmin2);
+}
+
+void ball_world_collide(struct ball_world *w)
+{
+    float dmin2 = 4 * w->radius * w->radius;
+    int k, c;
+
+    build_grid(w);
+
+    /* Walk the balls in cell order so empty cells cost nothing */
+    for (k = 0; k < w->n; k = w->cell_start[c + 1])
+    {
+        int cx, cy;
+
+        c = w->ball_cell[w->cell_ball[k]];
+        cx = c % w->grid_w;
+        cy = c / w->grid_w;
+
+        collide_cells(w, c, c, dmin2);
+        if (cx + 1 < w->grid_w)
+            collide_cells(w, c, c + 1, dmin2);
+        if (cy + 1 < w->grid_h)
+        {
+            if (cx > 0)
+                collide_cells(w, c, c + w->grid_w - 1, dmin2);
+            collide_cells(w, c, c + w->grid_w, dmin2);
+            if (cx + 1 < w->grid_w)
+                collide_cells(w, c, c + w->grid_w + 1, dmin2);
+        }
+    }
+}
+
+void ball_world_step(struct ball_world *w)
+{
+    ball_world_integrate(w);
+    ball_world_collide(w);
+}
@@ -0,0 +1,42 @@
+#ifndef _BALL_PHYSICS_H
+#define _BALL_PHYSICS_H
+
+/*
+ * Many-ball physics in structure-of-arrays layout
+ *
+ * All balls share one radius and bounce inside a width x height box.
+ * Each step integrates positions and reflects off the edges four balls
+ * at a time (NEON on ARM, SSE on x86, scalar elsewhere), then resolves
+ * ball-ball collisions using a uniform grid whose cells are one ball
+ * diameter across, so only neighboring cells need to be compared.
+ */
+
+struct ball_world {
+    int n, cap;
+    float *x, *y;      /* Centers, in pixels */
+    float *dx, *dy;    /* Velocities, in pixels per step */
+    float radius;
+    float width, height;
+    int simd;          /* Use the vector integrator if one was compiled in */
+
+    /* Spatial hash: balls sorted by cell, rebuilt every step */
+    float cell;        /* Cell edge length */
+    int grid_w, grid_h;
+    int *cell_start;   /* grid_w * grid_h + 1 offsets into cell_ball */
+    int *cell_ball;    /* Ball indices grouped by cell */
+    int *ball_cell;    /* Cell of each ball */
+
+    unsigned long collisions;  /* Ball-ball contacts resolved so far */
+};
+
+extern const char ball_physics_simd_name[];
+
+int ball_world_init(struct ball_world *w, int cap,
+                    float width, float height, float radius);
+void ball_world_free(struct ball_world *w);
+int ball_world_add(struct ball_world *w, float x, float y, float dx, float dy);
+void ball_world_integrate(struct ball_world *w);
+void ball_world_collide(struct ball_world *w);
+void ball_world_step(struct ball_world *w);
+
+#endif
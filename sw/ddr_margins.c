@@ -0,0 +1,188 @@
+/*
+ * Print the DDR read and write margins the preloader measured at boot
+ *
+ * A preloader built with ENABLE_MARGIN_EXPORT (see the sequencer in
+ * hw/hps_isw_handoff) sweeps every DQ and DM pin away from its
+ * calibrated delay and leaves how far each one could go at
+ * MARGIN_EXPORT_BASE, on-chip RAM the board reserves for it.  This reads
+ * that record through /dev/mem, or from a file holding a copy of it
+ * (seq_host -m writes one), checks it and prints one CSV line per pin and
+ * direction:
+ *
+ *   rank,group,pin,path,left_taps,right_taps,left_ps,right_ps
+ *
+ * where path is read, write or dm, left is the margin found by delaying
+ * the pin and right the margin found by delaying its DQS.  rank counts
+ * shadow register sets, one per rank on boards that have them.
+ *
+ * Usage: ddr_margins [-a address | -f file]
+ *   -a  physical address of the record, the preloader's MARGIN_EXPORT_BASE;
+ *       the DE1-SoC's (see sdram_io.h) by default
+ *   -f  read the record from a file instead of memory
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#define MARGIN_EXPORT_MAGIC 0x3147524d      /* "MRG1" */
+#define MARGIN_EXPORT_BASE  0xFFFFD600      /* this board's */
+#define MARGIN_MAX_SIZE     256
+
+/* The fixed part of the sequencer's margin_export_t */
+struct margin_header {
+    uint32_t magic;
+    uint16_t size;
+    uint16_t tap_ps;
+    uint8_t shadow_regs;
+    uint8_t groups;
+    uint8_t dq_per_group;
+    uint8_t dm_per_group;
+};
+
+static uint32_t crc32(const uint8_t *p, size_t len)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    int b;
+
+    while (len--)
+    {
+        crc ^= *p++;
+        for (b = 0; b < 8; b++)
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+    return ~crc;
+}
+
+/* Copy the record out of physical memory a word at a time */
+static int read_mem(unsigned long addr, uint8_t *buf)
+{
+    long page = sysconf(_SC_PAGESIZE);
+    unsigned long base = addr & ~(page - 1);
+    volatile uint32_t *p;
+    void *map;
+    int fd, i;
+
+    if ((fd = open("/dev/mem", O_RDONLY | O_SYNC)) < 0)
+    {
+        perror("/dev/mem");
+        return -1;
+    }
+    map = mmap(NULL, page, PROT_READ, MAP_SHARED, fd, base);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        perror("mmap");
+        return -1;
+    }
+    p = (volatile uint32_t *)((char *)map + (addr - base));
+    for (i = 0; i < MARGIN_MAX_SIZE / 4 && addr - base + 4 * i < page; i++)
+        ((uint32_t *)buf)[i] = p[i];
+    munmap(map, page);
+    return 0;
+}
+
+static int read_file(const char *path, uint8_t *buf)
+{
+    FILE *f;
+    size_t n;
+
+    if ((f = fopen(path, "rb")) == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+    n = fread(buf, 1, MARGIN_MAX_SIZE, f);
+    fclose(f);
+    return n > 0 ? 0 : -1;
+}
+
+static void print_pins(const char *path, int rank, int count, int per_group,
+                       const uint8_t *pin, uint32_t margined, int tap_ps)
+{
+    int i, group;
+
+    for (i = 0; i < count; i++, pin += 2)
+    {
+        group = i / per_group;
+        if (!(margined & (1u << group)))
+            continue;
+        printf("%d,%d,%d,%s,%u,%u,%u,%u\n", rank, group, i, path,
+               pin[0], pin[1], pin[0] * tap_ps, pin[1] * tap_ps);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long addr = MARGIN_EXPORT_BASE;
+    const char *file = NULL;
+    uint32_t buf[MARGIN_MAX_SIZE / 4] = { 0 };
+    const uint8_t *rec = (const uint8_t *)buf;
+    struct margin_header h;
+    const uint32_t *margined;
+    const uint8_t *dq_in, *dq_out, *dm;
+    uint32_t checksum;
+    int pins, dms, sr, opt;
+
+    while ((opt = getopt(argc, argv, "a:f:")) != -1)
+        switch (opt)
+        {
+        case 'a':
+            addr = strtoul(optarg, NULL, 0);
+            break;
+        case 'f':
+            file = optarg;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-a address | -f file]\n", argv[0]);
+            return 1;
+        }
+
+    if ((file ? read_file(file, (uint8_t *)buf) :
+         read_mem(addr, (uint8_t *)buf)) < 0)
+        return 1;
+
+    memcpy(&h, rec, sizeof(h));
+    if (h.magic != MARGIN_EXPORT_MAGIC || h.size < sizeof(h) + 4 ||
+        h.size > MARGIN_MAX_SIZE || h.size % 4)
+    {
+        fprintf(stderr, "no margin record (was the preloader built with "
+                "ENABLE_MARGIN_EXPORT?)\n");
+        return 1;
+    }
+    memcpy(&checksum, rec + h.size - 4, 4);
+    if (checksum != crc32(rec, h.size - 4))
+    {
+        fprintf(stderr, "margin record is corrupt\n");
+        return 1;
+    }
+
+    pins = h.groups * h.dq_per_group;
+    dms = h.groups * h.dm_per_group;
+    margined = (const uint32_t *)(rec + sizeof(h));
+    dq_in = (const uint8_t *)(margined + h.shadow_regs);
+    dq_out = dq_in + 2 * pins * h.shadow_regs;
+    dm = dq_out + 2 * pins * h.shadow_regs;
+    if (dm + 2 * dms * h.shadow_regs > rec + h.size - 4)
+    {
+        fprintf(stderr, "margin record is too short for its header\n");
+        return 1;
+    }
+
+    printf("rank,group,pin,path,left_taps,right_taps,left_ps,right_ps\n");
+    for (sr = 0; sr < h.shadow_regs; sr++)
+    {
+        print_pins("read", sr, pins, h.dq_per_group, dq_in + 2 * pins * sr,
+                   margined[sr], h.tap_ps);
+        print_pins("write", sr, pins, h.dq_per_group, dq_out + 2 * pins * sr,
+                   margined[sr], h.tap_ps);
+        if (h.dm_per_group)
+            print_pins("dm", sr, dms, h.dm_per_group, dm + 2 * dms * sr,
+                       margined[sr], h.tap_ps);
+    }
+    return 0;
+}
@@ -0,0 +1,135 @@
+/*
+ * Log the SDRAM controller's DQS tracking over time
+ *
+ * Reads /dev/ddr_tracking (ddr_tracking.ko) every interval and prints
+ * one CSV line per DQS group:
+ *
+ *   time_s,load1,temp,group,phase,delay,offset,min_offset,max_offset,
+ *   adjustments,polls
+ *
+ * offset is how many delay taps tracking has moved the group's read gate
+ * from where calibration put it, min and max its extremes since the
+ * driver loaded, and adjustments how many of the driver's polls found it
+ * moved.  load1 is the one-minute load average and temp whatever number
+ * the -T file holds (e.g. a hwmon temp*_input), so the log can be set
+ * against temperature and load.  The tracking configuration goes first,
+ * as # comments.
+ *
+ * Usage: ddr_track [-i seconds] [-n samples] [-T file]
+ *   -i  time between samples (default 1)
+ *   -n  stop after this many samples (default: run until killed)
+ *   -T  read the temperature from this file
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include "ddr_tracking.h"
+
+#define DEVICE "/dev/ddr_tracking"
+
+/* The first number in a file, or -1 */
+static double read_number(const char *path)
+{
+    FILE *f;
+    double v;
+
+    if (path == NULL || (f = fopen(path, "r")) == NULL)
+        return -1;
+    if (fscanf(f, "%lf", &v) != 1)
+        v = -1;
+    fclose(f);
+    return v;
+}
+
+static void print_config(const ddr_tracking_stats_t *s)
+{
+    const ddr_tracking_config_t *c = &s->config;
+
+    printf("# calibration %s, stage %u sub-stage %u, fom in %u out %u\n",
+           c->failing_stage ? "failed" : "passed", c->cur_stage & 0xff,
+           (c->cur_stage >> 8) & 0xff, c->fom & 0xff, (c->fom >> 8) & 0xff);
+    printf("# tracking: %u groups, %u samples an update, long idle %u x %u "
+           "samples\n", c->read_dqs_width, c->sample_count,
+           c->longidle >> 16, c->longidle & 0xffff);
+    printf("# delays: tRFC %u tRCD %u VFIFO wait %u mux %u, tREFI %u\n",
+           c->delays >> 24, (c->delays >> 16) & 0xff, (c->delays >> 8) & 0xff,
+           c->delays & 0xff, c->rfsh & 0xffffff);
+    printf("# %u delay taps a phase; calibrated settings from %s; "
+           "driver polls every %u ms\n", c->dtaps_per_ptap + 1,
+           s->from_preloader ? "the preloader" : "the driver's first poll",
+           s->poll_ms);
+}
+
+int main(int argc, char *argv[])
+{
+    ddr_tracking_stats_t s;
+    const ddr_tracking_group_t *grp;
+    const char *temp_file = NULL;
+    struct timespec start, now;
+    double interval = 1, t, load, temp;
+    long samples = 0, n;
+    unsigned int g;
+    int fd, opt;
+
+    while ((opt = getopt(argc, argv, "i:n:T:")) != -1)
+        switch (opt)
+        {
+        case 'i':
+            interval = atof(optarg);
+            break;
+        case 'n':
+            samples = atol(optarg);
+            break;
+        case 'T':
+            temp_file = optarg;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-i seconds] [-n samples] [-T file]\n",
+                    argv[0]);
+            return 1;
+        }
+
+    if ((fd = open(DEVICE, O_RDONLY)) < 0)
+    {
+        perror(DEVICE);
+        return 1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (n = 0; samples == 0 || n < samples; n++)
+    {
+        if (n > 0)
+            usleep(interval * 1e6);
+        if (ioctl(fd, DDR_TRACKING_READ_STATS, &s) < 0)
+        {
+            perror("DDR_TRACKING_READ_STATS");
+            return 1;
+        }
+        if (n == 0)
+        {
+            print_config(&s);
+            printf("time_s,load1,temp,group,phase,delay,offset,min_offset,"
+                   "max_offset,adjustments,polls\n");
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        t = (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
+        load = read_number("/proc/loadavg");
+        temp = read_number(temp_file);
+        for (g = 0; g < s.groups; g++)
+        {
+            grp = &s.group[g];
+            printf("%.3f,%.2f,%g,%u,%u,%u,%d,%d,%d,%u,%u\n", t, load, temp, g,
+                   grp->current >> 16, grp->current & 0xffff, grp->offset,
+                   grp->min_offset, grp->max_offset, grp->adjustments,
+                   s.polls);
+        }
+        fflush(stdout);
+    }
+    close(fd);
+    return 0;
+}
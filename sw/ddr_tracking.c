@@ -0,0 +1,361 @@
+/*
+ * Device driver for watching the HPS SDRAM controller's DQS tracking
+ *
+ * A Platform device implemented using the misc subsystem
+ *
+ * The preloader's sequencer calibrates each DQS group's read gate (the
+ * DQS enable phase and delay in the SCC manager) once at boot, and the
+ * controller's tracking manager then moves it as temperature and voltage
+ * drift.  This reads the tracking configuration the sequencer left in its
+ * register file, polls the settings every poll_ms and counts how often
+ * and how far tracking moved them from calibration.
+ *
+ * The calibrated settings come from the record a preloader built with
+ * ENABLE_TRACKING_BASELINE leaves at its TRK_BASELINE_BASE, in on-chip
+ * RAM the board reserves for it, when the device tree node gives that
+ * region as a third reg entry; otherwise from the first poll.
+ * The VFIFO is not visible here, so a move past a whole clock shows as a
+ * jump back by that clock's phase taps.
+ *
+ * That the SCC manager's DQS enable registers read back what tracking
+ * last set, rather than what the sequencer wrote, has not been confirmed
+ * on the board: the sequencer only reads them back in debug paths.  If
+ * ddr_track shows no adjustments through a warm-up or a heat gun on the
+ * SDRAM while the read FOM drops, they do not, and the counts here mean
+ * nothing.
+ *
+ * Held until both are done, so not built by default:
+ * "make DDR_TRACKING=1" to build
+ * insmod ddr_tracking.ko [poll_ms=100]
+ *
+ * Check code style with
+ * checkpatch.pl --file --no-tree ddr_tracking.c
+ */
+
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/errno.h>
+#include <linux/kernel.h>
+#include <linux/platform_device.h>
+#include <linux/miscdevice.h>
+#include <linux/mutex.h>
+#include <linux/workqueue.h>
+#include <linux/io.h>
+#include <linux/of.h>
+#include <linux/of_address.h>
+#include <linux/fs.h>
+#include <linux/uaccess.h>
+#include "ddr_tracking.h"
+
+#define DRIVER_NAME "ddr_tracking"
+
+/* SCC manager registers, from the sequencer's sequencer.h */
+#define SCC_DQS_EN_PHASE(x, g) ((x) + 0x200 + (g) * 4)
+#define SCC_DQS_EN_DELAY(x, g) ((x) + 0x300 + (g) * 4)
+
+/* Register file words, from the sequencer's sequencer.h */
+#define REG_FILE_SIGNATURE(x)       ((x) + 0x00)
+#define REG_FILE_CUR_STAGE(x)       ((x) + 0x08)
+#define REG_FILE_FOM(x)             ((x) + 0x0c)
+#define REG_FILE_FAILING_STAGE(x)   ((x) + 0x10)
+#define REG_FILE_DTAPS_PER_PTAP(x)  ((x) + 0x1c)
+#define REG_FILE_TRK_SAMPLE_COUNT(x) ((x) + 0x20)
+#define REG_FILE_TRK_LONGIDLE(x)    ((x) + 0x24)
+#define REG_FILE_DELAYS(x)          ((x) + 0x28)
+#define REG_FILE_TRK_RW_MGR_ADDR(x) ((x) + 0x2c)
+#define REG_FILE_TRK_READ_DQS_WIDTH(x) ((x) + 0x30)
+#define REG_FILE_TRK_RFSH(x)        ((x) + 0x34)
+
+/* The sequencer's tracking baseline record: magic, groups, settings */
+#define TRK_BASELINE(x, i)          ((x) + (i) * 4)
+#define TRK_BASELINE_MAGIC          0x314b5254
+
+static unsigned int poll_ms = 100;
+module_param(poll_ms, uint, 0444);
+MODULE_PARM_DESC(poll_ms, "Time between polls of the DQS enable settings");
+
+/*
+ * Information about our device
+ */
+struct ddr_tracking_dev {
+	struct resource res[3];		/* SCC manager, register file,
+					   baseline record */
+	void __iomem *scc;
+	void __iomem *reg_file;
+	void __iomem *baseline;		/* NULL if the node gives none */
+	struct delayed_work poll;
+	struct mutex lock;		/* Guards stats */
+	ddr_tracking_stats_t stats;
+} dev;
+
+/* A group's DQS enable setting, phase << 16 | delay */
+static unsigned int read_setting(unsigned int g)
+{
+	return ioread32(SCC_DQS_EN_PHASE(dev.scc, g)) << 16 |
+		(ioread32(SCC_DQS_EN_DELAY(dev.scc, g)) & 0xffff);
+}
+
+/* How far b is from a, in delay taps */
+static int taps_between(unsigned int a, unsigned int b)
+{
+	int per_phase = dev.stats.config.dtaps_per_ptap + 1;
+
+	return ((int)(b >> 16) - (int)(a >> 16)) * per_phase +
+		(int)(b & 0xffff) - (int)(a & 0xffff);
+}
+
+static void read_config(ddr_tracking_config_t *c)
+{
+	c->signature = ioread32(REG_FILE_SIGNATURE(dev.reg_file));
+	c->cur_stage = ioread32(REG_FILE_CUR_STAGE(dev.reg_file));
+	c->fom = ioread32(REG_FILE_FOM(dev.reg_file));
+	c->failing_stage = ioread32(REG_FILE_FAILING_STAGE(dev.reg_file));
+	c->dtaps_per_ptap = ioread32(REG_FILE_DTAPS_PER_PTAP(dev.reg_file));
+	c->sample_count = ioread32(REG_FILE_TRK_SAMPLE_COUNT(dev.reg_file));
+	c->longidle = ioread32(REG_FILE_TRK_LONGIDLE(dev.reg_file));
+	c->delays = ioread32(REG_FILE_DELAYS(dev.reg_file));
+	c->rw_mgr_addr = ioread32(REG_FILE_TRK_RW_MGR_ADDR(dev.reg_file));
+	c->read_dqs_width = ioread32(REG_FILE_TRK_READ_DQS_WIDTH(dev.reg_file));
+	c->rfsh = ioread32(REG_FILE_TRK_RFSH(dev.reg_file));
+}
+
+/*
+ * Take the calibrated settings from the preloader's record if it left
+ * one, otherwise start from what the groups hold now
+ */
+static void read_baseline(void)
+{
+	ddr_tracking_stats_t *s = &dev.stats;
+	unsigned int g;
+
+	s->groups = s->config.read_dqs_width;
+	s->from_preloader = 0;
+	if (dev.baseline &&
+	    ioread32(TRK_BASELINE(dev.baseline, 0)) == TRK_BASELINE_MAGIC) {
+		s->groups = ioread32(TRK_BASELINE(dev.baseline, 1));
+		s->from_preloader = 1;
+	}
+	if (s->groups > DDR_TRACKING_MAX_GROUPS)
+		s->groups = DDR_TRACKING_MAX_GROUPS;
+
+	for (g = 0; g < s->groups; g++) {
+		s->group[g].current = read_setting(g);
+		s->group[g].calibrated = s->from_preloader ?
+			ioread32(TRK_BASELINE(dev.baseline, g + 2)) :
+			s->group[g].current;
+		s->group[g].offset = taps_between(s->group[g].calibrated,
+						  s->group[g].current);
+		s->group[g].min_offset = s->group[g].offset;
+		s->group[g].max_offset = s->group[g].offset;
+	}
+}
+
+/* Poll every group's setting and count the ones that moved */
+static void ddr_tracking_poll(struct work_struct *work)
+{
+	ddr_tracking_stats_t *s = &dev.stats;
+	ddr_tracking_group_t *grp;
+	unsigned int setting;
+	unsigned int g;
+
+	mutex_lock(&dev.lock);
+	for (g = 0; g < s->groups; g++) {
+		grp = &s->group[g];
+		setting = read_setting(g);
+		if (setting == grp->current)
+			continue;
+		grp->current = setting;
+		grp->adjustments++;
+		grp->offset = taps_between(grp->calibrated, setting);
+		if (grp->offset < grp->min_offset)
+			grp->min_offset = grp->offset;
+		if (grp->offset > grp->max_offset)
+			grp->max_offset = grp->offset;
+	}
+	s->polls++;
+	mutex_unlock(&dev.lock);
+
+	schedule_delayed_work(&dev.poll, msecs_to_jiffies(poll_ms));
+}
+
+/*
+ * Handle ioctl() calls from userspace:
+ * Copy out the configuration, re-read in case the sequencer ran again,
+ * and the counts
+ */
+static long ddr_tracking_ioctl(struct file *f, unsigned int cmd,
+			       unsigned long arg)
+{
+	ddr_tracking_stats_t stats;
+
+	switch (cmd) {
+	case DDR_TRACKING_READ_STATS:
+		mutex_lock(&dev.lock);
+		read_config(&dev.stats.config);
+		stats = dev.stats;
+		mutex_unlock(&dev.lock);
+		if (copy_to_user((ddr_tracking_stats_t *) arg, &stats,
+				 sizeof(ddr_tracking_stats_t)))
+			return -EACCES;
+		break;
+
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/* The operations our device knows how to do */
+static const struct file_operations ddr_tracking_fops = {
+	.owner		= THIS_MODULE,
+	.unlocked_ioctl = ddr_tracking_ioctl,
+};
+
+/* Information about our device for the "misc" framework -- like a char dev */
+static struct miscdevice ddr_tracking_misc_device = {
+	.minor		= MISC_DYNAMIC_MINOR,
+	.name		= DRIVER_NAME,
+	.fops		= &ddr_tracking_fops,
+};
+
+/*
+ * Initialization code: get resources (registers), take the calibrated
+ * settings and start polling
+ */
+static int __init ddr_tracking_probe(struct platform_device *pdev)
+{
+	int ret;
+
+	/* Get the addresses of the registers from the device tree */
+	if (of_address_to_resource(pdev->dev.of_node, 0, &dev.res[0]) ||
+	    of_address_to_resource(pdev->dev.of_node, 1, &dev.res[1]))
+		return -ENOENT;
+
+	/* Make sure we can use these registers */
+	if (request_mem_region(dev.res[0].start, resource_size(&dev.res[0]),
+			       DRIVER_NAME) == NULL)
+		return -EBUSY;
+	if (request_mem_region(dev.res[1].start, resource_size(&dev.res[1]),
+			       DRIVER_NAME) == NULL) {
+		ret = -EBUSY;
+		goto out_release_scc;
+	}
+
+	/* Arrange access to our registers */
+	dev.scc = of_iomap(pdev->dev.of_node, 0);
+	dev.reg_file = of_iomap(pdev->dev.of_node, 1);
+	if (dev.scc == NULL || dev.reg_file == NULL) {
+		ret = -ENOMEM;
+		goto out_unmap;
+	}
+
+	/* The preloader's baseline record, if the board reserved one */
+	dev.baseline = NULL;
+	if (of_address_to_resource(pdev->dev.of_node, 2, &dev.res[2]) == 0) {
+		if (request_mem_region(dev.res[2].start,
+				       resource_size(&dev.res[2]),
+				       DRIVER_NAME) == NULL) {
+			ret = -EBUSY;
+			goto out_unmap;
+		}
+		dev.baseline = of_iomap(pdev->dev.of_node, 2);
+		if (dev.baseline == NULL) {
+			release_mem_region(dev.res[2].start,
+					   resource_size(&dev.res[2]));
+			ret = -ENOMEM;
+			goto out_unmap;
+		}
+	}
+
+	mutex_init(&dev.lock);
+	read_config(&dev.stats.config);
+	read_baseline();
+	dev.stats.poll_ms = poll_ms ? poll_ms : 1;
+	poll_ms = dev.stats.poll_ms;
+	INIT_DELAYED_WORK(&dev.poll, ddr_tracking_poll);
+	schedule_delayed_work(&dev.poll, msecs_to_jiffies(poll_ms));
+
+	/* Register ourselves as a misc device: creates /dev/ddr_tracking */
+	ret = misc_register(&ddr_tracking_misc_device);
+	if (ret)
+		goto out_cancel;
+
+	pr_info(DRIVER_NAME ": %u groups, calibrated settings from %s\n",
+		dev.stats.groups,
+		dev.stats.from_preloader ? "the preloader" : "the first poll");
+	return 0;
+
+out_cancel:
+	cancel_delayed_work_sync(&dev.poll);
+	if (dev.baseline) {
+		iounmap(dev.baseline);
+		release_mem_region(dev.res[2].start,
+				   resource_size(&dev.res[2]));
+	}
+out_unmap:
+	if (dev.reg_file)
+		iounmap(dev.reg_file);
+	if (dev.scc)
+		iounmap(dev.scc);
+	release_mem_region(dev.res[1].start, resource_size(&dev.res[1]));
+out_release_scc:
+	release_mem_region(dev.res[0].start, resource_size(&dev.res[0]));
+	return ret;
+}
+
+/* Clean-up code: release resources */
+static int ddr_tracking_remove(struct platform_device *pdev)
+{
+	misc_deregister(&ddr_tracking_misc_device);
+	cancel_delayed_work_sync(&dev.poll);
+	if (dev.baseline) {
+		iounmap(dev.baseline);
+		release_mem_region(dev.res[2].start,
+				   resource_size(&dev.res[2]));
+	}
+	iounmap(dev.reg_file);
+	iounmap(dev.scc);
+	release_mem_region(dev.res[1].start, resource_size(&dev.res[1]));
+	release_mem_region(dev.res[0].start, resource_size(&dev.res[0]));
+	return 0;
+}
+
+/* Which "compatible" string(s) to search for in the Device Tree */
+#ifdef CONFIG_OF
+static const struct of_device_id ddr_tracking_of_match[] = {
+	{ .compatible = "csee4840,ddr_tracking-1.0" },
+	{},
+};
+MODULE_DEVICE_TABLE(of, ddr_tracking_of_match);
+#endif
+
+/* Information for registering ourselves as a "platform" driver */
+static struct platform_driver ddr_tracking_driver = {
+	.driver	= {
+		.name	= DRIVER_NAME,
+		.owner	= THIS_MODULE,
+		.of_match_table = of_match_ptr(ddr_tracking_of_match),
+	},
+	.remove	= __exit_p(ddr_tracking_remove),
+};
+
+/* Called when the module is loaded: set things up */
+static int __init ddr_tracking_init(void)
+{
+	pr_info(DRIVER_NAME ": init\n");
+	return platform_driver_probe(&ddr_tracking_driver, ddr_tracking_probe);
+}
+
+/* Called when the module is unloaded: release resources */
+static void __exit ddr_tracking_exit(void)
+{
+	platform_driver_unregister(&ddr_tracking_driver);
+	pr_info(DRIVER_NAME ": exit\n");
+}
+
+module_init(ddr_tracking_init);
+module_exit(ddr_tracking_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("HPS SDRAM DQS tracking statistics");
@@ -0,0 +1,57 @@
+#ifndef _DDR_TRACKING_H
+#define _DDR_TRACKING_H
+
+#include <linux/ioctl.h>
+
+/*
+ * Runtime view of the HPS SDRAM controller's DQS tracking
+ *
+ * The preloader's sequencer leaves the tracking configuration in its
+ * register file (initialize_tracking) and, when built with
+ * ENABLE_TRACKING_BASELINE, the DQS enable settings each group calibrated
+ * to at TRK_BASELINE_BASE.  Tracking then moves those settings as the board drifts.  The
+ * driver polls the settings the SCC manager reads back and counts the
+ * moves, so the counts do not depend on how often anyone asks.
+ */
+
+#define DDR_TRACKING_MAX_GROUPS  8   /* TRK_BASELINE_MAX_GROUPS */
+
+/* Register file words, as the sequencer's REG_FILE_* leave them */
+typedef struct {
+  unsigned int signature;       /* REG_FILE_SIGNATURE */
+  unsigned int cur_stage;       /* Stage, sub-stage, group calibration ended in */
+  unsigned int fom;             /* Read FOM in bits 7:0, write in 15:8 */
+  unsigned int failing_stage;   /* 0 if calibration passed */
+  unsigned int dtaps_per_ptap;  /* DQS enable delay taps per phase tap */
+  unsigned int sample_count;    /* Samples per tracking update */
+  unsigned int longidle;        /* Long-idle outer loop << 16 | samples */
+  unsigned int delays;          /* tRFC << 24 | tRCD << 16 | VFIFO wait << 8 | mux */
+  unsigned int rw_mgr_addr;     /* RW manager routines tracking runs */
+  unsigned int read_dqs_width;  /* Groups tracked */
+  unsigned int rfsh;            /* Refresh routine << 24 | tREFI */
+} ddr_tracking_config_t;
+
+typedef struct {
+  unsigned int calibrated;      /* DQS enable phase << 16 | delay at handoff */
+  unsigned int current;         /* The same, as last polled */
+  unsigned int adjustments;     /* Polls that found the setting moved */
+  int offset;                   /* current - calibrated, in delay taps */
+  int min_offset, max_offset;   /* Extremes of offset since the driver loaded */
+} ddr_tracking_group_t;
+
+typedef struct {
+  ddr_tracking_config_t config;
+  unsigned int from_preloader;  /* calibrated came from the sequencer, not
+                                   the first poll */
+  unsigned int poll_ms;         /* Time between polls */
+  unsigned int polls;           /* Polls since the driver loaded */
+  unsigned int groups;
+  ddr_tracking_group_t group[DDR_TRACKING_MAX_GROUPS];
+} ddr_tracking_stats_t;
+
+#define DDR_TRACKING_MAGIC 't'
+
+/* ioctls and their arguments */
+#define DDR_TRACKING_READ_STATS _IOR(DDR_TRACKING_MAGIC, 1, ddr_tracking_stats_t)
+
+#endif
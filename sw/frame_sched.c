@@ -0,0 +1,97 @@
+/*
+ * Frame-rate pacing against the VGA refresh period
+ *
+ * Sleeps with clock_nanosleep(TIMER_ABSTIME) until each frame's deadline
+ * and keeps statistics on missed deadlines, wakeup latency, and how long
+ * the caller worked between frames.
+ */
+
+#include <errno.h>
+#include "frame_sched.h"
+
+#define NSEC_PER_SEC 1000000000LL
+
+static long long ts_to_ns(const struct timespec *ts)
+{
+    return ts->tv_sec * NSEC_PER_SEC + ts->tv_nsec;
+}
+
+static void ns_to_ts(long long ns, struct timespec *ts)
+{
+    ts->tv_sec = ns / NSEC_PER_SEC;
+    ts->tv_nsec = ns % NSEC_PER_SEC;
+}
+
+/* Start a schedule whose first deadline is one period from now */
+void frame_sched_init(struct frame_sched *fs, long long period_ns)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    fs->period_ns = period_ns;
+    fs->woke = now;
+    ns_to_ts(ts_to_ns(&now) + period_ns, &fs->next);
+
+    fs->frames = fs->missed = fs->dropped = 0;
+    fs->wake_max_ns = fs->wake_sum_ns = 0;
+    fs->work_max_ns = fs->work_sum_ns = 0;
+}
+
+/*
+ * Sleep until the next frame deadline
+ *
+ * Returns the number of frame periods that were skipped because the
+ * caller arrived late (0 when the deadline was met)
+ */
+int frame_sched_wait(struct frame_sched *fs)
+{
+    struct timespec now;
+    long long now_ns, next_ns, work_ns, wake_ns;
+    int skipped = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    now_ns = ts_to_ns(&now);
+    next_ns = ts_to_ns(&fs->next);
+
+    work_ns = now_ns - ts_to_ns(&fs->woke);
+    fs->work_sum_ns += work_ns;
+    if (work_ns > fs->work_max_ns)
+        fs->work_max_ns = work_ns;
+
+    if (now_ns >= next_ns)
+    {
+        /* Missed it: wait for the first boundary still ahead of us */
+        skipped = (now_ns - next_ns) / fs->period_ns + 1;
+        next_ns += skipped * fs->period_ns;
+        ns_to_ts(next_ns, &fs->next);
+        fs->missed++;
+        fs->dropped += skipped;
+    }
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+                           &fs->next, NULL) == EINTR)
+        ;
+
+    clock_gettime(CLOCK_MONOTONIC, &fs->woke);
+    wake_ns = ts_to_ns(&fs->woke) - next_ns;
+    fs->wake_sum_ns += wake_ns;
+    if (wake_ns > fs->wake_max_ns)
+        fs->wake_max_ns = wake_ns;
+
+    ns_to_ts(next_ns + fs->period_ns, &fs->next);
+    fs->frames++;
+
+    return skipped;
+}
+
+void frame_sched_report(const struct frame_sched *fs, FILE *f)
+{
+    unsigned long n = fs->frames ? fs->frames : 1;
+
+    fprintf(f, "frames: %lu  missed: %lu  dropped: %lu  period: %lld us\n",
+            fs->frames, fs->missed, fs->dropped, fs->period_ns / 1000);
+    fprintf(f, "wakeup latency: avg %lld us  max %lld us\n",
+            fs->wake_sum_ns / n / 1000, fs->wake_max_ns / 1000);
+    fprintf(f, "work per frame: avg %lld us  max %lld us\n",
+            fs->work_sum_ns / n / 1000, fs->work_max_ns / 1000);
+}
@@ -0,0 +1,43 @@
+#ifndef _FRAME_SCHED_H
+#define _FRAME_SCHED_H
+
+#include <stdio.h>
+#include <time.h>
+
+/*
+ * Display timing, from vga_counters in vga_ball.sv: hcount runs at the
+ * 50 MHz Avalon clock over 1600 counts per line, 525 lines per frame,
+ * so one frame is exactly 16.8 ms (59.52 Hz)
+ */
+#define VGA_CLOCK_HZ  50000000
+#define VGA_HTOTAL    1600
+#define VGA_VTOTAL    525
+#define VGA_FRAME_NS  (1000000000LL * VGA_HTOTAL * VGA_VTOTAL / VGA_CLOCK_HZ)
+
+/*
+ * Paces a loop at a fixed period using absolute deadlines on
+ * CLOCK_MONOTONIC, so the time spent doing work between waits does not
+ * accumulate as drift.  A deadline that has already passed when the
+ * loop arrives is counted as missed and the schedule jumps ahead to the
+ * next period boundary rather than running extra frames to catch up.
+ */
+struct frame_sched {
+    struct timespec next;   /* Absolute deadline of the next frame */
+    struct timespec woke;   /* When the last wait returned */
+    long long period_ns;
+
+    unsigned long frames;   /* Frames waited for */
+    unsigned long missed;   /* Waits that arrived after their deadline */
+    unsigned long dropped;  /* Frame periods skipped to resynchronize */
+
+    long long wake_max_ns;  /* Worst wakeup latency past the deadline */
+    long long wake_sum_ns;
+    long long work_max_ns;  /* Longest time between wakeup and next wait */
+    long long work_sum_ns;
+};
+
+void frame_sched_init(struct frame_sched *fs, long long period_ns);
+int frame_sched_wait(struct frame_sched *fs);
+void frame_sched_report(const struct frame_sched *fs, FILE *f);
+
+#endif
@@ -7,6 +7,7 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include "vga_ball.h"
 #include <sys/ioctl.h>
 #include <sys/types.h>
@@ -14,15 +15,28 @@
 #include <fcntl.h>
 #include <string.h>
 #include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include "frame_sched.h"
+#include "triple_buffer.h"
+#include "vga_trace.h"
+#include "rt_runtime.h"
 
 int vga_ball_fd;
 
+static volatile sig_atomic_t done;
+
+static void handle_sigint(int sig)
+{
+    done = 1;
+}
+
 /* Read and print the background color */
 void print_background_color()
 {
     vga_ball_arg_t vla;
 
-    if (ioctl(vga_ball_fd, VGA_BALL_READ_BACKGROUND, &vla))
+    if (vga_trace_ioctl(vga_ball_fd, VGA_BALL_READ_BACKGROUND, &vla))
     {
         perror("ioctl(VGA_BALL_READ_BACKGROUND) failed");
         return;
@@ -36,7 +50,7 @@ void set_background_color(const vga_ball_color_t *c)
 {
     vga_ball_arg_t vla;
     vla.background = *c;
-    if (ioctl(vga_ball_fd, VGA_BALL_WRITE_BACKGROUND, &vla))
+    if (vga_trace_ioctl(vga_ball_fd, VGA_BALL_WRITE_BACKGROUND, &vla))
     {
         perror("ioctl(VGA_BALL_SET_BACKGROUND) failed");
         return;
@@ -46,7 +60,7 @@ void set_background_color(const vga_ball_color_t *c)
 void print_position()
 {
     vga_ball_arg_t vla;
-    if (ioctl(vga_ball_fd, VGA_BALL_READ_POSITION, &vla))
+    if (vga_trace_ioctl(vga_ball_fd, VGA_BALL_READ_POSITION, &vla))
     {
         perror("ioctl(VGA_BALL_READ_POSITION) failed");
         return;
@@ -59,7 +73,7 @@ void set_position(const vga_ball_position_t *position)
 {
     vga_ball_arg_t vla;
     vla.position = *position;
-    if (ioctl(vga_ball_fd, VGA_BALL_WRITE_POSITION, &vla))
+    if (vga_trace_ioctl(vga_ball_fd, VGA_BALL_WRITE_POSITION, &vla))
     {
         perror("ioctl(VGA_BALL_SET_POSITION) failed");
         return;
@@ -125,20 +139,26 @@ void hsv_to_rgb(float h, float s, float v, int *r, int *g, int *b)
     *b = (int)(b1 * 255);
 }
 
-int main()
+/* Everything the display needs for one frame */
+struct scene
 {
-    vga_ball_arg_t vla;
-    int i;
-    static const char filename[] = "/dev/vga_ball";
+    vga_ball_color_t background;
+    vga_ball_position_t position;
+};
 
-    printf("VGA ball Userspace program started\n");
+/* Period of the simulation step: the rate the original usleep loop ran at */
+#define SIM_PERIOD_NS 10000000LL
 
-    if ((vga_ball_fd = open(filename, O_RDWR)) == -1)
-    {
-        fprintf(stderr, "could not open %s\n", filename);
-        return -1;
-    }
+static struct scene scenes[3];
+static struct triple_buffer scene_buffer;
 
+/*
+ * Simulation thread: advance the color and the ball at SIM_PERIOD_NS and
+ * publish each complete scene; the display thread picks up whichever
+ * one is newest when the next frame starts
+ */
+static void *simulate(void *unused)
+{
     int r, g, b;
     float h = 0.0, s = 1.0, v = 0.3;
 
@@ -146,17 +166,22 @@ int main()
     int dx = 1, dy = 1;
     int radius = 16;
 
-    for (;;)
+    struct frame_sched fs;
+    frame_sched_init(&fs, SIM_PERIOD_NS);
+
+    while (!done)
     {
+        struct scene *next = tb_write_slot(&scene_buffer);
+
         // Set the background color using HSV to RGB conversion
         hsv_to_rgb(h, s, v, &r, &g, &b);
         h += .5; // Increment hue
         if (h >= 360.0)
             h = 0.0;
         vga_ball_color_t color = {r, g, b};
-        set_background_color(&color);
+        next->background = color;
         printf("HSV: h=%.2f s=%.2f v=%.2f -> RGB: r=%d g=%d b=%d\n", h, s, v, r, g, b);
-        
+
         // Bounce the ball around the screen
         x += dx;
         y += dy;
@@ -170,16 +195,105 @@ int main()
             dy = -dy;
             y += dy;
         }
-        
+
         vga_ball_position_t position = { // map x and y (0 to 1) to ints from 0 to 65535
             (unsigned short)(x) << 6, // 0 to 639
             (unsigned short)(y) << 6}; // 0 to 479
-        set_position(&position);
-        print_position();
+        next->position = position;
+
+        tb_publish(&scene_buffer);
+        frame_sched_wait(&fs);
+    }
+
+    printf("Simulation:\n");
+    frame_sched_report(&fs, stdout);
+    return NULL;
+}
+
+/*
+ * Usage: hello [-r] [-p priority] [-c cpu]
+ *   -r  real-time display thread: SCHED_FIFO, locked and prefaulted memory
+ *   -p  SCHED_FIFO priority (implies -r)
+ *   -c  pin the display thread to a CPU
+ */
+int main(int argc, char *argv[])
+{
+    static const char filename[] = "/dev/vga_ball";
+    struct rt_config rt;
+    int opt;
+
+    rt_config_init(&rt);
+    while ((opt = getopt(argc, argv, "rp:c:")) != -1)
+        switch (opt)
+        {
+        case 'r':
+            rt_config_realtime(&rt);
+            break;
+        case 'p':
+            rt_config_realtime(&rt);
+            if (rt_parse_priority(optarg, &rt.priority))
+                return -1;
+            break;
+        case 'c':
+            rt.cpu = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-r] [-p priority] [-c cpu]\n", argv[0]);
+            return -1;
+        }
+
+    printf("VGA ball Userspace program started\n");
+
+    if ((vga_ball_fd = open(filename, O_RDWR)) == -1)
+    {
+        fprintf(stderr, "could not open %s\n", filename);
+        return -1;
+    }
 
-        usleep(10000);
+    // Log every command for vga_replay if asked to
+    const char *trace = getenv("VGA_BALL_TRACE");
+    if (trace && vga_trace_start(trace))
+        fprintf(stderr, "could not open trace %s\n", trace);
+
+    pthread_t sim;
+    struct frame_sched fs;
+    signal(SIGINT, handle_sigint);
+    tb_init(&scene_buffer, &scenes[0], &scenes[1], &scenes[2]);
+
+    // Memory settings are the process's: in place before the simulation starts
+    if (rt_apply_memory(&rt))
+        fprintf(stderr, "real-time memory setup incomplete, continuing\n");
+    if (pthread_create(&sim, NULL, simulate, NULL))
+    {
+        fprintf(stderr, "could not start simulation thread\n");
+        return -1;
     }
 
+    // Only the display thread runs real-time; the simulation stays normal
+    if (rt_apply(&rt))
+        fprintf(stderr, "real-time setup incomplete, continuing\n");
+    frame_sched_init(&fs, VGA_FRAME_NS);
+
+    // Display thread: submit the newest complete scene once per frame
+    while (!done)
+    {
+        int fresh;
+        const struct scene *cur = tb_read_slot(&scene_buffer, &fresh);
+
+        if (fresh)
+        {
+            set_background_color(&cur->background);
+            set_position(&cur->position);
+        }
+
+        // Hold each update until the display starts its next frame
+        frame_sched_wait(&fs);
+    }
+
+    pthread_join(sim, NULL);
+    vga_trace_stop();
+    printf("Display:\n");
+    frame_sched_report(&fs, stdout);
     printf("VGA BALL Userspace program terminating\n");
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,651 @@
+/*
+ * Memory bandwidth and latency benchmark
+ *
+ * Measures what the memory system delivers to user space, so board
+ * revisions and DDR calibration settings can be compared by numbers:
+ *   - sequential read, write and copy bandwidth, in plain C and with the
+ *     vector unit (NEON on ARM, SSE2 on x86), on one thread and on several
+ *   - random read and write bandwidth, one cache line an access
+ *   - load-to-load latency, chasing pointers through a random cycle of
+ *     cache lines, for working sets from 4 KB up to the buffer size
+ *   - with -M, the time of single accesses to a mapped device window, such
+ *     as registers behind the HPS-to-FPGA bridge
+ * Nothing in it is particular to the board; on a PC it measures the PC.
+ * Each result is the best of several runs.  Copies count the bytes
+ * copied, not read plus written.  Output is a table, or CSV (-c):
+ *   bw,<test>,<threads>,<MB/s>
+ *   lat,<working set bytes>,<ns per load>
+ *   mmio,<test>,<accesses>,<ns per access>
+ *
+ * Usage: mem_bench [-c] [-s MB] [-t threads] [-r runs]
+ *                  [-M file] [-a offset] [-n bytes] [-b width] [-w value] [-o]
+ *   -s  buffer size (default 64 MB)
+ *   -t  threads for the multithreaded runs (default: online CPUs)
+ *   -r  runs of each test (default 5)
+ *   -M  time reads through a MAP_SHARED mapping of this file instead: a
+ *       device, or /dev/mem with -a the physical address of the window.
+ *       Only reads are timed unless -w is given, so the window must be
+ *       readable, and reading it must have no side effects.
+ *   -a  offset of the window in the file (default 0)
+ *   -n  bytes of window to map (default 4096)
+ *   -b  bytes per access, 1 or 4 (default 4): 1 for a slave with byte-wide
+ *       registers, where a 32-bit store would land on four of them
+ *   -w  also time writes, storing value to every access of the window.
+ *       The registers are left holding it, so only use a value the device
+ *       can take in all of them.
+ *   -o  the window is write-only: time no reads (needs -w)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MEM_SIMD_NEON
+static const char simd_name[] = "neon";
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define MEM_SIMD_SSE
+static const char simd_name[] = "sse2";
+#else
+static const char simd_name[] = "none";
+#endif
+
+#define MAX_THREADS     16
+#define LAT_MIN_BYTES   4096
+#define LAT_LOADS       (1 << 20)
+#define MMIO_ACCESSES   100000
+
+/* Sequential kernels run over bytes, a multiple of 64 */
+typedef uint64_t (*kernel_t)(char *dst, const char *src, size_t bytes);
+
+struct test {
+    const char *name;
+    kernel_t fn;
+    int line_sized;     /* One access a cache line: buffer rounded for rand */
+};
+
+struct job {
+    kernel_t fn;
+    char *dst;
+    const char *src;
+    size_t bytes;
+    pthread_barrier_t *start;
+    double t0, t1;
+};
+
+static int csv;
+static size_t line_size;
+static volatile uint64_t sink;  /* Keeps the reads from being optimized out */
+
+static double now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t read_c(char *dst, const char *src, size_t bytes)
+{
+    const uint64_t *p = (const uint64_t *)src, *end = p + bytes / 8;
+    uint64_t a = 0, b = 0, c = 0, d = 0;
+
+    for (; p < end; p += 4)
+    {
+        a += p[0];
+        b += p[1];
+        c += p[2];
+        d += p[3];
+    }
+    return a + b + c + d;
+}
+
+static uint64_t write_c(char *dst, const char *src, size_t bytes)
+{
+    uint64_t *p = (uint64_t *)dst, *end = p + bytes / 8;
+
+    for (; p < end; p += 4)
+        p[0] = p[1] = p[2] = p[3] = (uintptr_t)p;
+    return 0;
+}
+
+static uint64_t copy_c(char *dst, const char *src, size_t bytes)
+{
+    memcpy(dst, src, bytes);
+    return 0;
+}
+
+#if defined(MEM_SIMD_NEON)
+
+static uint64_t read_simd(char *dst, const char *src, size_t bytes)
+{
+    const uint64_t *p = (const uint64_t *)src, *end = p + bytes / 8;
+    uint64x2_t a = vdupq_n_u64(0), b = a, c = a, d = a;
+
+    for (; p < end; p += 8)
+    {
+        a = vaddq_u64(a, vld1q_u64(p));
+        b = vaddq_u64(b, vld1q_u64(p + 2));
+        c = vaddq_u64(c, vld1q_u64(p + 4));
+        d = vaddq_u64(d, vld1q_u64(p + 6));
+    }
+    a = vaddq_u64(vaddq_u64(a, b), vaddq_u64(c, d));
+    return vgetq_lane_u64(a, 0) + vgetq_lane_u64(a, 1);
+}
+
+static uint64_t write_simd(char *dst, const char *src, size_t bytes)
+{
+    uint64_t *p = (uint64_t *)dst, *end = p + bytes / 8;
+    uint64x2_t v = vdupq_n_u64((uintptr_t)dst);
+
+    for (; p < end; p += 8)
+    {
+        vst1q_u64(p, v);
+        vst1q_u64(p + 2, v);
+        vst1q_u64(p + 4, v);
+        vst1q_u64(p + 6, v);
+    }
+    return 0;
+}
+
+static uint64_t copy_simd(char *dst, const char *src, size_t bytes)
+{
+    const uint64_t *s = (const uint64_t *)src, *end = s + bytes / 8;
+    uint64_t *d = (uint64_t *)dst;
+
+    for (; s < end; s += 8, d += 8)
+    {
+        uint64x2_t a = vld1q_u64(s), b = vld1q_u64(s + 2);
+        uint64x2_t c = vld1q_u64(s + 4), e = vld1q_u64(s + 6);
+
+        vst1q_u64(d, a);
+        vst1q_u64(d + 2, b);
+        vst1q_u64(d + 4, c);
+        vst1q_u64(d + 6, e);
+    }
+    return 0;
+}
+
+#elif defined(MEM_SIMD_SSE)
+
+static uint64_t read_simd(char *dst, const char *src, size_t bytes)
+{
+    const __m128i *p = (const __m128i *)src, *end = p + bytes / 16;
+    __m128i a = _mm_setzero_si128(), b = a, c = a, d = a;
+    uint64_t r[2];
+
+    for (; p < end; p += 4)
+    {
+        a = _mm_add_epi64(a, _mm_load_si128(p));
+        b = _mm_add_epi64(b, _mm_load_si128(p + 1));
+        c = _mm_add_epi64(c, _mm_load_si128(p + 2));
+        d = _mm_add_epi64(d, _mm_load_si128(p + 3));
+    }
+    a = _mm_add_epi64(_mm_add_epi64(a, b), _mm_add_epi64(c, d));
+    _mm_storeu_si128((__m128i *)r, a);
+    return r[0] + r[1];
+}
+
+static uint64_t write_simd(char *dst, const char *src, size_t bytes)
+{
+    __m128i *p = (__m128i *)dst, *end = p + bytes / 16;
+    __m128i v = _mm_set1_epi64x((uintptr_t)dst);
+
+    for (; p < end; p += 4)
+    {
+        _mm_store_si128(p, v);
+        _mm_store_si128(p + 1, v);
+        _mm_store_si128(p + 2, v);
+        _mm_store_si128(p + 3, v);
+    }
+    return 0;
+}
+
+static uint64_t copy_simd(char *dst, const char *src, size_t bytes)
+{
+    const __m128i *s = (const __m128i *)src, *end = s + bytes / 16;
+    __m128i *d = (__m128i *)dst;
+
+    for (; s < end; s += 4, d += 4)
+    {
+        __m128i a = _mm_load_si128(s), b = _mm_load_si128(s + 1);
+        __m128i c = _mm_load_si128(s + 2), e = _mm_load_si128(s + 3);
+
+        _mm_store_si128(d, a);
+        _mm_store_si128(d + 1, b);
+        _mm_store_si128(d + 2, c);
+        _mm_store_si128(d + 3, e);
+    }
+    return 0;
+}
+
+#endif
+
+/*
+ * Random lines: an LCG modulo a power of two with an odd increment and a
+ * multiplier of 1 mod 4 visits every line once, with nothing to look up
+ */
+static uint64_t rand_read(char *dst, const char *src, size_t bytes)
+{
+    size_t mask = bytes / line_size - 1, i, idx = 0;
+    uint64_t sum = 0;
+
+    for (i = 0; i <= mask; i++)
+    {
+        idx = (idx * 1103515245 + 12345) & mask;
+        sum += *(const uint64_t *)(src + idx * line_size);
+    }
+    return sum;
+}
+
+static uint64_t rand_write(char *dst, const char *src, size_t bytes)
+{
+    size_t mask = bytes / line_size - 1, i, idx = 0;
+
+    for (i = 0; i <= mask; i++)
+    {
+        idx = (idx * 1103515245 + 12345) & mask;
+        *(uint64_t *)(dst + idx * line_size) = idx;
+    }
+    return 0;
+}
+
+static const struct test tests[] = {
+    { "read", read_c, 0 },
+    { "write", write_c, 0 },
+    { "copy", copy_c, 0 },
+#if defined(MEM_SIMD_NEON) || defined(MEM_SIMD_SSE)
+    { "read_simd", read_simd, 0 },
+    { "write_simd", write_simd, 0 },
+    { "copy_simd", copy_simd, 0 },
+#endif
+    { "rand_read", rand_read, 1 },
+    { "rand_write", rand_write, 1 },
+};
+
+#define NTESTS (int)(sizeof(tests) / sizeof(tests[0]))
+
+/* The largest power of two not above n */
+static size_t pow2_floor(size_t n)
+{
+    size_t p = 1;
+
+    while (p <= n / 2)
+        p *= 2;
+    return p;
+}
+
+static void *worker(void *arg)
+{
+    struct job *j = arg;
+
+    pthread_barrier_wait(j->start);
+    j->t0 = now_s();
+    sink += j->fn(j->dst, j->src, j->bytes);
+    j->t1 = now_s();
+    return NULL;
+}
+
+/*
+ * MB/s of one test with the buffers split between threads, each on its
+ * own slice; the clock runs from the first thread starting to the last
+ * one finishing, once every thread is ready
+ */
+static double bandwidth(const struct test *t, char *dst, const char *src,
+                        size_t bytes, int threads, int runs)
+{
+    pthread_t tid[MAX_THREADS];
+    struct job job[MAX_THREADS];
+    pthread_barrier_t start;
+    size_t slice = bytes / threads / 64 * 64;
+    double t0, t1, best = 0;
+    int r, i;
+
+    if (t->line_sized)
+        slice = pow2_floor(slice);
+    for (r = 0; r < runs; r++)
+    {
+        pthread_barrier_init(&start, NULL, threads + 1);
+        for (i = 0; i < threads; i++)
+        {
+            job[i].fn = t->fn;
+            job[i].dst = dst + i * slice;
+            job[i].src = src + i * slice;
+            job[i].bytes = slice;
+            job[i].start = &start;
+            if (pthread_create(&tid[i], NULL, worker, &job[i]))
+            {
+                perror("pthread_create");
+                exit(1);
+            }
+        }
+        pthread_barrier_wait(&start);
+        for (i = 0; i < threads; i++)
+            pthread_join(tid[i], NULL);
+        pthread_barrier_destroy(&start);
+        for (t0 = job[0].t0, t1 = job[0].t1, i = 1; i < threads; i++)
+        {
+            if (job[i].t0 < t0)
+                t0 = job[i].t0;
+            if (job[i].t1 > t1)
+                t1 = job[i].t1;
+        }
+        if (best == 0 || t1 - t0 < best)
+            best = t1 - t0;
+    }
+    /* Random tests move a whole line for each word they touch */
+    return (double)slice * threads / best / 1e6;
+}
+
+static void bench_bandwidth(char *dst, char *src, size_t bytes, int threads,
+                            int runs)
+{
+    char many[32];
+    double mbs[2];
+    int i;
+
+    snprintf(many, sizeof(many), "%d thread%s", threads,
+             threads == 1 ? "" : "s");
+    if (!csv)
+        printf("%-12s %12s %12s\n", "MB/s", "1 thread", many);
+    for (i = 0; i < NTESTS; i++)
+    {
+        mbs[0] = bandwidth(&tests[i], dst, src, bytes, 1, runs);
+        mbs[1] = bandwidth(&tests[i], dst, src, bytes, threads, runs);
+        if (csv)
+            printf("bw,%s,1,%.0f\nbw,%s,%d,%.0f\n", tests[i].name, mbs[0],
+                   tests[i].name, threads, mbs[1]);
+        else
+            printf("%-12s %12.0f %12.0f\n", tests[i].name, mbs[0], mbs[1]);
+    }
+}
+
+/*
+ * Link the first word of lines of buf into one random cycle and follow it;
+ * each load waits for the one before, so the time per load is the latency
+ * of wherever the working set lives (cache, TLB and DRAM)
+ */
+static double chase(char *buf, size_t bytes, int runs)
+{
+    size_t n = bytes / line_size, i, j, tmp, *order;
+    void **p;
+    double t0, best = 0;
+    long k;
+    int r;
+
+    if ((order = malloc(n * sizeof(*order))) == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    for (i = 0; i < n; i++)
+        order[i] = i;
+    for (i = n - 1; i > 0; i--)
+    {
+        j = rand() % (i + 1);
+        tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+    for (i = 0; i < n; i++)
+        *(void **)(buf + order[i] * line_size) =
+            buf + order[(i + 1) % n] * line_size;
+    free(order);
+
+    for (r = 0; r < runs; r++)
+    {
+        p = (void **)buf;
+        t0 = now_s();
+        for (k = 0; k < LAT_LOADS; k++)
+            p = *p;
+        t0 = now_s() - t0;
+        sink += (uintptr_t)p;
+        if (best == 0 || t0 < best)
+            best = t0;
+    }
+    return best / LAT_LOADS * 1e9;
+}
+
+static void bench_latency(char *buf, size_t bytes, int runs)
+{
+    size_t ws;
+
+    if (!csv)
+        printf("\n%-12s %12s\n", "working set", "ns/load");
+    srand(1);
+    for (ws = LAT_MIN_BYTES; ws <= bytes; ws *= 2)
+        if (csv)
+            printf("lat,%zu,%.1f\n", ws, chase(buf, ws, runs));
+        else
+            printf("%9zu KB %12.1f\n", ws / 1024, chase(buf, ws, runs));
+}
+
+static void mmio_report(const char *name, long n, double seconds)
+{
+    if (csv)
+        printf("mmio,%s,%ld,%.1f\n", name, n, seconds / n * 1e9);
+    else
+        printf("%-12s %12ld %12.1f\n", name, n, seconds / n * 1e9);
+}
+
+/* How to access a device window (-M) */
+struct mmio {
+    int width;          /* Bytes per access, 1 or 4 */
+    int readable;       /* Reads return the registers, without side effects */
+    int write;          /* Time writes of value too */
+    uint32_t value;
+};
+
+static uint32_t mmio_read(volatile void *win, const struct mmio *m, size_t a)
+{
+    return m->width == 1 ? ((volatile uint8_t *)win)[a] :
+        ((volatile uint32_t *)win)[a];
+}
+
+static void mmio_write(volatile void *win, const struct mmio *m, size_t a)
+{
+    if (m->width == 1)
+        ((volatile uint8_t *)win)[a] = m->value;
+    else
+        ((volatile uint32_t *)win)[a] = m->value;
+}
+
+/*
+ * Time reads, writes, and a write with a read after it, each over every
+ * access of the window in turn: reads only where the window is readable,
+ * writes only of the value asked for.  Reads wait for the bridge each
+ * time; writes are posted, so on a readable window a run of them ends
+ * with a read back to wait for the last one to land.
+ */
+static void bench_mmio(volatile void *win, size_t bytes,
+                       const struct mmio *m, int runs)
+{
+    static const char *const name[3] = { "read", "write", "write_read" };
+    size_t n = bytes / m->width, a;
+    uint32_t v = 0;
+    double t0, best[3] = { 0, 0, 0 }, t;
+    char label[16];
+    long i;
+    int r, k;
+
+    for (r = 0; r < runs; r++)
+    {
+        for (k = 0; k < 3; k++)
+        {
+            if ((k != 1 && !m->readable) || (k != 0 && !m->write))
+                continue;
+            t0 = now_s();
+            for (i = 0, a = 0; i < MMIO_ACCESSES; i++, a = (a + 1) % n)
+            {
+                if (k != 0)
+                    mmio_write(win, m, a);
+                if (k != 1)
+                    v += mmio_read(win, m, a);
+            }
+            if (k == 1 && m->readable)
+                v += mmio_read(win, m, 0);
+            t = now_s() - t0;
+            if (best[k] == 0 || t < best[k])
+                best[k] = t;
+        }
+    }
+    sink += v;
+
+    if (!csv)
+        printf("%-12s %12s %12s\n", "mmio", "accesses", "ns/access");
+    for (k = 0; k < 3; k++)
+        if (best[k] > 0)
+        {
+            snprintf(label, sizeof(label), "%s%d", name[k], m->width * 8);
+            mmio_report(label, MMIO_ACCESSES, best[k]);
+        }
+}
+
+static int run_mmio(const char *path, unsigned long offset, size_t bytes,
+                    const struct mmio *m, int runs)
+{
+    long page = sysconf(_SC_PAGESIZE);
+    unsigned long base = offset & ~(page - 1);
+    void *map;
+    int fd;
+
+    if (!m->readable && !m->write)
+    {
+        fprintf(stderr, "nothing to time: a write-only window needs -w\n");
+        return 1;
+    }
+    if ((fd = open(path, (m->write ? O_RDWR : O_RDONLY) | O_SYNC)) < 0)
+    {
+        perror(path);
+        return 1;
+    }
+    map = mmap(NULL, bytes + (offset - base),
+               m->write ? PROT_READ | PROT_WRITE : PROT_READ,
+               MAP_SHARED, fd, base);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        perror("mmap");
+        return 1;
+    }
+    bench_mmio((char *)map + (offset - base), bytes, m, runs);
+    munmap(map, bytes + (offset - base));
+    return 0;
+}
+
+/* The L1 data cache line, from the C library or else from sysfs */
+static size_t cache_line(void)
+{
+    long l = sysconf(_SC_LEVEL1_DCACHE_LINESIZE);
+    FILE *f;
+
+    if (l <= 0 && (f = fopen("/sys/devices/system/cpu/cpu0/cache/index0/"
+                             "coherency_line_size", "r")) != NULL)
+    {
+        if (fscanf(f, "%ld", &l) != 1)
+            l = 0;
+        fclose(f);
+    }
+    return l >= (long)sizeof(void *) && (l & (l - 1)) == 0 ? (size_t)l : 64;
+}
+
+static char *alloc_buffer(size_t bytes)
+{
+    void *p;
+
+    if (posix_memalign(&p, 4096, bytes))
+    {
+        fprintf(stderr, "out of memory for %zu MB\n", bytes >> 20);
+        exit(1);
+    }
+    memset(p, 1, bytes);    /* Fault every page in before timing */
+    return p;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t bytes = 64 << 20, mmio_bytes = 4096;
+    unsigned long offset = 0;
+    const char *mmio = NULL;
+    struct mmio m = { 4, 1, 0, 0 };
+    int threads = sysconf(_SC_NPROCESSORS_ONLN), runs = 5, opt;
+    char *src, *dst;
+
+    while ((opt = getopt(argc, argv, "cs:t:r:M:a:n:b:w:o")) != -1)
+        switch (opt)
+        {
+        case 'c':
+            csv = 1;
+            break;
+        case 's':
+            bytes = (size_t)atol(optarg) << 20;
+            break;
+        case 't':
+            threads = atoi(optarg);
+            break;
+        case 'r':
+            runs = atoi(optarg);
+            break;
+        case 'M':
+            mmio = optarg;
+            break;
+        case 'a':
+            offset = strtoul(optarg, NULL, 0);
+            break;
+        case 'n':
+            mmio_bytes = strtoul(optarg, NULL, 0);
+            break;
+        case 'b':
+            m.width = atoi(optarg) == 1 ? 1 : 4;
+            break;
+        case 'w':
+            m.write = 1;
+            m.value = strtoul(optarg, NULL, 0);
+            break;
+        case 'o':
+            m.readable = 0;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-c] [-s MB] [-t threads] [-r runs] "
+                    "[-M file] [-a offset] [-n bytes] [-b width] "
+                    "[-w value] [-o]\n", argv[0]);
+            return 1;
+        }
+    if (threads < 1)
+        threads = 1;
+    if (threads > MAX_THREADS)
+        threads = MAX_THREADS;
+    if (runs < 1)
+        runs = 1;
+
+    if (mmio)
+    {
+        if (mmio_bytes < (size_t)m.width)
+            mmio_bytes = m.width;
+        return run_mmio(mmio, offset, mmio_bytes / m.width * m.width, &m,
+                        runs);
+    }
+
+    line_size = cache_line();
+    if (bytes < LAT_MIN_BYTES)
+        bytes = LAT_MIN_BYTES;
+    src = alloc_buffer(bytes);
+    dst = alloc_buffer(bytes);
+
+    if (!csv)
+        printf("%zu MB buffers, %zu-byte lines, vector unit: %s\n",
+               bytes >> 20, line_size, simd_name);
+    bench_bandwidth(dst, src, bytes, threads, runs);
+    bench_latency(src, bytes, runs);
+    free(src);
+    free(dst);
+    return 0;
+}
@@ -0,0 +1,109 @@
+/*
+ * Benchmark for the many-ball physics module
+ *
+ * Scatters balls over the 640x480 screen and times integration alone
+ * and full steps (integration plus collisions), reporting balls/ms for
+ * the vector and scalar integrators.
+ *
+ * Usage: physics_bench [-n balls] [-s steps] [-r radius]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include "ball_physics.h"
+
+static double now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static float frand(float lo, float hi)
+{
+    return lo + (hi - lo) * (rand() / (float)RAND_MAX);
+}
+
+static int populate(struct ball_world *w, int n, float radius)
+{
+    int i;
+
+    if (ball_world_init(w, n, 640, 480, radius))
+        return -1;
+    srand(1);
+    for (i = 0; i < n; i++)
+        ball_world_add(w, frand(radius, 640 - radius),
+                       frand(radius, 480 - radius),
+                       frand(-2, 2), frand(-2, 2));
+    return 0;
+}
+
+static void run(int n, int steps, float radius, int simd)
+{
+    struct ball_world w;
+    double t0, integrate_ms, step_ms;
+    int s;
+
+    if (populate(&w, n, radius))
+    {
+        fprintf(stderr, "out of memory for %d balls\n", n);
+        exit(1);
+    }
+    w.simd = simd;
+
+    t0 = now_ms();
+    for (s = 0; s < steps; s++)
+        ball_world_integrate(&w);
+    integrate_ms = now_ms() - t0;
+
+    t0 = now_ms();
+    for (s = 0; s < steps; s++)
+        ball_world_step(&w);
+    step_ms = now_ms() - t0;
+
+    printf("%7d  %-6s  %12.0f  %12.0f  %13.1f\n", n,
+           simd ? ball_physics_simd_name : "scalar",
+           (double)n * steps / integrate_ms, (double)n * steps / step_ms,
+           (double)w.collisions / steps);
+    ball_world_free(&w);
+}
+
+int main(int argc, char *argv[])
+{
+    static const int sizes[] = { 1000, 4000, 16000, 64000 };
+    int n = 0, steps = 200, opt, i;
+    float radius = 2;
+
+    while ((opt = getopt(argc, argv, "n:s:r:")) != -1)
+        switch (opt)
+        {
+        case 'n':
+            n = atoi(optarg);
+            break;
+        case 's':
+            steps = atoi(optarg);
+            break;
+        case 'r':
+            radius = atof(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-n balls] [-s steps] [-r radius]\n",
+                    argv[0]);
+            return 1;
+        }
+
+    printf("  balls  simd    integrate/ms       step/ms  contacts/step\n");
+    for (i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++)
+    {
+        int balls = n ? n : sizes[i];
+
+        run(balls, steps, radius, 1);
+        run(balls, steps, radius, 0);
+        if (n)
+            break;
+    }
+    return 0;
+}
@@ -0,0 +1,159 @@
+/*
+ * Compare frame wakeup latency as a normal task and in real-time mode
+ *
+ * Runs the frame_sched loop that display clients use for a number of
+ * VGA frames as a normal task, then again in real-time mode, and prints
+ * both wakeup latency distributions side by side.  Optional background
+ * load -- threads that stream through memory and yield to nobody --
+ * stands in for whatever else the board is doing in production.
+ *
+ * Usage: rt_latency [-f frames] [-l load threads] [-p priority] [-c cpu]
+ *   -p  SCHED_FIFO priority for the real-time run (default 80)
+ *   -c  pin the real-time run to this CPU
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "frame_sched.h"
+#include "rt_runtime.h"
+
+#define LOAD_BYTES (1024 * 1024)
+
+struct run {
+    char name[64];
+    long long *wake;     /* Nanoseconds past each deadline, sorted */
+    long n;
+    unsigned long missed;
+};
+
+static volatile int stop_load;
+
+/* Background load: keep a CPU and the memory bus busy */
+static void *load(void *unused)
+{
+    unsigned char *buf = malloc(LOAD_BYTES);
+    unsigned int i = 0;
+
+    if (buf == NULL)
+        return NULL;
+    while (!stop_load)
+        memset(buf, i++, LOAD_BYTES);
+    free(buf);
+    return NULL;
+}
+
+static long long ts_ns(const struct timespec *ts)
+{
+    return ts->tv_sec * 1000000000LL + ts->tv_nsec;
+}
+
+static int cmp_ll(const void *a, const void *b)
+{
+    long long x = *(const long long *)a, y = *(const long long *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static void measure(struct run *r, long frames)
+{
+    struct frame_sched fs;
+    long long deadline;
+
+    if ((r->wake = malloc(frames * sizeof(*r->wake))) == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    frame_sched_init(&fs, VGA_FRAME_NS);
+    for (r->n = 0; r->n < frames; r->n++)
+    {
+        deadline = ts_ns(&fs.next);
+        frame_sched_wait(&fs);
+        r->wake[r->n] = ts_ns(&fs.woke) - deadline;
+    }
+    r->missed = fs.missed;
+    qsort(r->wake, r->n, sizeof(*r->wake), cmp_ll);
+}
+
+static void report(const struct run *r)
+{
+    long long sum = 0;
+    long i;
+
+    for (i = 0; i < r->n; i++)
+        sum += r->wake[i];
+    printf("%-28s %7ld %8.1f %8.1f %8.1f %8.1f %8.1f %8.1f %7lu\n", r->name,
+           r->n, r->wake[0] / 1e3, sum / r->n / 1e3, r->wake[r->n / 2] / 1e3,
+           r->wake[r->n * 99 / 100] / 1e3, r->wake[r->n * 999 / 1000] / 1e3,
+           r->wake[r->n - 1] / 1e3, r->missed);
+}
+
+int main(int argc, char *argv[])
+{
+    struct rt_config rt;
+    struct run normal, realtime;
+    long frames = 600;
+    int threads = 0, opt, i;
+    pthread_t *loaders;
+    char desc[48];
+
+    rt_config_default(&rt);
+    while ((opt = getopt(argc, argv, "f:l:p:c:")) != -1)
+        switch (opt)
+        {
+        case 'f':
+            frames = atol(optarg);
+            break;
+        case 'l':
+            threads = atoi(optarg);
+            break;
+        case 'p':
+            if (rt_parse_priority(optarg, &rt.priority))
+                return 1;
+            break;
+        case 'c':
+            rt.cpu = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-f frames] [-l load threads] "
+                    "[-p priority] [-c cpu]\n", argv[0]);
+            return 1;
+        }
+    if (frames <= 0)
+        frames = 1;
+
+    if ((loaders = calloc(threads + 1, sizeof(*loaders))) == NULL)
+        return 1;
+    for (i = 0; i < threads; i++)
+        if (pthread_create(&loaders[i], NULL, load, NULL))
+        {
+            fprintf(stderr, "could not start load thread\n");
+            return 1;
+        }
+
+    printf("%ld frames of %.1f ms, %d load threads\n", frames,
+           VGA_FRAME_NS / 1e6, threads);
+
+    snprintf(normal.name, sizeof(normal.name), "normal");
+    measure(&normal, frames);
+
+    /* The normal run is measured first, so the memory settings come after
+       the load threads start: they allocated once, a whole run ago */
+    rt_describe(&rt, desc, sizeof(desc));
+    snprintf(realtime.name, sizeof(realtime.name), "%s%s", desc,
+             rt_apply_memory(&rt) | rt_apply(&rt) ? " (partial)" : "");
+    measure(&realtime, frames);
+
+    stop_load = 1;
+    for (i = 0; i < threads; i++)
+        pthread_join(loaders[i], NULL);
+
+    printf("\nwakeup latency (us)          %7s %8s %8s %8s %8s %8s %8s %7s\n",
+           "n", "min", "avg", "p50", "p99", "p99.9", "max", "missed");
+    report(&normal);
+    report(&realtime);
+    return 0;
+}
@@ -0,0 +1,176 @@
+/*
+ * Real-time setup for display threads; see rt_runtime.h
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <alloca.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include "rt_runtime.h"
+
+/* Everything off: a normal task */
+void rt_config_init(struct rt_config *c)
+{
+    c->priority = 0;
+    c->cpu = -1;
+    c->lock_memory = 0;
+    c->stack_bytes = 0;
+    c->heap_bytes = 0;
+}
+
+/* Full real-time mode, without pinning */
+void rt_config_default(struct rt_config *c)
+{
+    rt_config_init(c);
+    rt_config_realtime(c);
+}
+
+/*
+ * Turn on real-time mode in a configuration that may already carry
+ * options: a priority or CPU set before is kept
+ */
+void rt_config_realtime(struct rt_config *c)
+{
+    if (c->priority == 0)
+        c->priority = RT_DEFAULT_PRIORITY;
+    c->lock_memory = 1;
+    c->stack_bytes = RT_DEFAULT_STACK;
+    c->heap_bytes = RT_DEFAULT_HEAP;
+}
+
+/*
+ * Read a -p option's SCHED_FIFO priority: -1, after saying why, if it is
+ * not a number in the range the kernel takes for SCHED_FIFO
+ */
+int rt_parse_priority(const char *arg, int *priority)
+{
+    int min = sched_get_priority_min(SCHED_FIFO);
+    int max = sched_get_priority_max(SCHED_FIFO);
+    char *end;
+    long p;
+
+    p = strtol(arg, &end, 10);
+    if (*arg == '\0' || *end != '\0' || p < min || p > max)
+    {
+        fprintf(stderr, "SCHED_FIFO priority must be %d to %d, not %s\n",
+                min, max, arg);
+        return -1;
+    }
+    *priority = p;
+    return 0;
+}
+
+/* Touch one byte per page of a stack frame this deep, then return */
+static void __attribute__((noinline)) prefault_stack(size_t bytes)
+{
+    volatile unsigned char *p = alloca(bytes);
+    long page = sysconf(_SC_PAGESIZE);
+    size_t i;
+
+    for (i = 0; i < bytes; i += page)
+        p[i] = 0;
+}
+
+/*
+ * Fault in heap pages and hand them back to malloc, which with trimming
+ * and mmap disabled keeps them for later allocations
+ */
+static int prefault_heap(size_t bytes)
+{
+    long page = sysconf(_SC_PAGESIZE);
+    unsigned char *p;
+    size_t i;
+
+    if ((p = malloc(bytes)) == NULL)
+        return -1;
+    for (i = 0; i < bytes; i += page)
+        p[i] = 0;
+    free(p);
+    return 0;
+}
+
+/*
+ * Apply a configuration's memory settings to the process, before it
+ * starts threads.  Every step is attempted; returns -1 if any failed,
+ * after saying which
+ */
+int rt_apply_memory(const struct rt_config *c)
+{
+    int ret = 0;
+
+    if (c->lock_memory)
+    {
+        mallopt(M_TRIM_THRESHOLD, -1);
+        mallopt(M_MMAP_MAX, 0);
+        if (mlockall(MCL_CURRENT | MCL_FUTURE))
+        {
+            perror("mlockall");
+            ret = -1;
+        }
+    }
+    if (c->heap_bytes && prefault_heap(c->heap_bytes))
+    {
+        fprintf(stderr, "could not preallocate %zu bytes of heap\n",
+                c->heap_bytes);
+        ret = -1;
+    }
+    return ret;
+}
+
+/*
+ * Apply a configuration to the calling thread, after rt_apply_memory().
+ * Every step is attempted; returns -1 if any failed, after saying which
+ */
+int rt_apply(const struct rt_config *c)
+{
+    struct sched_param sp;
+    cpu_set_t set;
+    int ret = 0, err;
+
+    if (c->stack_bytes)
+        prefault_stack(c->stack_bytes);
+
+    if (c->cpu >= 0)
+    {
+        CPU_ZERO(&set);
+        CPU_SET(c->cpu, &set);
+        if ((err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set)))
+        {
+            fprintf(stderr, "could not pin to CPU %d: %s\n", c->cpu,
+                    strerror(err));
+            ret = -1;
+        }
+    }
+    if (c->priority > 0)
+    {
+        sp.sched_priority = c->priority;
+        if ((err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp)))
+        {
+            fprintf(stderr, "could not set SCHED_FIFO priority %d: %s\n",
+                    c->priority, strerror(err));
+            ret = -1;
+        }
+    }
+    return ret;
+}
+
+/* One-line summary for reports, e.g. "fifo 80, cpu 1, locked" */
+void rt_describe(const struct rt_config *c, char *buf, size_t len)
+{
+    int n;
+
+    if (c->priority > 0)
+        n = snprintf(buf, len, "fifo %d", c->priority);
+    else
+        n = snprintf(buf, len, "normal");
+    if (c->cpu >= 0 && n < (int)len)
+        n += snprintf(buf + n, len - n, ", cpu %d", c->cpu);
+    if (c->lock_memory && n < (int)len)
+        snprintf(buf + n, len - n, ", locked");
+}
@@ -0,0 +1,47 @@
+#ifndef _RT_RUNTIME_H
+#define _RT_RUNTIME_H
+
+#include <stddef.h>
+
+/*
+ * Real-time setup for display threads
+ *
+ * A frame deadline is only as good as the wakeup behind it.  Under load
+ * a normal CFS task can wait several milliseconds for the CPU, and a
+ * page fault in the frame loop costs more still, so a display thread
+ * can ask for
+ *   - SCHED_FIFO at a chosen priority, ahead of every normal task
+ *   - pinning to one CPU, away from whatever the scheduler migrates
+ *   - mlockall() of current and future pages, so nothing is paged out
+ *   - a prefaulted stack and heap, kept by malloc rather than returned
+ *     to the kernel, so later allocations do not fault either
+ *
+ * Scheduling, affinity and the stack apply to the calling thread only
+ * (rt_apply); memory settings apply to the whole process
+ * (rt_apply_memory), before it starts other threads, so that their
+ * allocations follow them too.  Priority and locking need root or
+ * CAP_SYS_NICE / CAP_IPC_LOCK.
+ */
+
+struct rt_config {
+    int priority;         /* SCHED_FIFO priority, 1-99; 0 stays SCHED_OTHER */
+    int cpu;              /* CPU to pin to; -1 leaves affinity alone */
+    int lock_memory;      /* mlockall() and keep freed heap in the process */
+    size_t stack_bytes;   /* Stack to touch now */
+    size_t heap_bytes;    /* Heap to touch now and keep for later mallocs */
+};
+
+/* What -r selects in the clients: well above kernel threads' default 50 */
+#define RT_DEFAULT_PRIORITY 80
+#define RT_DEFAULT_STACK    (256 * 1024)
+#define RT_DEFAULT_HEAP     (4 * 1024 * 1024)
+
+void rt_config_init(struct rt_config *c);
+void rt_config_default(struct rt_config *c);
+void rt_config_realtime(struct rt_config *c);
+int rt_parse_priority(const char *arg, int *priority);
+int rt_apply_memory(const struct rt_config *c);
+int rt_apply(const struct rt_config *c);
+void rt_describe(const struct rt_config *c, char *buf, size_t len);
+
+#endif
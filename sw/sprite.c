@@ -0,0 +1,88 @@
+/*
+ * Mapping sprite packs and copying them into sprite memory; see sprite.h
+ */
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "sprite.h"
+
+/* Map a pack read-only and check that everything it points at is there */
+const struct sprite_pack_header *sprite_pack_map(const char *path,
+                                                 size_t *size)
+{
+    const struct sprite_pack_header *h;
+    struct stat st;
+    int fd;
+
+    if ((fd = open(path, O_RDONLY)) == -1)
+        return NULL;
+    if (fstat(fd, &st) == -1 || st.st_size < (off_t)sizeof(*h))
+    {
+        close(fd);
+        return NULL;
+    }
+    h = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (h == MAP_FAILED)
+        return NULL;
+
+    if (h->magic != SPRITE_PACK_MAGIC || h->version != SPRITE_PACK_VERSION ||
+        h->sprite_bytes != VGA_BALL_SPRITE_BYTES ||
+        h->width != VGA_BALL_SPRITE_SIZE || h->height != VGA_BALL_SPRITE_SIZE ||
+        h->palette_offset % 4 || h->sprite_offset % VGA_BALL_SPRITE_BYTES ||
+        st.st_size < VGA_BALL_PALETTE_BYTES ||
+        h->palette_offset > st.st_size - VGA_BALL_PALETTE_BYTES ||
+        h->sprite_offset > st.st_size ||
+        h->count > (st.st_size - h->sprite_offset) / h->sprite_bytes)
+    {
+        munmap((void *)h, st.st_size);
+        return NULL;
+    }
+    *size = st.st_size;
+    return h;
+}
+
+void sprite_pack_unmap(const struct sprite_pack_header *h, size_t size)
+{
+    munmap((void *)h, size);
+}
+
+/*
+ * Copy to device memory with aligned 32-bit stores: memcpy() may use
+ * unaligned or vector accesses, which device mappings do not allow.
+ * The interconnect splits each word into byte writes for the 8-bit
+ * slave.  Both ends and the length must be multiples of 4.
+ */
+void sprite_copy(volatile void *dst, const void *src, size_t bytes)
+{
+    volatile uint32_t *d = dst;
+    const uint32_t *s = src;
+    size_t i;
+
+    for (i = 0; i < bytes / 4; i++)
+        d[i] = s[i];
+}
+
+/*
+ * Load the palette and sprites first .. first + frames - 1 into sprite
+ * frames 0 .. frames - 1 of a device mapping
+ */
+int sprite_upload(volatile uint8_t *dev, const struct sprite_pack_header *h,
+                  int first, int frames)
+{
+    int i;
+
+    if (first < 0 || frames < 1 || frames > VGA_BALL_SPRITE_FRAMES ||
+        first + frames > h->count)
+        return -1;
+
+    sprite_copy(dev + VGA_BALL_PALETTE, sprite_pack_palette(h),
+                VGA_BALL_PALETTE_BYTES);
+    for (i = 0; i < frames; i++)
+        sprite_copy(dev + VGA_BALL_SPRITE_MEM + i * VGA_BALL_SPRITE_BYTES,
+                    sprite_pack_sprite(h, first + i), VGA_BALL_SPRITE_BYTES);
+    return 0;
+}
@@ -0,0 +1,58 @@
+#ifndef _SPRITE_H
+#define _SPRITE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "vga_ball.h"
+
+/*
+ * Sprite packs, as written by sprpack
+ *
+ * Everything in a pack is already in the layout of the peripheral's
+ * sprite memory (see vga_ball.h), so a client maps the file, checks the
+ * header in place and copies blocks straight into an mmap() of the
+ * device: nothing is parsed or converted on the way.
+ *
+ *   0            struct sprite_pack_header
+ *   palette      VGA_BALL_PALETTE_BYTES, hardware palette layout;
+ *                entry 0 is the transparent color
+ *   sprite       count blocks of VGA_BALL_SPRITE_BYTES, each aligned to
+ *                its size in the file
+ *
+ * Fields are little-endian, like the HPS.
+ */
+
+#define SPRITE_PACK_MAGIC   0x50534756   /* "VGSP" */
+#define SPRITE_PACK_VERSION 1
+
+struct sprite_pack_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;              /* Sprites in the pack */
+    uint32_t palette_offset;
+    uint32_t sprite_offset;
+    uint32_t sprite_bytes;       /* VGA_BALL_SPRITE_BYTES */
+    uint16_t width, height;      /* VGA_BALL_SPRITE_SIZE */
+    uint8_t reserved[40];
+};
+
+const struct sprite_pack_header *sprite_pack_map(const char *path,
+                                                 size_t *size);
+void sprite_pack_unmap(const struct sprite_pack_header *h, size_t size);
+
+static inline const void *sprite_pack_palette(const struct sprite_pack_header *h)
+{
+    return (const uint8_t *)h + h->palette_offset;
+}
+
+static inline const void *sprite_pack_sprite(const struct sprite_pack_header *h,
+                                             int i)
+{
+    return (const uint8_t *)h + h->sprite_offset + (size_t)i * h->sprite_bytes;
+}
+
+void sprite_copy(volatile void *dst, const void *src, size_t bytes);
+int sprite_upload(volatile uint8_t *dev, const struct sprite_pack_header *h,
+                  int first, int frames);
+
+#endif
@@ -0,0 +1,191 @@
+/*
+ * Load sprites from a pack (see sprite.h) into the peripheral
+ *
+ * Maps both the pack and the device's register page and copies the
+ * palette and up to four sprites from one mapping to the other, then
+ * turns on sprite drawing.  With -a the loaded frames are cycled like a
+ * flip book, which costs one control register write per step.
+ *
+ * Usage: sprload [-d device] [-s first] [-n frames] [-a display frames]
+ *                [-m [-o image.ppm]] pack.vgsp
+ *   -s  first sprite of the pack to load (default 0)
+ *   -n  how many to load into sprite frames 0.. (default all, up to 4)
+ *   -a  show each loaded frame this many display frames, until ^C
+ *   -m  load into the software model; -o saves what it would display,
+ *       with the ball moved to the middle of the screen
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/mman.h>
+#include "sprite.h"
+#include "vga_model.h"
+#include "frame_sched.h"
+
+static volatile sig_atomic_t done;
+
+static void handle_sigint(int sig)
+{
+    done = 1;
+}
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Replay what landed in a stand-in page into the model, byte by byte */
+static void model_apply(struct vga_model *m, const uint8_t *page,
+                        unsigned int offset, unsigned int bytes)
+{
+    unsigned int i;
+
+    for (i = offset; i < offset + bytes; i++)
+        vga_model_store(m, i, page[i]);
+}
+
+static int write_ppm(const char *path, const struct vga_model *m)
+{
+    static unsigned char rgb[VGA_MODEL_WIDTH * VGA_MODEL_HEIGHT * 3];
+    FILE *f;
+
+    vga_model_render(m, rgb);
+    if ((f = fopen(path, "wb")) == NULL)
+        return -1;
+    fprintf(f, "P6\n%d %d\n255\n", VGA_MODEL_WIDTH, VGA_MODEL_HEIGHT);
+    fwrite(rgb, sizeof(rgb), 1, f);
+    return fclose(f);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *device = "/dev/vga_ball", *image = NULL;
+    static uint8_t model_page[VGA_BALL_MAP_SIZE] __attribute__((aligned(4096)));
+    const struct sprite_pack_header *h;
+    volatile uint8_t *dev;
+    struct vga_model model;
+    struct frame_sched fs;
+    int first = 0, frames = -1, step = 0, use_model = 0, fd = -1, opt, f;
+    long long t0, t1;
+    size_t size;
+
+    while ((opt = getopt(argc, argv, "d:s:n:a:mo:")) != -1)
+        switch (opt)
+        {
+        case 'd':
+            device = optarg;
+            break;
+        case 's':
+            first = atoi(optarg);
+            break;
+        case 'n':
+            frames = atoi(optarg);
+            break;
+        case 'a':
+            step = atoi(optarg);
+            break;
+        case 'm':
+            use_model = 1;
+            break;
+        case 'o':
+            image = optarg;
+            break;
+        default:
+            goto usage;
+        }
+    if (optind != argc - 1)
+        goto usage;
+
+    if ((h = sprite_pack_map(argv[optind], &size)) == NULL)
+    {
+        fprintf(stderr, "%s: not a sprite pack\n", argv[optind]);
+        return 1;
+    }
+    if (frames < 0)
+        frames = h->count - first < VGA_BALL_SPRITE_FRAMES ?
+            h->count - first : VGA_BALL_SPRITE_FRAMES;
+
+    if (use_model)
+    {
+        vga_model_init(&model);
+        dev = model_page;
+    }
+    else
+    {
+        if ((fd = open(device, O_RDWR | O_SYNC)) == -1)
+        {
+            fprintf(stderr, "could not open %s\n", device);
+            return 1;
+        }
+        dev = mmap(NULL, VGA_BALL_MAP_SIZE, PROT_READ | PROT_WRITE,
+                   MAP_SHARED, fd, 0);
+        if (dev == MAP_FAILED)
+        {
+            perror("mmap");
+            return 1;
+        }
+    }
+
+    t0 = now_ns();
+    if (sprite_upload(dev, h, first, frames))
+    {
+        fprintf(stderr, "cannot load sprites %d..%d of %d\n", first,
+                first + frames - 1, h->count);
+        return 1;
+    }
+    dev[VGA_BALL_CTRL] = VGA_BALL_CTRL_SPRITE | VGA_BALL_CTRL_FRAME(0);
+    t1 = now_ns();
+
+    printf("loaded %d sprites (%d bytes) in %lld us\n", frames,
+           VGA_BALL_PALETTE_BYTES + frames * VGA_BALL_SPRITE_BYTES,
+           (t1 - t0) / 1000);
+
+    if (use_model)
+    {
+        model_apply(&model, model_page, VGA_BALL_PALETTE,
+                    VGA_BALL_PALETTE_BYTES);
+        model_apply(&model, model_page, VGA_BALL_SPRITE_MEM,
+                    frames * VGA_BALL_SPRITE_BYTES);
+        model_apply(&model, model_page, VGA_BALL_CTRL, 1);
+        if (image)
+        {
+            vga_model_store(&model, VGA_BALL_REG_X_LSB, (320 << 6) & 0xff);
+            vga_model_store(&model, VGA_BALL_REG_X_MSB, (320 << 6) >> 8);
+            vga_model_store(&model, VGA_BALL_REG_Y_LSB, (240 << 6) & 0xff);
+            vga_model_store(&model, VGA_BALL_REG_Y_MSB, (240 << 6) >> 8);
+            if (write_ppm(image, &model))
+                perror(image);
+        }
+    }
+    else if (step > 0)
+    {
+        signal(SIGINT, handle_sigint);
+        frame_sched_init(&fs, VGA_FRAME_NS * step);
+        for (f = 0; !done; f = (f + 1) % frames)
+        {
+            frame_sched_wait(&fs);
+            dev[VGA_BALL_CTRL] = VGA_BALL_CTRL_SPRITE | VGA_BALL_CTRL_FRAME(f);
+        }
+    }
+
+    sprite_pack_unmap(h, size);
+    if (fd != -1)
+    {
+        munmap((void *)dev, VGA_BALL_MAP_SIZE);
+        close(fd);
+    }
+    return 0;
+
+usage:
+    fprintf(stderr, "usage: %s [-d device] [-s first] [-n frames] "
+            "[-a display frames] [-m [-o image.ppm]] pack.vgsp\n", argv[0]);
+    return 1;
+}
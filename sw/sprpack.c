@@ -0,0 +1,281 @@
+/*
+ * Build a sprite pack (see sprite.h) from PPM images
+ *
+ * Each image is cut into 32x32 tiles, left to right and then top to
+ * bottom, and every tile becomes one sprite.  All sprites share one
+ * 16-entry palette: entry 0 is transparent and is used wherever the
+ * image has the key color; the 15 most common other colors fill the
+ * rest, and any further colors map to the nearest of those.
+ *
+ * Only binary PPM (P6, maxval 255) is read; convert PNGs first, e.g.
+ * with pngtopnm or ImageMagick's convert.
+ *
+ * Usage: sprpack [-k rrggbb] -o pack.vgsp image.ppm ...
+ *   -k  transparent key color (default ff00ff)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include "sprite.h"
+
+#define PALETTE_SIZE   16
+#define PALETTE_OFFSET sizeof(struct sprite_pack_header)
+#define SPRITE_OFFSET  VGA_BALL_SPRITE_BYTES
+
+struct image {
+    const char *path;
+    int width, height;
+    unsigned char *rgb;
+};
+
+struct color_count {
+    uint32_t color;
+    long count;
+};
+
+/* Next number in a PPM header, skipping whitespace and comments */
+static int ppm_number(FILE *f)
+{
+    int c, n = 0;
+
+    while ((c = getc(f)) != EOF && (isspace(c) || c == '#'))
+        if (c == '#')
+            while ((c = getc(f)) != EOF && c != '\n')
+                ;
+    if (!isdigit(c))
+        return -1;
+    do
+        n = n * 10 + c - '0';
+    while ((c = getc(f)) != EOF && isdigit(c));
+    return n;    /* The one whitespace after it is consumed */
+}
+
+static int read_ppm(struct image *im)
+{
+    size_t bytes;
+    FILE *f;
+
+    if ((f = fopen(im->path, "rb")) == NULL)
+    {
+        perror(im->path);
+        return -1;
+    }
+    if (getc(f) != 'P' || getc(f) != '6' ||
+        (im->width = ppm_number(f)) <= 0 ||
+        (im->height = ppm_number(f)) <= 0 || ppm_number(f) != 255)
+    {
+        fprintf(stderr, "%s: not a binary PPM with maxval 255\n", im->path);
+        fclose(f);
+        return -1;
+    }
+    bytes = (size_t)im->width * im->height * 3;
+    if ((im->rgb = malloc(bytes)) == NULL || fread(im->rgb, bytes, 1, f) != 1)
+    {
+        fprintf(stderr, "%s: short image\n", im->path);
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    return 0;
+}
+
+static uint32_t pixel(const struct image *im, int x, int y)
+{
+    const unsigned char *p = im->rgb + ((size_t)y * im->width + x) * 3;
+
+    return p[0] << 16 | p[1] << 8 | p[2];
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static int cmp_count(const void *a, const void *b)
+{
+    const struct color_count *x = a, *y = b;
+
+    return x->count < y->count ? 1 : x->count > y->count ? -1 : 0;
+}
+
+/*
+ * Pick up to 15 colors by popularity; returns how many distinct
+ * non-key colors the images had
+ */
+static long build_palette(const struct image *im, int nimages, uint32_t key,
+                          uint32_t *palette, int *npalette)
+{
+    struct color_count *counts;
+    uint32_t *all, c;
+    size_t total = 0, n = 0, i;
+    long distinct = 0;
+    int k, x, y;
+
+    for (k = 0; k < nimages; k++)
+        total += (size_t)im[k].width * im[k].height;
+    if ((all = malloc(total * sizeof(*all))) == NULL ||
+        (counts = malloc(total * sizeof(*counts))) == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    for (k = 0; k < nimages; k++)
+        for (y = 0; y < im[k].height; y++)
+            for (x = 0; x < im[k].width; x++)
+                if ((c = pixel(&im[k], x, y)) != key)
+                    all[n++] = c;
+
+    qsort(all, n, sizeof(*all), cmp_u32);
+    for (i = 0; i < n; i++)
+    {
+        if (i == 0 || all[i] != all[i - 1])
+        {
+            counts[distinct].color = all[i];
+            counts[distinct++].count = 0;
+        }
+        counts[distinct - 1].count++;
+    }
+    qsort(counts, distinct, sizeof(*counts), cmp_count);
+
+    *npalette = distinct < PALETTE_SIZE - 1 ? distinct : PALETTE_SIZE - 1;
+    for (k = 0; k < *npalette; k++)
+        palette[k + 1] = counts[k].color;
+    free(all);
+    free(counts);
+    return distinct;
+}
+
+/* Palette index for a pixel: 0 for the key, else the nearest entry */
+static int palette_index(uint32_t c, uint32_t key, const uint32_t *palette,
+                         int npalette)
+{
+    long best_d = -1, d, dr, dg, db;
+    int best = 1, i;
+
+    if (c == key)
+        return 0;
+    for (i = 1; i <= npalette; i++)
+    {
+        dr = (long)(c >> 16) - (palette[i] >> 16);
+        dg = (long)((c >> 8) & 0xff) - ((palette[i] >> 8) & 0xff);
+        db = (long)(c & 0xff) - (palette[i] & 0xff);
+        d = dr * dr + dg * dg + db * db;
+        if (best_d < 0 || d < best_d)
+        {
+            best_d = d;
+            best = i;
+        }
+    }
+    return best;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *out_path = NULL;
+    uint32_t key = 0xff00ff, palette[PALETTE_SIZE] = { 0 };
+    struct sprite_pack_header *h;
+    struct image *im;
+    unsigned char *pack, *dst, *pal;
+    int nimages, npalette, opt, k, i, tx, ty, x, y, lo, hi;
+    long distinct, count = 0, sprite = 0;
+    size_t size;
+    FILE *f;
+
+    while ((opt = getopt(argc, argv, "k:o:")) != -1)
+        switch (opt)
+        {
+        case 'k':
+            key = strtoul(optarg, NULL, 16);
+            break;
+        case 'o':
+            out_path = optarg;
+            break;
+        default:
+            goto usage;
+        }
+    if (out_path == NULL || optind == argc)
+        goto usage;
+
+    nimages = argc - optind;
+    if ((im = calloc(nimages, sizeof(*im))) == NULL)
+        return 1;
+    for (k = 0; k < nimages; k++)
+    {
+        im[k].path = argv[optind + k];
+        if (read_ppm(&im[k]))
+            return 1;
+        if (im[k].width % VGA_BALL_SPRITE_SIZE ||
+            im[k].height % VGA_BALL_SPRITE_SIZE)
+        {
+            fprintf(stderr, "%s: %dx%d is not a whole number of %d-pixel "
+                    "tiles\n", im[k].path, im[k].width, im[k].height,
+                    VGA_BALL_SPRITE_SIZE);
+            return 1;
+        }
+        count += (im[k].width / VGA_BALL_SPRITE_SIZE) *
+            (im[k].height / VGA_BALL_SPRITE_SIZE);
+    }
+    if (count > 0xffff)
+    {
+        fprintf(stderr, "too many sprites (%ld)\n", count);
+        return 1;
+    }
+
+    distinct = build_palette(im, nimages, key, palette, &npalette);
+
+    size = SPRITE_OFFSET + count * VGA_BALL_SPRITE_BYTES;
+    if ((pack = calloc(1, size)) == NULL)
+        return 1;
+    h = (struct sprite_pack_header *)pack;
+    h->magic = SPRITE_PACK_MAGIC;
+    h->version = SPRITE_PACK_VERSION;
+    h->count = count;
+    h->palette_offset = PALETTE_OFFSET;
+    h->sprite_offset = SPRITE_OFFSET;
+    h->sprite_bytes = VGA_BALL_SPRITE_BYTES;
+    h->width = h->height = VGA_BALL_SPRITE_SIZE;
+
+    pal = pack + PALETTE_OFFSET;
+    for (i = 0; i < PALETTE_SIZE; i++)
+    {
+        pal[i * 4] = palette[i] >> 16;
+        pal[i * 4 + 1] = palette[i] >> 8;
+        pal[i * 4 + 2] = palette[i];
+    }
+
+    for (k = 0; k < nimages; k++)
+        for (ty = 0; ty < im[k].height; ty += VGA_BALL_SPRITE_SIZE)
+            for (tx = 0; tx < im[k].width; tx += VGA_BALL_SPRITE_SIZE)
+            {
+                dst = pack + SPRITE_OFFSET + sprite++ * VGA_BALL_SPRITE_BYTES;
+                for (y = 0; y < VGA_BALL_SPRITE_SIZE; y++)
+                    for (x = 0; x < VGA_BALL_SPRITE_SIZE; x += 2)
+                    {
+                        lo = palette_index(pixel(&im[k], tx + x, ty + y),
+                                           key, palette, npalette);
+                        hi = palette_index(pixel(&im[k], tx + x + 1, ty + y),
+                                           key, palette, npalette);
+                        *dst++ = lo | hi << 4;
+                    }
+            }
+
+    if ((f = fopen(out_path, "wb")) == NULL ||
+        fwrite(pack, size, 1, f) != 1 || fclose(f))
+    {
+        perror(out_path);
+        return 1;
+    }
+    printf("%s: %ld sprites, %ld colors%s, %zu bytes\n", out_path, count,
+           distinct, distinct > npalette ? " (reduced to 15)" : "", size);
+    return 0;
+
+usage:
+    fprintf(stderr, "usage: %s [-k rrggbb] -o pack.vgsp image.ppm ...\n",
+            argv[0]);
+    return 1;
+}
@@ -0,0 +1,63 @@
+#ifndef _TRIPLE_BUFFER_H
+#define _TRIPLE_BUFFER_H
+
+/*
+ * Lock-free triple buffer for handing state from one producer thread to
+ * one consumer thread
+ *
+ * The producer always has a private slot to fill and the consumer always
+ * has a private slot to read; the third slot sits between them.
+ * Publishing swaps the producer's slot with the middle one and marks it
+ * fresh; reading swaps the consumer's slot with the middle one only if a
+ * fresh state is waiting.  Neither side ever blocks, and the consumer
+ * always sees the most recent complete state.
+ */
+
+#define TB_FRESH 4  /* Set in middle when it holds an unread state */
+#define TB_INDEX 3
+
+struct triple_buffer {
+    void *slot[3];
+    unsigned write;   /* Producer's slot; touched only by the producer */
+    unsigned read;    /* Consumer's slot; touched only by the consumer */
+    unsigned middle;  /* Shared slot index and TB_FRESH; accessed atomically */
+};
+
+static inline void tb_init(struct triple_buffer *tb, void *a, void *b, void *c)
+{
+    tb->slot[0] = a;
+    tb->slot[1] = b;
+    tb->slot[2] = c;
+    tb->write = 0;
+    tb->middle = 1;
+    tb->read = 2;
+}
+
+/* The slot the producer should fill before calling tb_publish() */
+static inline void *tb_write_slot(struct triple_buffer *tb)
+{
+    return tb->slot[tb->write];
+}
+
+/* Make the producer's slot the latest state, dropping any unread one */
+static inline void tb_publish(struct triple_buffer *tb)
+{
+    tb->write = __atomic_exchange_n(&tb->middle, tb->write | TB_FRESH,
+                                    __ATOMIC_ACQ_REL) & TB_INDEX;
+}
+
+/*
+ * Return the latest published state, setting *fresh to whether it has
+ * changed since the previous call.  The slot stays valid until the next
+ * call.
+ */
+static inline void *tb_read_slot(struct triple_buffer *tb, int *fresh)
+{
+    *fresh = (__atomic_load_n(&tb->middle, __ATOMIC_RELAXED) & TB_FRESH) != 0;
+    if (*fresh)
+        tb->read = __atomic_exchange_n(&tb->middle, tb->read,
+                                       __ATOMIC_ACQ_REL) & TB_INDEX;
+    return tb->slot[tb->read];
+}
+
+#endif
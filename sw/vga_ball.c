@@ -30,6 +30,7 @@
 #include <linux/of.h>
 #include <linux/of_address.h>
 #include <linux/fs.h>
+#include <linux/mm.h>
 #include <linux/uaccess.h>
 #include "vga_ball.h"
 
@@ -54,6 +55,7 @@ struct vga_ball_dev {
 	void __iomem *virtbase; /* Where registers can be accessed in memory */
         vga_ball_color_t background;
 		vga_ball_position_t position;
+	unsigned char radius;
 } dev;
 
 /*
@@ -76,6 +78,40 @@ static void write_position(vga_ball_position_t *position) {
 	dev.position = *position;
 }
 
+/*
+ * Write only the registers selected by the mask, one bus write each,
+ * and keep the cached copies the READ ioctls return in step
+ */
+static void write_regs(vga_ball_regs_t *r)
+{
+	int i;
+
+	for (i = 0; i < VGA_BALL_NREGS; i++)
+		if (r->mask & (1 << i))
+			iowrite8(r->regs[i], dev.virtbase + i);
+
+	if (r->mask & (1 << VGA_BALL_REG_RED))
+		dev.background.red = r->regs[VGA_BALL_REG_RED];
+	if (r->mask & (1 << VGA_BALL_REG_GREEN))
+		dev.background.green = r->regs[VGA_BALL_REG_GREEN];
+	if (r->mask & (1 << VGA_BALL_REG_BLUE))
+		dev.background.blue = r->regs[VGA_BALL_REG_BLUE];
+	if (r->mask & (1 << VGA_BALL_REG_RADIUS))
+		dev.radius = r->regs[VGA_BALL_REG_RADIUS];
+	if (r->mask & (1 << VGA_BALL_REG_X_LSB))
+		dev.position.x = (dev.position.x & 0xff00) |
+			r->regs[VGA_BALL_REG_X_LSB];
+	if (r->mask & (1 << VGA_BALL_REG_X_MSB))
+		dev.position.x = (dev.position.x & 0x00ff) |
+			r->regs[VGA_BALL_REG_X_MSB] << 8;
+	if (r->mask & (1 << VGA_BALL_REG_Y_LSB))
+		dev.position.y = (dev.position.y & 0xff00) |
+			r->regs[VGA_BALL_REG_Y_LSB];
+	if (r->mask & (1 << VGA_BALL_REG_Y_MSB))
+		dev.position.y = (dev.position.y & 0x00ff) |
+			r->regs[VGA_BALL_REG_Y_MSB] << 8;
+}
+
 /*
  * Handle ioctl() calls from userspace:
  * Read or write the segments on single digits.
@@ -84,6 +120,7 @@ static void write_position(vga_ball_position_t *position) {
 static long vga_ball_ioctl(struct file *f, unsigned int cmd, unsigned long arg)
 {
 	vga_ball_arg_t vla;
+	vga_ball_regs_t regs;
 
 	switch (cmd) {
 	case VGA_BALL_WRITE_BACKGROUND:
@@ -114,6 +151,13 @@ static long vga_ball_ioctl(struct file *f, unsigned int cmd, unsigned long arg)
 		write_position(&vla.position);
 		break;	
 
+	case VGA_BALL_WRITE_REGS:
+		if (copy_from_user(&regs, (vga_ball_regs_t *) arg,
+				   sizeof(vga_ball_regs_t)))
+			return -EACCES;
+		write_regs(&regs);
+		break;
+
 	default:
 		return -EINVAL;
 	}
@@ -121,10 +165,33 @@ static long vga_ball_ioctl(struct file *f, unsigned int cmd, unsigned long arg)
 	return 0;
 }
 
+/*
+ * Map the register page into userspace, uncached, so sprite and palette
+ * uploads are plain stores straight from the caller's buffer.  A
+ * peripheral whose span is too small for the sprite memory decodes only
+ * the low address bits, so stores there would land on the registers:
+ * refuse to map it.
+ */
+static int vga_ball_mmap(struct file *f, struct vm_area_struct *vma)
+{
+	unsigned long size = vma->vm_end - vma->vm_start;
+
+	if (resource_size(&dev.res) < VGA_BALL_MAP_SIZE)
+		return -ENODEV;
+	if (vma->vm_pgoff != 0 || size > VGA_BALL_MAP_SIZE)
+		return -EINVAL;
+
+	vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
+	return io_remap_pfn_range(vma, vma->vm_start,
+				  dev.res.start >> PAGE_SHIFT, size,
+				  vma->vm_page_prot);
+}
+
 /* The operations our device knows how to do */
 static const struct file_operations vga_ball_fops = {
 	.owner		= THIS_MODULE,
 	.unlocked_ioctl = vga_ball_ioctl,
+	.mmap		= vga_ball_mmap,
 };
 
 /* Information about our device for the "misc" framework -- like a char dev */
@@ -169,6 +236,7 @@ static int __init vga_ball_probe(struct platform_device *pdev)
         
 	/* Set an initial color */
         write_background(&beige);
+	dev.radius = 16;	/* Reset value in the peripheral */
 
 	return 0;
 
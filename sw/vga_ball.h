@@ -17,6 +17,44 @@ typedef struct {
   vga_ball_position_t position;
 } vga_ball_arg_t;
 
+/* Byte registers of the peripheral, as laid out in vga_ball.sv */
+#define VGA_BALL_REG_RED     0
+#define VGA_BALL_REG_GREEN   1
+#define VGA_BALL_REG_BLUE    2
+#define VGA_BALL_REG_RADIUS  3
+#define VGA_BALL_REG_X_LSB   4
+#define VGA_BALL_REG_X_MSB   5
+#define VGA_BALL_REG_Y_LSB   6
+#define VGA_BALL_REG_Y_MSB   7
+#define VGA_BALL_NREGS       8
+
+/* Raw register update: only registers whose mask bit is set are written */
+typedef struct {
+  unsigned char mask;                   /* Bit n selects regs[n] */
+  unsigned char regs[VGA_BALL_NREGS];
+} vga_ball_regs_t;
+
+/*
+ * Sprite control and memory, reached by mmap() of the device: map
+ * VGA_BALL_MAP_SIZE bytes at offset 0 and store to these byte offsets.
+ * Registers 0-7 share the page, but writes there bypass the driver's
+ * copies that the READ ioctls return.
+ *
+ * Only the software model (vga_model.h) has them so far: the peripheral
+ * in the shipped bitstream decodes 3 address bits, and mmap() fails with
+ * ENODEV while the device tree gives it less than VGA_BALL_MAP_SIZE.
+ */
+#define VGA_BALL_CTRL            0x008
+#define VGA_BALL_CTRL_SPRITE     0x01      /* Draw the sprite, not the ball */
+#define VGA_BALL_CTRL_FRAME(n)   ((n) << 1)
+#define VGA_BALL_PALETTE         0x040     /* 16 entries of r, g, b, unused */
+#define VGA_BALL_PALETTE_BYTES   64
+#define VGA_BALL_SPRITE_MEM      0x800
+#define VGA_BALL_SPRITE_SIZE     32        /* Pixels, square */
+#define VGA_BALL_SPRITE_BYTES    512       /* 4 bits a pixel, left one low */
+#define VGA_BALL_SPRITE_FRAMES   4
+#define VGA_BALL_MAP_SIZE        0x1000
+
 #define VGA_BALL_MAGIC 'q'
 
 /* ioctls and their arguments */
@@ -24,5 +62,6 @@ typedef struct {
 #define VGA_BALL_READ_BACKGROUND  _IOR(VGA_BALL_MAGIC, 2, vga_ball_arg_t)
 #define VGA_BALL_WRITE_POSITION   _IOW(VGA_BALL_MAGIC, 3, vga_ball_arg_t)
 #define VGA_BALL_READ_POSITION    _IOR(VGA_BALL_MAGIC, 4, vga_ball_arg_t)
+#define VGA_BALL_WRITE_REGS       _IOW(VGA_BALL_MAGIC, 5, vga_ball_regs_t)
 
 #endif
@@ -0,0 +1,280 @@
+/*
+ * Userspace stand-in for /dev/vga_ball, for hosts without the board
+ *
+ * Creates a character device through CUSE that accepts the vga_ball.h
+ * ioctls and applies them to the software model, so hello and the other
+ * clients run unmodified.  Once per 16.8 ms frame, like vga_counters,
+ * the model is rendered and published to a shared-memory frame buffer
+ * (struct vga_model_fb) and/or written out as a PPM image sequence.
+ *
+ * Usage: vga_ball_cuse [-f] [-d] [--name=vga_ball] [--shm=/vga_ball]
+ *                      [--frames=dir]
+ *   --frames writes dir/frameNNNNNN.ppm whenever the picture changes;
+ *   NNNNNN is the frame number, so gaps mean repeated frames
+ *
+ * Needs libfuse 2.9 and, unless run as root, permission on /dev/cuse.
+ */
+
+#define FUSE_USE_VERSION 29
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <cuse_lowlevel.h>
+#include <fuse_opt.h>
+#include "vga_model.h"
+#include "frame_sched.h"
+
+#define FB_PIXEL_BYTES (VGA_MODEL_WIDTH * VGA_MODEL_HEIGHT * 3)
+
+struct cuse_param {
+    char *name;
+    char *shm;
+    char *frames;
+    int help;
+};
+
+static struct cuse_param param = { "vga_ball", NULL, NULL, 0 };
+
+static struct vga_model model;
+static pthread_mutex_t model_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct vga_model_fb *fb;
+
+#define CUSE_OPT(t, p) { t, offsetof(struct cuse_param, p), 1 }
+
+static const struct fuse_opt cuse_opts[] = {
+    CUSE_OPT("--name=%s", name),
+    CUSE_OPT("--shm=%s", shm),
+    CUSE_OPT("--frames=%s", frames),
+    FUSE_OPT_KEY("-h", 0),
+    FUSE_OPT_KEY("--help", 0),
+    FUSE_OPT_END
+};
+
+static int process_arg(void *data, const char *arg, int key,
+                       struct fuse_args *outargs)
+{
+    struct cuse_param *p = data;
+
+    if (key == 0)
+    {
+        p->help = 1;
+        return fuse_opt_add_arg(outargs, "-ho");
+    }
+    return 1;
+}
+
+static void vga_cuse_open(fuse_req_t req, struct fuse_file_info *fi)
+{
+    fuse_reply_open(req, fi);
+}
+
+/*
+ * With CUSE_UNRESTRICTED_IOCTL the kernel sends no argument data at
+ * first; ask it to retry with the argument the caller passed, whose
+ * size the command encodes
+ */
+static void vga_cuse_ioctl(fuse_req_t req, int cmd, void *arg,
+                           struct fuse_file_info *fi, unsigned flags,
+                           const void *in_buf, size_t in_bufsz,
+                           size_t out_bufsz)
+{
+    union {
+        vga_ball_arg_t arg;
+        vga_ball_regs_t regs;
+    } u;
+    size_t size = _IOC_SIZE(cmd);
+    struct iovec iov = { arg, size };
+    int ret;
+
+    if (flags & FUSE_IOCTL_COMPAT)
+    {
+        fuse_reply_err(req, ENOSYS);
+        return;
+    }
+
+    memset(&u, 0, sizeof(u));
+    switch ((unsigned int)cmd)
+    {
+    case VGA_BALL_WRITE_BACKGROUND:
+    case VGA_BALL_WRITE_POSITION:
+    case VGA_BALL_WRITE_REGS:
+        if (in_bufsz < size)
+        {
+            fuse_reply_ioctl_retry(req, &iov, 1, NULL, 0);
+            return;
+        }
+        memcpy(&u, in_buf, size);
+        break;
+
+    case VGA_BALL_READ_BACKGROUND:
+    case VGA_BALL_READ_POSITION:
+        if (out_bufsz < size)
+        {
+            fuse_reply_ioctl_retry(req, NULL, 0, &iov, 1);
+            return;
+        }
+        break;
+    }
+
+    pthread_mutex_lock(&model_lock);
+    ret = vga_model_ioctl(&model, cmd, &u);
+    pthread_mutex_unlock(&model_lock);
+
+    if (ret)
+        fuse_reply_err(req, -ret);
+    else if (_IOC_DIR(cmd) & _IOC_READ)
+        fuse_reply_ioctl(req, 0, &u, size);
+    else
+        fuse_reply_ioctl(req, 0, NULL, 0);
+}
+
+static void write_ppm(unsigned long long frame, const unsigned char *rgb)
+{
+    char path[4096];
+    FILE *f;
+
+    snprintf(path, sizeof(path), "%s/frame%06llu.ppm", param.frames, frame);
+    if ((f = fopen(path, "wb")) == NULL)
+    {
+        perror(path);
+        return;
+    }
+    fprintf(f, "P6\n%d %d\n255\n", VGA_MODEL_WIDTH, VGA_MODEL_HEIGHT);
+    fwrite(rgb, FB_PIXEL_BYTES, 1, f);
+    fclose(f);
+}
+
+/* Whether two models would scan out the same picture */
+static int same_picture(const struct vga_model *a, const struct vga_model *b)
+{
+    return memcmp(a->regs, b->regs, sizeof(a->regs)) == 0 &&
+        a->ctrl == b->ctrl &&
+        memcmp(a->palette, b->palette, sizeof(a->palette)) == 0 &&
+        memcmp(a->sprite, b->sprite, sizeof(a->sprite)) == 0;
+}
+
+/*
+ * Display thread: sample the registers and sprite memory at the start of
+ * every frame, as the peripheral's scanout would, and publish the picture
+ */
+static void *scanout(void *unused)
+{
+    unsigned char *rgb = fb ? fb->rgb : malloc(FB_PIXEL_BYTES);
+    struct vga_model snapshot, last;
+    struct frame_sched fs;
+    unsigned long long frame;
+    int changed;
+
+    if (rgb == NULL)
+        return NULL;
+    memset(&snapshot, 0, sizeof(snapshot));
+    memset(&last, 0, sizeof(last));
+    frame_sched_init(&fs, VGA_FRAME_NS);
+
+    for (frame = 0;; frame++)
+    {
+        frame_sched_wait(&fs);
+
+        pthread_mutex_lock(&model_lock);
+        snapshot = model;
+        pthread_mutex_unlock(&model_lock);
+        changed = frame == 0 || !same_picture(&snapshot, &last);
+        last = snapshot;
+
+        if (fb)
+        {
+            __atomic_add_fetch(&fb->seq, 1, __ATOMIC_RELEASE);
+            if (changed)
+                vga_model_render(&snapshot, rgb);
+            fb->frame = frame;
+            fb->time_ns = fs.woke.tv_sec * 1000000000ULL + fs.woke.tv_nsec;
+            __atomic_add_fetch(&fb->seq, 1, __ATOMIC_RELEASE);
+        }
+        else if (changed)
+            vga_model_render(&snapshot, rgb);
+
+        if (param.frames && changed)
+            write_ppm(frame, rgb);
+    }
+    return NULL;
+}
+
+/* Start scanout only now: cuse_lowlevel_main() may have daemonized */
+static void vga_cuse_init_done(void *userdata)
+{
+    pthread_t thread;
+
+    if (pthread_create(&thread, NULL, scanout, NULL))
+        fprintf(stderr, "could not start scanout thread\n");
+}
+
+static struct vga_model_fb *map_fb(const char *name)
+{
+    size_t size = sizeof(struct vga_model_fb) + FB_PIXEL_BYTES;
+    struct vga_model_fb *p;
+    int fd;
+
+    if ((fd = shm_open(name, O_RDWR | O_CREAT, 0644)) == -1)
+        return NULL;
+    if (ftruncate(fd, size) == -1)
+    {
+        close(fd);
+        return NULL;
+    }
+    p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return NULL;
+
+    p->magic = VGA_MODEL_FB_MAGIC;
+    p->width = VGA_MODEL_WIDTH;
+    p->height = VGA_MODEL_HEIGHT;
+    p->seq = 0;
+    return p;
+}
+
+static const struct cuse_lowlevel_ops vga_cuse_ops = {
+    .init_done = vga_cuse_init_done,
+    .open = vga_cuse_open,
+    .ioctl = vga_cuse_ioctl,
+};
+
+int main(int argc, char *argv[])
+{
+    struct fuse_args args = FUSE_ARGS_INIT(argc, argv);
+    struct cuse_info ci;
+    char dev_name[128];
+    const char *dev_info_argv[] = { dev_name };
+
+    if (fuse_opt_parse(&args, &param, cuse_opts, process_arg))
+        return 1;
+    if (param.help)
+        fprintf(stderr, "vga_ball_cuse options:\n"
+                "    --name=NAME     device name (default: vga_ball)\n"
+                "    --shm=NAME      publish frames in POSIX shared memory\n"
+                "    --frames=DIR    write changed frames as PPM files\n\n");
+
+    snprintf(dev_name, sizeof(dev_name), "DEVNAME=%s", param.name);
+
+    vga_model_init(&model);
+    if (param.shm && (fb = map_fb(param.shm)) == NULL)
+    {
+        perror(param.shm);
+        return 1;
+    }
+
+    memset(&ci, 0, sizeof(ci));
+    ci.dev_info_argc = 1;
+    ci.dev_info_argv = dev_info_argv;
+    ci.flags = CUSE_UNRESTRICTED_IOCTL;
+
+    return cuse_lowlevel_main(args.argc, args.argv, &ci, &vga_cuse_ops, NULL);
+}
@@ -0,0 +1,280 @@
+/*
+ * End-to-end benchmark for the vga_ball software stack
+ *
+ * Measures
+ *   - round-trip latency of each ioctl
+ *   - sustained update rate (background + position pairs, back to back)
+ *   - wakeup latency of the frame scheduler at the VGA refresh period
+ *   - frame-to-frame interval jitter
+ * and prints summary statistics and log2 histograms, either as a table
+ * or as CSV (-c) for scripts to collect.  CSV rows are
+ *   stat,<name>,n,min,avg,p50,p99,max      times in ns
+ *   hist,<name>,<bucket upper bound in us, -1 for overflow>,count
+ *   rate,<name>,value
+ *   count,<name>,value
+ *
+ * There is no vsync interrupt in the peripheral or driver, so "vsync
+ * wait" is the frame_sched deadline wait that display clients use.
+ *
+ * Usage: vga_bench [-m] [-c] [-d device] [-n iterations] [-t seconds]
+ *                  [-f frames]
+ *   -m  run against the software model instead of a device
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include "vga_trace.h"
+#include "vga_model.h"
+#include "frame_sched.h"
+
+#define HIST_BUCKETS 16  /* <1 us, then powers of two up to 16 ms and over */
+
+struct samples {
+    const char *name;
+    long long *v;        /* Nanoseconds */
+    long n;
+};
+
+static int use_model, csv;
+static int vga_ball_fd = -1;
+static struct vga_model model;
+
+static int dev_ioctl(unsigned int cmd, vga_ball_arg_t *arg)
+{
+    if (use_model)
+        return vga_model_ioctl(&model, cmd, arg);
+    return vga_trace_ioctl(vga_ball_fd, cmd, arg);
+}
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static long long ts_ns(const struct timespec *ts)
+{
+    return ts->tv_sec * 1000000000LL + ts->tv_nsec;
+}
+
+static void samples_init(struct samples *s, const char *name, long n)
+{
+    s->name = name;
+    s->n = 0;
+    if ((s->v = malloc(n * sizeof(*s->v))) == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+}
+
+static int cmp_ll(const void *a, const void *b)
+{
+    long long x = *(const long long *)a, y = *(const long long *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+/* Print min/avg/percentiles in ns and a histogram of magnitudes in us */
+static void report(struct samples *s)
+{
+    unsigned long hist[HIST_BUCKETS] = { 0 };
+    long long sum = 0, us;
+    long i;
+    int b;
+
+    if (s->n == 0)
+        return;
+    qsort(s->v, s->n, sizeof(*s->v), cmp_ll);
+    for (i = 0; i < s->n; i++)
+    {
+        sum += s->v[i];
+        us = (s->v[i] < 0 ? -s->v[i] : s->v[i]) / 1000;
+        for (b = 0; b < HIST_BUCKETS - 1 && us >= (1LL << b); b++)
+            ;
+        hist[b]++;
+    }
+
+    if (csv)
+        printf("stat,%s,%ld,%lld,%lld,%lld,%lld,%lld\n", s->name, s->n,
+               s->v[0], sum / s->n, s->v[s->n / 2], s->v[s->n * 99 / 100],
+               s->v[s->n - 1]);
+    else
+        printf("%-24s %8ld %10lld %10lld %10lld %10lld %10lld\n", s->name,
+               s->n, s->v[0], sum / s->n, s->v[s->n / 2],
+               s->v[s->n * 99 / 100], s->v[s->n - 1]);
+
+    for (b = 0; b < HIST_BUCKETS; b++)
+    {
+        if (!hist[b])
+            continue;
+        if (csv)
+            printf("hist,%s,%lld,%lu\n", s->name,
+                   b == HIST_BUCKETS - 1 ? -1 : 1LL << b, hist[b]);
+        else if (b == HIST_BUCKETS - 1)
+            printf("    >= %6lld us %10lu\n", 1LL << (b - 1), hist[b]);
+        else
+            printf("    <  %6lld us %10lu\n", 1LL << b, hist[b]);
+    }
+    free(s->v);
+}
+
+static void header(const char *title)
+{
+    if (!csv)
+        printf("\n%-24s %8s %10s %10s %10s %10s %10s\n", title,
+               "n", "min", "avg", "p50", "p99", "max");
+}
+
+/* Time each command individually */
+static void bench_ioctls(long iterations)
+{
+    static const struct {
+        unsigned int cmd;
+        const char *name;
+    } cmds[] = {
+        { VGA_BALL_WRITE_BACKGROUND, "write_background" },
+        { VGA_BALL_READ_BACKGROUND, "read_background" },
+        { VGA_BALL_WRITE_POSITION, "write_position" },
+        { VGA_BALL_READ_POSITION, "read_position" },
+    };
+    struct samples s;
+    vga_ball_arg_t arg = { { 0, 0, 0 }, { 0, 0 } };
+    long long t0;
+    long i;
+    int c;
+
+    header("ioctl latency (ns)");
+    for (c = 0; c < 4; c++)
+    {
+        samples_init(&s, cmds[c].name, iterations);
+        for (i = 0; i < iterations; i++)
+        {
+            arg.background.red = i;
+            arg.position.x = (i % 640) << 6;
+            t0 = now_ns();
+            if (dev_ioctl(cmds[c].cmd, &arg))
+            {
+                perror(cmds[c].name);
+                exit(1);
+            }
+            s.v[s.n++] = now_ns() - t0;
+        }
+        report(&s);
+    }
+}
+
+/* Whole-frame updates (background then position) as fast as they go */
+static void bench_sustained(double seconds)
+{
+    vga_ball_arg_t arg = { { 0, 0, 0 }, { 0, 0 } };
+    long long start = now_ns(), end = start + seconds * 1e9, t;
+    unsigned long updates = 0;
+
+    do
+    {
+        arg.background.green = updates;
+        arg.position.y = (updates % 480) << 6;
+        dev_ioctl(VGA_BALL_WRITE_BACKGROUND, &arg);
+        dev_ioctl(VGA_BALL_WRITE_POSITION, &arg);
+        updates++;
+    } while ((t = now_ns()) < end);
+
+    if (csv)
+        printf("rate,sustained_updates_per_s,%.0f\n", updates / ((t - start) / 1e9));
+    else
+        printf("\nsustained updates: %.0f /s (%lu in %.2f s)\n",
+               updates / ((t - start) / 1e9), updates, (t - start) / 1e9);
+}
+
+/* Wait for frames the way display clients do and watch the timing */
+static void bench_frames(long frames)
+{
+    struct frame_sched fs;
+    struct samples wake, jitter;
+    long long deadline, prev = 0, woke;
+    long i;
+
+    samples_init(&wake, "frame_wakeup", frames);
+    samples_init(&jitter, "frame_interval_error", frames);
+    frame_sched_init(&fs, VGA_FRAME_NS);
+    for (i = 0; i < frames; i++)
+    {
+        deadline = ts_ns(&fs.next);
+        frame_sched_wait(&fs);
+        woke = ts_ns(&fs.woke);
+        wake.v[wake.n++] = woke - deadline;
+        if (prev)
+            jitter.v[jitter.n++] = woke - prev - VGA_FRAME_NS;
+        prev = woke;
+    }
+
+    header("frame timing (ns)");
+    report(&wake);
+    report(&jitter);
+    if (csv)
+        printf("count,frames_missed,%lu\n", fs.missed);
+    else
+        printf("missed frames: %lu of %lu\n", fs.missed, fs.frames);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *device = "/dev/vga_ball";
+    long iterations = 10000, frames = 600;
+    double seconds = 2;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "mcd:n:t:f:")) != -1)
+        switch (opt)
+        {
+        case 'm':
+            use_model = 1;
+            break;
+        case 'c':
+            csv = 1;
+            break;
+        case 'd':
+            device = optarg;
+            break;
+        case 'n':
+            iterations = atol(optarg);
+            break;
+        case 't':
+            seconds = atof(optarg);
+            break;
+        case 'f':
+            frames = atol(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-m] [-c] [-d device] [-n iterations] "
+                    "[-t seconds] [-f frames]\n", argv[0]);
+            return 1;
+        }
+
+    if (use_model)
+        vga_model_init(&model);
+    else if ((vga_ball_fd = open(device, O_RDWR)) == -1)
+    {
+        fprintf(stderr, "could not open %s\n", device);
+        return 1;
+    }
+
+    if (csv)
+        printf("target,%s\n", use_model ? "model" : device);
+    else
+        printf("vga_bench on %s\n", use_model ? "software model" : device);
+
+    bench_ioctls(iterations);
+    bench_sustained(seconds);
+    bench_frames(frames);
+
+    if (vga_ball_fd != -1)
+        close(vga_ball_fd);
+    return 0;
+}
@@ -0,0 +1,168 @@
+/*
+ * Client library for the vga_comp compositor; see vga_client.h
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "vga_client.h"
+
+struct vga_client {
+    int sock;
+    struct vga_comp_ring *ring;
+    size_t ring_bytes;
+    unsigned int head;        /* Private copy: only this side writes it */
+};
+
+/* Receive a reply and, if one came with it, a file descriptor */
+static int recv_reply(int sock, struct vga_comp_reply *reply, int *fd)
+{
+    char control[CMSG_SPACE(sizeof(int))];
+    struct iovec iov = { reply, sizeof(*reply) };
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (recvmsg(sock, &msg, 0) != sizeof(*reply))
+        return -1;
+
+    if (fd)
+    {
+        *fd = -1;
+        cmsg = CMSG_FIRSTHDR(&msg);
+        if (cmsg && cmsg->cmsg_level == SOL_SOCKET &&
+            cmsg->cmsg_type == SCM_RIGHTS)
+            memcpy(fd, CMSG_DATA(cmsg), sizeof(int));
+    }
+    return 0;
+}
+
+/* Connect and join at the given layer; NULL socket_path for the default */
+struct vga_client *vga_client_open(const char *socket_path, int layer,
+                                   const char *name)
+{
+    struct sockaddr_un addr;
+    struct vga_comp_msg msg;
+    struct vga_comp_reply reply;
+    struct vga_client *c;
+    int fd;
+
+    if ((c = calloc(1, sizeof(*c))) == NULL)
+        return NULL;
+    if ((c->sock = socket(AF_UNIX, SOCK_STREAM, 0)) == -1)
+        goto fail;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_path ? socket_path : VGA_COMP_SOCKET,
+            sizeof(addr.sun_path) - 1);
+    if (connect(c->sock, (struct sockaddr *)&addr, sizeof(addr)) == -1)
+        goto fail_sock;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.type = VGA_COMP_HELLO;
+    msg.layer = layer;
+    strncpy(msg.name, name ? name : "", sizeof(msg.name) - 1);
+    if (send(c->sock, &msg, sizeof(msg), MSG_NOSIGNAL) != sizeof(msg) ||
+        recv_reply(c->sock, &reply, &fd))
+        goto fail_sock;
+    if (reply.status || fd == -1)
+    {
+        errno = reply.status ? -reply.status : EPROTO;
+        goto fail_sock;
+    }
+
+    c->ring_bytes = sizeof(struct vga_comp_ring) +
+        reply.slots * sizeof(vga_ball_regs_t);
+    c->ring = mmap(NULL, c->ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+                   fd, 0);
+    close(fd);
+    if (c->ring == MAP_FAILED)
+        goto fail_sock;
+    if (c->ring->magic != VGA_COMP_MAGIC || c->ring->slots != reply.slots)
+    {
+        munmap(c->ring, c->ring_bytes);
+        errno = EPROTO;
+        goto fail_sock;
+    }
+    c->head = c->ring->head;
+    return c;
+
+fail_sock:
+    close(c->sock);
+fail:
+    free(c);
+    return NULL;
+}
+
+/* Queue a masked register update for the next frame */
+int vga_client_write(struct vga_client *c, const vga_ball_regs_t *r)
+{
+    struct vga_comp_ring *ring = c->ring;
+    unsigned int tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+    if (c->head - tail == ring->slots)
+    {
+        errno = EAGAIN;
+        return -1;
+    }
+    ring->slot[c->head & (ring->slots - 1)] = *r;
+    __atomic_store_n(&ring->head, ++c->head, __ATOMIC_RELEASE);
+    return 0;
+}
+
+int vga_client_set_background(struct vga_client *c,
+                              const vga_ball_color_t *background)
+{
+    vga_ball_regs_t r;
+
+    r.mask = 1 << VGA_BALL_REG_RED | 1 << VGA_BALL_REG_GREEN |
+        1 << VGA_BALL_REG_BLUE;
+    r.regs[VGA_BALL_REG_RED] = background->red;
+    r.regs[VGA_BALL_REG_GREEN] = background->green;
+    r.regs[VGA_BALL_REG_BLUE] = background->blue;
+    return vga_client_write(c, &r);
+}
+
+int vga_client_set_position(struct vga_client *c,
+                            const vga_ball_position_t *position)
+{
+    vga_ball_regs_t r;
+
+    r.mask = 1 << VGA_BALL_REG_X_LSB | 1 << VGA_BALL_REG_X_MSB |
+        1 << VGA_BALL_REG_Y_LSB | 1 << VGA_BALL_REG_Y_MSB;
+    r.regs[VGA_BALL_REG_X_LSB] = position->x;
+    r.regs[VGA_BALL_REG_X_MSB] = position->x >> 8;
+    r.regs[VGA_BALL_REG_Y_LSB] = position->y;
+    r.regs[VGA_BALL_REG_Y_MSB] = position->y >> 8;
+    return vga_client_write(c, &r);
+}
+
+/* Ask the compositor for its counters over the control channel */
+int vga_client_stats(struct vga_client *c, struct vga_comp_reply *stats)
+{
+    struct vga_comp_msg msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.type = VGA_COMP_STATS;
+    if (send(c->sock, &msg, sizeof(msg), MSG_NOSIGNAL) != sizeof(msg) ||
+        recv_reply(c->sock, stats, NULL))
+        return -1;
+    return stats->status;
+}
+
+/* Updates still in the ring may or may not be applied */
+void vga_client_close(struct vga_client *c)
+{
+    munmap(c->ring, c->ring_bytes);
+    close(c->sock);
+    free(c);
+}
@@ -0,0 +1,27 @@
+#ifndef _VGA_CLIENT_H
+#define _VGA_CLIENT_H
+
+#include "vga_comp.h"
+
+/*
+ * Client side of the vga_comp compositor
+ *
+ * Writes only append to a shared-memory ring; no system call happens
+ * until the compositor applies them at the next frame.  A write fails
+ * with EAGAIN when the ring is full, i.e. when the client has queued
+ * VGA_COMP_SLOTS updates the compositor has not reached yet.
+ */
+
+struct vga_client;
+
+struct vga_client *vga_client_open(const char *socket_path, int layer,
+                                   const char *name);
+int vga_client_write(struct vga_client *c, const vga_ball_regs_t *r);
+int vga_client_set_background(struct vga_client *c,
+                              const vga_ball_color_t *background);
+int vga_client_set_position(struct vga_client *c,
+                            const vga_ball_position_t *position);
+int vga_client_stats(struct vga_client *c, struct vga_comp_reply *stats);
+void vga_client_close(struct vga_client *c);
+
+#endif
@@ -0,0 +1,444 @@
+/*
+ * Display compositor: one owner for /dev/vga_ball, many clients
+ *
+ * The driver has no arbitration, so two processes writing the device
+ * interleave their bus writes arbitrarily.  vga_comp opens the device
+ * once and serves any number of local clients (see vga_comp.h and
+ * vga_client.h).  A control thread accepts clients on a Unix socket and
+ * hands each a shared-memory ring; the frame thread wakes at every VGA
+ * frame, drains all rings, merges their updates by layer and issues at
+ * most one VGA_BALL_WRITE_REGS, holding only registers that changed.
+ *
+ * Usage: vga_comp [-m] [-r] [-d device] [-s socket]
+ *   -m  drive the software model instead of a device
+ *   -r  run the frame thread real-time (see rt_runtime.h)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "vga_comp.h"
+#include "vga_trace.h"
+#include "vga_model.h"
+#include "frame_sched.h"
+#include "rt_runtime.h"
+
+#define RING_BYTES (sizeof(struct vga_comp_ring) + \
+                    VGA_COMP_SLOTS * sizeof(vga_ball_regs_t))
+
+struct client {
+    int sock;
+    int layer;
+    char name[16];
+    struct vga_comp_ring *ring;      /* NULL until the client says HELLO */
+    unsigned int tail;               /* Private copy: only this side writes it */
+    int overrun;                     /* Its head ran more than a ring ahead */
+    unsigned long long updates;
+    struct vga_comp_msg msg;         /* The message coming in, got bytes */
+    size_t got;                      /* of it so far */
+};
+
+/* Clients with rings, sorted by layer; the frame thread reads it locked */
+static struct client *clients[VGA_COMP_CLIENTS];
+static int nclients;
+static pthread_mutex_t clients_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int use_model, vga_ball_fd = -1;
+static struct vga_model model;
+static struct vga_comp_reply stats;
+static volatile sig_atomic_t done;
+
+static void handle_sigint(int sig)
+{
+    done = 1;
+}
+
+/* The frame thread counts, the control thread reads: whole 64-bit values
+   need atomics on a 32-bit CPU */
+static void count(unsigned long long *counter, unsigned long long n)
+{
+    __atomic_fetch_add(counter, n, __ATOMIC_RELAXED);
+}
+
+static unsigned long long counted(unsigned long long *counter)
+{
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+static int dev_write_regs(vga_ball_regs_t *r)
+{
+    if (use_model)
+        return vga_model_ioctl(&model, VGA_BALL_WRITE_REGS, r);
+    return vga_trace_ioctl(vga_ball_fd, VGA_BALL_WRITE_REGS, r);
+}
+
+/*
+ * Fold every queued update into one register set, lowest layer first,
+ * and write whatever differs from the registers as last written.  The
+ * ring is the client's to write, so only head is read from it: a head
+ * more than a ring ahead of our tail marks the client for the control
+ * thread to drop.
+ */
+static void compose_frame(unsigned char *shadow, unsigned char *known)
+{
+    vga_ball_regs_t out, *r;
+    struct client *cl;
+    unsigned int head;
+    unsigned long long updates = 0, bus_writes = 0;
+    int c, i;
+
+    out.mask = 0;
+    pthread_mutex_lock(&clients_lock);
+    for (c = 0; c < nclients; c++)
+    {
+        cl = clients[c];
+        head = __atomic_load_n(&cl->ring->head, __ATOMIC_ACQUIRE);
+        if (cl->overrun || head - cl->tail > VGA_COMP_SLOTS)
+        {
+            __atomic_store_n(&cl->overrun, 1, __ATOMIC_RELAXED);
+            continue;
+        }
+        for (; cl->tail != head; cl->tail++)
+        {
+            r = &cl->ring->slot[cl->tail & (VGA_COMP_SLOTS - 1)];
+            for (i = 0; i < VGA_BALL_NREGS; i++)
+                if (r->mask & (1 << i))
+                    out.regs[i] = r->regs[i];
+            out.mask |= r->mask;
+            cl->updates++;
+            updates++;
+        }
+        __atomic_store_n(&cl->ring->tail, cl->tail, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&clients_lock);
+    count(&stats.updates, updates);
+
+    for (i = 0; i < VGA_BALL_NREGS; i++)
+        if ((out.mask & (1 << i)) && (*known & (1 << i)) &&
+            out.regs[i] == shadow[i])
+            out.mask &= ~(1 << i);
+    if (out.mask == 0)
+        return;
+
+    if (dev_write_regs(&out))
+        perror("ioctl(VGA_BALL_WRITE_REGS) failed");
+    for (i = 0; i < VGA_BALL_NREGS; i++)
+        if (out.mask & (1 << i))
+        {
+            shadow[i] = out.regs[i];
+            bus_writes++;
+        }
+    *known |= out.mask;
+    count(&stats.bus_writes, bus_writes);
+    count(&stats.ioctls, 1);
+}
+
+static void *frame_thread(void *arg)
+{
+    const struct rt_config *rt = arg;
+    unsigned char shadow[VGA_BALL_NREGS], known = 0;
+    struct frame_sched fs;
+
+    if (rt_apply(rt))
+        fprintf(stderr, "real-time setup incomplete, continuing\n");
+    frame_sched_init(&fs, VGA_FRAME_NS);
+    while (!done)
+    {
+        frame_sched_wait(&fs);
+        compose_frame(shadow, &known);
+        count(&stats.frames, 1);
+    }
+
+    printf("Frames:\n");
+    frame_sched_report(&fs, stdout);
+    return NULL;
+}
+
+static int send_reply(int sock, struct vga_comp_reply *reply, int fd)
+{
+    char control[CMSG_SPACE(sizeof(int))];
+    struct iovec iov = { reply, sizeof(*reply) };
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (fd != -1)
+    {
+        memset(control, 0, sizeof(control));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+    return sendmsg(sock, &msg, MSG_NOSIGNAL) == sizeof(*reply) ? 0 : -1;
+}
+
+/* Anonymous shared ring: the name is gone before the client sees the fd */
+static int create_ring(struct vga_comp_ring **ring)
+{
+    static unsigned int serial;
+    char name[64];
+    int fd;
+
+    snprintf(name, sizeof(name), "/vga_comp.%d.%u", (int)getpid(), serial++);
+    if ((fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600)) == -1)
+        return -1;
+    shm_unlink(name);
+    if (ftruncate(fd, RING_BYTES) == -1 ||
+        (*ring = mmap(NULL, RING_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED,
+                      fd, 0)) == MAP_FAILED)
+    {
+        close(fd);
+        return -1;
+    }
+    (*ring)->magic = VGA_COMP_MAGIC;
+    (*ring)->slots = VGA_COMP_SLOTS;
+    return fd;
+}
+
+static void handle_hello(struct client *cl, const struct vga_comp_msg *msg)
+{
+    struct vga_comp_reply reply;
+    int fd = -1, i;
+
+    memset(&reply, 0, sizeof(reply));
+    if (cl->ring)
+        reply.status = -EALREADY;
+    else if ((fd = create_ring(&cl->ring)) == -1)
+        reply.status = -errno;
+    else
+    {
+        cl->layer = msg->layer;
+        memcpy(cl->name, msg->name, sizeof(cl->name));
+        cl->name[sizeof(cl->name) - 1] = '\0';
+        reply.slots = VGA_COMP_SLOTS;
+
+        /* Insert after every client at the same or a lower layer */
+        pthread_mutex_lock(&clients_lock);
+        for (i = nclients; i > 0 && clients[i - 1]->layer > cl->layer; i--)
+            clients[i] = clients[i - 1];
+        clients[i] = cl;
+        nclients++;
+        pthread_mutex_unlock(&clients_lock);
+        printf("client %s joined at layer %d\n", cl->name, cl->layer);
+    }
+    send_reply(cl->sock, &reply, fd);
+    if (fd != -1)
+        close(fd);
+}
+
+static void drop_client(struct client *cl)
+{
+    int i;
+
+    if (cl->ring)
+    {
+        pthread_mutex_lock(&clients_lock);
+        for (i = 0; i < nclients && clients[i] != cl; i++)
+            ;
+        for (; i < nclients - 1; i++)
+            clients[i] = clients[i + 1];
+        nclients--;
+        pthread_mutex_unlock(&clients_lock);
+        printf("client %s left after %llu updates\n", cl->name, cl->updates);
+        munmap(cl->ring, RING_BYTES);
+    }
+    close(cl->sock);
+    free(cl);
+}
+
+/*
+ * Take in what the client has sent of its next message: 1 once all of it
+ * is in cl->msg, 0 while some is still to come, -1 if the client hung up
+ */
+static int recv_msg(struct client *cl)
+{
+    ssize_t n;
+
+    while (cl->got < sizeof(cl->msg))
+    {
+        n = recv(cl->sock, (char *)&cl->msg + cl->got,
+                 sizeof(cl->msg) - cl->got, MSG_DONTWAIT);
+        if (n > 0)
+            cl->got += n;
+        else if (n == -1 && errno == EINTR)
+            continue;
+        else if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return 0;
+        else
+            return -1;
+    }
+    cl->got = 0;
+    return 1;
+}
+
+static int listen_on(const char *path)
+{
+    struct sockaddr_un addr;
+    int sock;
+
+    if ((sock = socket(AF_UNIX, SOCK_STREAM, 0)) == -1)
+        return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    unlink(path);
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) == -1 ||
+        listen(sock, VGA_COMP_CLIENTS) == -1)
+    {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+/* Control channel: accept clients and answer their messages */
+static void serve(int listener)
+{
+    struct pollfd pfd[VGA_COMP_CLIENTS + 1];
+    struct client *conn[VGA_COMP_CLIENTS];
+    struct vga_comp_reply reply;
+    int nconn = 0, i, n, overrun, sock;
+
+    while (!done)
+    {
+        pfd[0].fd = listener;
+        pfd[0].events = POLLIN;
+        for (i = 0; i < nconn; i++)
+        {
+            pfd[i + 1].fd = conn[i]->sock;
+            pfd[i + 1].events = POLLIN;
+        }
+        if (poll(pfd, nconn + 1, 200) <= 0)
+            continue;
+
+        for (i = nconn - 1; i >= 0; i--)
+        {
+            overrun = __atomic_load_n(&conn[i]->overrun, __ATOMIC_RELAXED);
+            if (overrun)
+                printf("client %s overran its ring\n", conn[i]->name);
+            else if (!pfd[i + 1].revents)
+                continue;
+            if (overrun || (n = recv_msg(conn[i])) == -1)
+            {
+                drop_client(conn[i]);
+                conn[i] = conn[--nconn];
+                continue;
+            }
+            if (n == 0)
+                continue;
+            switch (conn[i]->msg.type)
+            {
+            case VGA_COMP_HELLO:
+                handle_hello(conn[i], &conn[i]->msg);
+                break;
+            case VGA_COMP_STATS:
+                memset(&reply, 0, sizeof(reply));
+                reply.frames = counted(&stats.frames);
+                reply.updates = counted(&stats.updates);
+                reply.ioctls = counted(&stats.ioctls);
+                reply.bus_writes = counted(&stats.bus_writes);
+                send_reply(conn[i]->sock, &reply, -1);
+                break;
+            default:
+                memset(&reply, 0, sizeof(reply));
+                reply.status = -EINVAL;
+                send_reply(conn[i]->sock, &reply, -1);
+            }
+        }
+
+        if ((pfd[0].revents & POLLIN) &&
+            (sock = accept(listener, NULL, NULL)) != -1)
+        {
+            if (nconn == VGA_COMP_CLIENTS ||
+                (conn[nconn] = calloc(1, sizeof(struct client))) == NULL)
+                close(sock);
+            else
+                conn[nconn++]->sock = sock;
+        }
+    }
+
+    while (nconn > 0)
+        drop_client(conn[--nconn]);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *device = "/dev/vga_ball", *path = VGA_COMP_SOCKET;
+    struct rt_config rt;
+    pthread_t frames;
+    int listener, opt;
+
+    rt_config_init(&rt);
+    while ((opt = getopt(argc, argv, "mrd:s:")) != -1)
+        switch (opt)
+        {
+        case 'm':
+            use_model = 1;
+            break;
+        case 'r':
+            rt_config_default(&rt);
+            break;
+        case 'd':
+            device = optarg;
+            break;
+        case 's':
+            path = optarg;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-m] [-r] [-d device] [-s socket]\n",
+                    argv[0]);
+            return 1;
+        }
+
+    if (use_model)
+        vga_model_init(&model);
+    else if ((vga_ball_fd = open(device, O_RDWR)) == -1)
+    {
+        fprintf(stderr, "could not open %s\n", device);
+        return 1;
+    }
+    if ((listener = listen_on(path)) == -1)
+    {
+        perror(path);
+        return 1;
+    }
+
+    signal(SIGINT, handle_sigint);
+    signal(SIGTERM, handle_sigint);
+    if (rt_apply_memory(&rt))
+        fprintf(stderr, "real-time memory setup incomplete, continuing\n");
+    if (pthread_create(&frames, NULL, frame_thread, &rt))
+    {
+        fprintf(stderr, "could not start frame thread\n");
+        return 1;
+    }
+    printf("vga_comp on %s, clients at %s\n",
+           use_model ? "software model" : device, path);
+
+    serve(listener);
+
+    pthread_join(frames, NULL);
+    close(listener);
+    unlink(path);
+    printf("%llu frames, %llu updates merged into %llu ioctls, "
+           "%llu bus writes\n", stats.frames, stats.updates, stats.ioctls,
+           stats.bus_writes);
+    if (vga_ball_fd != -1)
+        close(vga_ball_fd);
+    return 0;
+}
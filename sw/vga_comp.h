@@ -0,0 +1,55 @@
+#ifndef _VGA_COMP_H
+#define _VGA_COMP_H
+
+#include "vga_ball.h"
+
+/*
+ * Protocol between the vga_comp compositor and its clients
+ *
+ * The compositor owns /dev/vga_ball.  A client connects to its Unix
+ * socket and sends a HELLO; the reply carries, as SCM_RIGHTS, a shared
+ * memory ring of register updates (vga_ball_regs_t) that the client
+ * fills and the compositor drains.  Once per frame the compositor merges
+ * every client's pending updates -- lower layers first, so higher layers
+ * win registers both wrote -- and writes only the registers that differ
+ * from what the hardware already shows, in a single VGA_BALL_WRITE_REGS.
+ *
+ * Each ring has one producer and one consumer: head belongs to the
+ * client, tail to the compositor, and each is published with release
+ * ordering after the slots it covers.  Each side keeps its own index and
+ * only reads the other's.  Indices run freely and wrap at slots, a power
+ * of two; a client whose head runs more than slots ahead of the tail is
+ * disconnected, as is one that closes the socket.
+ */
+
+#define VGA_COMP_SOCKET  "/tmp/vga_comp.sock"
+#define VGA_COMP_MAGIC   0x56474331   /* "VGC1" */
+#define VGA_COMP_SLOTS   256
+#define VGA_COMP_CLIENTS 16
+
+struct vga_comp_ring {
+    unsigned int magic;
+    unsigned int slots;
+    unsigned int head __attribute__((aligned(64)));  /* Next slot to fill */
+    unsigned int tail __attribute__((aligned(64)));  /* Next slot to drain */
+    vga_ball_regs_t slot[] __attribute__((aligned(64)));
+};
+
+enum vga_comp_type {
+    VGA_COMP_HELLO = 1,    /* Join; the reply brings the ring */
+    VGA_COMP_STATS,        /* Ask for the compositor's counters */
+};
+
+struct vga_comp_msg {
+    unsigned int type;
+    int layer;             /* HELLO: higher layers win shared registers */
+    char name[16];         /* HELLO: for the compositor's log */
+};
+
+struct vga_comp_reply {
+    int status;            /* 0 or a negative errno */
+    unsigned int slots;    /* HELLO: ring size */
+    unsigned long long frames, updates, ioctls, bus_writes;  /* STATS */
+};
+
+#endif
@@ -0,0 +1,121 @@
+/*
+ * Example vga_comp client
+ *
+ * Either bounces the ball (-p) or cycles the background hue (-b), at
+ * the simulation rate hello uses, queueing each step through the
+ * compositor.  Run one of each, or several, to watch them share the
+ * display; -n multiplies the updates per step to show that the device
+ * still sees at most one write per register per frame.
+ *
+ * Usage: vga_comp_demo [-p | -b] [-l layer] [-n updates] [-t seconds]
+ *                      [-s socket]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include "vga_client.h"
+#include "frame_sched.h"
+
+#define STEP_NS 10000000LL
+
+static volatile sig_atomic_t done;
+
+static void handle_sigint(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path = NULL;
+    int background = 0, layer = 0, updates = 1, opt, i;
+    double seconds = 10;
+    unsigned long steps, step, full = 0;
+    struct vga_comp_reply stats;
+    struct vga_client *c;
+    struct frame_sched fs;
+    vga_ball_position_t pos;
+    vga_ball_color_t color;
+    int x = 20, y = 20, dx = 1, dy = 1, hue = 0;
+
+    while ((opt = getopt(argc, argv, "pbl:n:t:s:")) != -1)
+        switch (opt)
+        {
+        case 'p':
+            background = 0;
+            break;
+        case 'b':
+            background = 1;
+            break;
+        case 'l':
+            layer = atoi(optarg);
+            break;
+        case 'n':
+            updates = atoi(optarg);
+            break;
+        case 't':
+            seconds = atof(optarg);
+            break;
+        case 's':
+            path = optarg;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-p | -b] [-l layer] [-n updates] "
+                    "[-t seconds] [-s socket]\n", argv[0]);
+            return 1;
+        }
+
+    if ((c = vga_client_open(path, layer, background ? "background" : "ball"))
+        == NULL)
+    {
+        perror("could not join vga_comp");
+        return 1;
+    }
+    signal(SIGINT, handle_sigint);
+    frame_sched_init(&fs, STEP_NS);
+    steps = seconds * 1e9 / STEP_NS;
+
+    for (step = 0; step < steps && !done; step++)
+    {
+        for (i = 0; i < updates; i++)
+        {
+            if (background)
+            {
+                // Walk the hue around a simple red-green-blue wheel
+                hue = (hue + 1) % 768;
+                color.red = hue < 256 ? 255 - hue : hue >= 512 ? hue - 512 : 0;
+                color.green = hue < 256 ? hue : hue < 512 ? 511 - hue : 0;
+                color.blue = hue >= 256 && hue < 512 ? hue - 256 :
+                    hue >= 512 ? 767 - hue : 0;
+                if (vga_client_set_background(c, &color))
+                    full++;
+            }
+            else
+            {
+                x += dx;
+                y += dy;
+                if (x >= 640 - 16 || x <= 16)
+                    dx = -dx;
+                if (y >= 480 - 16 || y <= 16)
+                    dy = -dy;
+                pos.x = x << 6;
+                pos.y = y << 6;
+                if (vga_client_set_position(c, &pos))
+                    full++;
+            }
+        }
+        frame_sched_wait(&fs);
+    }
+
+    if (vga_client_stats(c, &stats) == 0)
+        printf("compositor: %llu frames, %llu updates, %llu ioctls, "
+               "%llu bus writes\n", stats.frames, stats.updates,
+               stats.ioctls, stats.bus_writes);
+    if (full)
+        printf("%lu updates dropped on a full ring\n", full);
+    vga_client_close(c);
+    return 0;
+}
@@ -0,0 +1,183 @@
+/*
+ * Software model of the vga_ball device
+ *
+ * Mirrors vga_ball_ioctl() in vga_ball.c and the register map in
+ * vga_ball.sv so clients can run without the board.  The sprite memory
+ * (see vga_ball.h) is the model's alone until the peripheral gains it.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include "vga_model.h"
+
+/* Register offsets, as in vga_ball.c */
+#define BG_RED    0
+#define BG_GREEN  1
+#define BG_BLUE   2
+#define RADIUS    3
+#define POS_X_LSB 4
+#define POS_X_MSB 5
+#define POS_Y_LSB 6
+#define POS_Y_MSB 7
+
+static void iowrite(struct vga_model *m, unsigned char v, int reg)
+{
+    m->regs[reg] = v;
+    m->bus_writes++;
+}
+
+/* Power-on state: the peripheral's reset values, then the driver's probe */
+void vga_model_init(struct vga_model *m)
+{
+    static const vga_ball_color_t beige = { 0xf9, 0xe4, 0xb7 };
+
+    memset(m, 0, sizeof(*m));
+    m->regs[BG_GREEN] = 0x80;
+    m->regs[BG_BLUE] = 0x80;
+    m->regs[RADIUS] = 16;
+    m->radius = 16;
+
+    iowrite(m, beige.red, BG_RED);
+    iowrite(m, beige.green, BG_GREEN);
+    iowrite(m, beige.blue, BG_BLUE);
+    m->background = beige;
+}
+
+/* Masked raw update, as write_regs() in vga_ball.c */
+static void write_regs(struct vga_model *m, const vga_ball_regs_t *r)
+{
+    int i;
+
+    for (i = 0; i < VGA_MODEL_NREGS; i++)
+        if (r->mask & (1 << i))
+            iowrite(m, r->regs[i], i);
+
+    m->background.red = m->regs[BG_RED];
+    m->background.green = m->regs[BG_GREEN];
+    m->background.blue = m->regs[BG_BLUE];
+    m->radius = m->regs[RADIUS];
+    m->position.x = m->regs[POS_X_LSB] | m->regs[POS_X_MSB] << 8;
+    m->position.y = m->regs[POS_Y_LSB] | m->regs[POS_Y_MSB] << 8;
+}
+
+/*
+ * Same commands, results and error codes as vga_ball_ioctl(); arg points
+ * to a vga_ball_regs_t for VGA_BALL_WRITE_REGS, a vga_ball_arg_t otherwise
+ */
+int vga_model_ioctl(struct vga_model *m, unsigned int cmd, void *argp)
+{
+    vga_ball_arg_t *arg = argp;
+
+    m->ioctls++;
+
+    switch (cmd)
+    {
+    case VGA_BALL_WRITE_BACKGROUND:
+        iowrite(m, arg->background.red, BG_RED);
+        iowrite(m, arg->background.green, BG_GREEN);
+        iowrite(m, arg->background.blue, BG_BLUE);
+        m->background = arg->background;
+        break;
+
+    case VGA_BALL_READ_BACKGROUND:
+        arg->background = m->background;
+        break;
+
+    case VGA_BALL_WRITE_POSITION:
+        iowrite(m, arg->position.x, POS_X_LSB);
+        iowrite(m, arg->position.x >> 8, POS_X_MSB);
+        iowrite(m, arg->position.y, POS_Y_LSB);
+        iowrite(m, arg->position.y >> 8, POS_Y_MSB);
+        m->position = arg->position;
+        break;
+
+    case VGA_BALL_READ_POSITION:
+        arg->position = m->position;
+        break;
+
+    case VGA_BALL_WRITE_REGS:
+        write_regs(m, argp);
+        break;
+
+    default:
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+/*
+ * A byte store through an mmap() of the device, as a client uploading
+ * sprites does; registers 0-7 change without the driver knowing
+ */
+void vga_model_store(struct vga_model *m, unsigned int offset,
+                     unsigned char v)
+{
+    if (offset < VGA_MODEL_NREGS)
+        m->regs[offset] = v;
+    else if (offset == VGA_BALL_CTRL)
+        m->ctrl = v;
+    else if (offset >= VGA_BALL_PALETTE &&
+             offset < VGA_BALL_PALETTE + VGA_BALL_PALETTE_BYTES)
+        m->palette[offset - VGA_BALL_PALETTE] = v;
+    else if (offset >= VGA_BALL_SPRITE_MEM && offset < VGA_BALL_MAP_SIZE)
+        m->sprite[offset - VGA_BALL_SPRITE_MEM] = v;
+    m->bus_writes++;
+}
+
+/* Palette index of a sprite pixel, or 0 (transparent) outside it */
+static unsigned int sprite_pixel(const struct vga_model *m, unsigned int sx,
+                                 unsigned int sy)
+{
+    const unsigned char *frame;
+    unsigned char b;
+
+    if (sx >= VGA_BALL_SPRITE_SIZE || sy >= VGA_BALL_SPRITE_SIZE)
+        return 0;
+    frame = m->sprite + ((m->ctrl >> 1) & 3) * VGA_BALL_SPRITE_BYTES;
+    b = frame[sy * (VGA_BALL_SPRITE_SIZE / 2) + sx / 2];
+    return sx & 1 ? b >> 4 : b & 0xf;
+}
+
+/*
+ * Draw the visible frame as RGB triples, computed from the registers
+ * exactly as the always_comb block in vga_ball.sv does per pixel
+ */
+void vga_model_render(const struct vga_model *m, unsigned char *rgb)
+{
+    unsigned int pos_x = (m->regs[POS_X_LSB] | m->regs[POS_X_MSB] << 8) >> 6;
+    unsigned int pos_y = (m->regs[POS_Y_LSB] | m->regs[POS_Y_MSB] << 8) >> 6;
+    unsigned int r2 = m->regs[RADIUS] * m->regs[RADIUS];
+    unsigned int vga_x, vga_y, dx, dy, px;
+
+    for (vga_y = 0; vga_y < VGA_MODEL_HEIGHT; vga_y++)
+    {
+        dy = vga_y > pos_y ? vga_y - pos_y : pos_y - vga_y;
+        for (vga_x = 0; vga_x < VGA_MODEL_WIDTH; vga_x++)
+        {
+            dx = vga_x > pos_x ? vga_x - pos_x : pos_x - vga_x;
+            // Off the left or top wraps to large, as in the hardware
+            px = m->ctrl & VGA_BALL_CTRL_SPRITE ?
+                sprite_pixel(m, (vga_x - pos_x + 16) & 0xfff,
+                             (vga_y - pos_y + 16) & 0xfff) : 0;
+            if (px)
+            {
+                rgb[0] = m->palette[px * 4];
+                rgb[1] = m->palette[px * 4 + 1];
+                rgb[2] = m->palette[px * 4 + 2];
+            }
+            else if (!(m->ctrl & VGA_BALL_CTRL_SPRITE) &&
+                     dx * dx + dy * dy < r2)
+            {
+                rgb[0] = rgb[1] = rgb[2] = 0xff;
+            }
+            else
+            {
+                rgb[0] = m->regs[BG_RED];
+                rgb[1] = m->regs[BG_GREEN];
+                rgb[2] = m->regs[BG_BLUE];
+            }
+            rgb += 3;
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef _VGA_MODEL_H
+#define _VGA_MODEL_H
+
+#include "vga_ball.h"
+
+/*
+ * Software stand-in for the vga_ball driver and peripheral
+ *
+ * Accepts the same ioctls as /dev/vga_ball and keeps the same byte
+ * registers as vga_ball.sv, counting the bus writes the real driver
+ * would have made.
+ */
+
+#define VGA_MODEL_NREGS VGA_BALL_NREGS
+
+struct vga_model {
+    unsigned char regs[VGA_MODEL_NREGS];  /* Register file, by byte offset */
+    unsigned char ctrl;                   /* Sprite memory, see vga_ball.h */
+    unsigned char palette[VGA_BALL_PALETTE_BYTES];
+    unsigned char sprite[VGA_BALL_SPRITE_FRAMES * VGA_BALL_SPRITE_BYTES];
+    vga_ball_color_t background;          /* Driver's cached copies */
+    vga_ball_position_t position;
+    unsigned char radius;
+    unsigned long ioctls;
+    unsigned long bus_writes;
+};
+
+/* Visible area of the display, from vga_counters */
+#define VGA_MODEL_WIDTH  640
+#define VGA_MODEL_HEIGHT 480
+
+/*
+ * Shared-memory frame buffer layout for viewers of a rendered model:
+ * this header followed by width * height RGB triples.  seq is odd while
+ * a frame is being written, so a reader copies the pixels and accepts
+ * them only if seq was even and unchanged across the copy.
+ */
+#define VGA_MODEL_FB_MAGIC 0x56474662  /* "VGFb" */
+
+struct vga_model_fb {
+    unsigned int magic;
+    unsigned int width, height;
+    unsigned int seq;
+    unsigned long long frame;       /* Frame number since the model started */
+    unsigned long long time_ns;     /* CLOCK_MONOTONIC at start of frame */
+    unsigned char rgb[];
+};
+
+void vga_model_init(struct vga_model *m);
+int vga_model_ioctl(struct vga_model *m, unsigned int cmd, void *arg);
+void vga_model_store(struct vga_model *m, unsigned int offset,
+                     unsigned char v);
+void vga_model_render(const struct vga_model *m, unsigned char *rgb);
+
+#endif
@@ -0,0 +1,167 @@
+/*
+ * Replay a captured vga_ball ioctl trace
+ *
+ * Feeds the commands in a trace (see vga_trace.h) to /dev/vga_ball or
+ * to the software model, either with the recorded spacing or as fast as
+ * possible, and reports throughput and per-command latency.
+ *
+ * Usage: vga_replay [-m] [-f] [-d device] trace
+ *   -m  replay into the software model instead of a device
+ *   -f  ignore recorded timing and issue commands back to back
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include "vga_trace.h"
+#include "vga_model.h"
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void sleep_until(long long ns)
+{
+    struct timespec ts = { ns / 1000000000LL, ns % 1000000000LL };
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        ;
+}
+
+/* Read a whole trace into memory so file I/O stays out of the timing */
+static struct vga_trace_rec *load_trace(const char *path, long *count)
+{
+    struct vga_trace_rec *recs = NULL;
+    long n = 0, cap = 0;
+    FILE *f;
+    int r;
+
+    if ((f = vga_trace_open(path)) == NULL)
+    {
+        fprintf(stderr, "%s: not a vga_ball trace\n", path);
+        return NULL;
+    }
+    for (;;)
+    {
+        if (n == cap)
+        {
+            cap = cap ? 2 * cap : 4096;
+            if ((recs = realloc(recs, cap * sizeof(*recs))) == NULL)
+            {
+                fprintf(stderr, "out of memory\n");
+                fclose(f);
+                return NULL;
+            }
+        }
+        if ((r = vga_trace_read(f, &recs[n])) <= 0)
+            break;
+        n++;
+    }
+    fclose(f);
+    if (r < 0)
+        fprintf(stderr, "%s: malformed record %ld, stopping there\n", path, n);
+    *count = n;
+    return recs;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *device = "/dev/vga_ball";
+    int use_model = 0, fast = 0, fd = -1, opt;
+    struct vga_model model;
+    struct vga_trace_rec *recs;
+    long n, i, errors = 0;
+    long long start, deadline, t0, t1, lat, lat_sum = 0, lat_max = 0;
+    long long late, late_sum = 0, late_max = 0;
+
+    while ((opt = getopt(argc, argv, "mfd:")) != -1)
+        switch (opt)
+        {
+        case 'm':
+            use_model = 1;
+            break;
+        case 'f':
+            fast = 1;
+            break;
+        case 'd':
+            device = optarg;
+            break;
+        default:
+            goto usage;
+        }
+    if (optind != argc - 1)
+        goto usage;
+
+    if ((recs = load_trace(argv[optind], &n)) == NULL)
+        return 1;
+
+    if (use_model)
+        vga_model_init(&model);
+    else if ((fd = open(device, O_RDWR)) == -1)
+    {
+        fprintf(stderr, "could not open %s\n", device);
+        return 1;
+    }
+
+    start = deadline = now_ns();
+    for (i = 0; i < n; i++)
+    {
+        if (!fast)
+        {
+            deadline += recs[i].dt_us * 1000LL;
+            sleep_until(deadline);
+        }
+
+        t0 = now_ns();
+        if (use_model)
+            errors += vga_model_ioctl(&model, recs[i].cmd, &recs[i].arg) != 0;
+        else
+            errors += vga_trace_ioctl(fd, recs[i].cmd, &recs[i].arg) != 0;
+        t1 = now_ns();
+
+        lat = t1 - t0;
+        lat_sum += lat;
+        if (lat > lat_max)
+            lat_max = lat;
+        if (!fast)
+        {
+            late = t0 - deadline;
+            late_sum += late;
+            if (late > late_max)
+                late_max = late;
+        }
+    }
+    t1 = now_ns();
+
+    printf("commands: %ld  errors: %ld  elapsed: %.3f s  rate: %.0f cmd/s\n",
+           n, errors, (t1 - start) / 1e9, n / ((t1 - start) / 1e9));
+    if (n)
+    {
+        printf("ioctl latency: avg %lld ns  max %lld ns\n",
+               lat_sum / n, lat_max);
+        if (!fast)
+            printf("lateness vs. recording: avg %lld us  max %lld us\n",
+                   late_sum / n / 1000, late_max / 1000);
+    }
+    if (use_model)
+        printf("model: %lu bus writes, bg %02x %02x %02x, x %04x y %04x\n",
+               model.bus_writes, model.background.red,
+               model.background.green, model.background.blue,
+               model.position.x, model.position.y);
+
+    free(recs);
+    if (fd != -1)
+        close(fd);
+    return errors != 0;
+
+usage:
+    fprintf(stderr, "usage: %s [-m] [-f] [-d device] trace\n", argv[0]);
+    return 1;
+}
@@ -0,0 +1,181 @@
+/*
+ * Capture and read back vga_ball ioctl streams
+ *
+ * Clients issue their ioctls through vga_trace_ioctl(); when a capture
+ * is open, each command is appended to the trace with its time since
+ * the previous one.  The replay tool reads the trace back with
+ * vga_trace_open() and vga_trace_read().
+ */
+
+#include <string.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include "vga_trace.h"
+
+static FILE *capture;
+static long long capture_last_ns;  /* Time the last record accounts for */
+
+/* Commands a trace may hold; records store only their _IOC_NR */
+static const unsigned int trace_cmds[] = {
+    VGA_BALL_WRITE_BACKGROUND,
+    VGA_BALL_READ_BACKGROUND,
+    VGA_BALL_WRITE_POSITION,
+    VGA_BALL_READ_POSITION,
+    VGA_BALL_WRITE_REGS,
+};
+
+static int cmd_from_nr(unsigned int nr, unsigned int *cmd)
+{
+    int i;
+
+    for (i = 0; i < (int)(sizeof(trace_cmds) / sizeof(trace_cmds[0])); i++)
+        if (_IOC_NR(trace_cmds[i]) == nr)
+        {
+            *cmd = trace_cmds[i];
+            return 0;
+        }
+    return -1;
+}
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int vga_trace_start(const char *path)
+{
+    static const unsigned char header[8] = {
+        'V', 'G', 'A', 'T', VGA_TRACE_VERSION, 0, 0, 0
+    };
+
+    if ((capture = fopen(path, "wb")) == NULL)
+        return -1;
+    /* Keep the capture cost to a memcpy per command most of the time */
+    setvbuf(capture, NULL, _IOFBF, 64 * 1024);
+    fwrite(header, sizeof(header), 1, capture);
+    capture_last_ns = now_ns();
+    return 0;
+}
+
+void vga_trace_stop(void)
+{
+    if (capture)
+    {
+        fclose(capture);
+        capture = NULL;
+    }
+}
+
+static void put_u16(unsigned char *p, unsigned int v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+static void log_cmd(unsigned int cmd, const void *argp)
+{
+    const vga_ball_arg_t *arg = argp;
+    const vga_ball_regs_t *regs = argp;
+    unsigned char rec[6 + VGA_BALL_NREGS];
+    long long dt = (now_ns() - capture_last_ns) / 1000;
+    uint32_t dt_us = dt > UINT32_MAX ? UINT32_MAX : dt;
+    int len = 5, i;
+
+    /* Advance by whole microseconds so rounding never accumulates */
+    capture_last_ns += dt_us * 1000LL;
+
+    put_u16(rec, dt_us);
+    put_u16(rec + 2, dt_us >> 16);
+    rec[4] = _IOC_NR(cmd);
+
+    switch (cmd)
+    {
+    case VGA_BALL_WRITE_BACKGROUND:
+        rec[len++] = arg->background.red;
+        rec[len++] = arg->background.green;
+        rec[len++] = arg->background.blue;
+        break;
+    case VGA_BALL_WRITE_POSITION:
+        put_u16(rec + len, arg->position.x);
+        put_u16(rec + len + 2, arg->position.y);
+        len += 4;
+        break;
+    case VGA_BALL_WRITE_REGS:
+        rec[len++] = regs->mask;
+        for (i = 0; i < VGA_BALL_NREGS; i++)
+            if (regs->mask & (1 << i))
+                rec[len++] = regs->regs[i];
+        break;
+    }
+    fwrite(rec, len, 1, capture);
+}
+
+/* ioctl() on a vga_ball device, logging the command if capturing */
+int vga_trace_ioctl(int fd, unsigned int cmd, void *arg)
+{
+    if (capture)
+        log_cmd(cmd, arg);
+    return ioctl(fd, cmd, arg);
+}
+
+/* Open a trace for reading, positioned at the first record */
+FILE *vga_trace_open(const char *path)
+{
+    unsigned char header[8];
+    FILE *f;
+
+    if ((f = fopen(path, "rb")) == NULL)
+        return NULL;
+    if (fread(header, sizeof(header), 1, f) != 1 ||
+        memcmp(header, VGA_TRACE_MAGIC, 4) ||
+        header[4] != VGA_TRACE_VERSION)
+    {
+        fclose(f);
+        return NULL;
+    }
+    return f;
+}
+
+/* Returns 1 for a record, 0 at end of trace, -1 on a malformed record */
+int vga_trace_read(FILE *f, struct vga_trace_rec *rec)
+{
+    unsigned char b[5];
+    int i;
+
+    if (fread(b, 1, 5, f) != 5)
+        return 0;
+    rec->dt_us = b[0] | b[1] << 8 | b[2] << 16 | (uint32_t)b[3] << 24;
+    if (cmd_from_nr(b[4], &rec->cmd))
+        return -1;
+
+    memset(&rec->regs, 0, sizeof(rec->regs));
+    memset(&rec->arg, 0, sizeof(rec->arg));
+    switch (rec->cmd)
+    {
+    case VGA_BALL_WRITE_BACKGROUND:
+        if (fread(b, 1, 3, f) != 3)
+            return -1;
+        rec->arg.background.red = b[0];
+        rec->arg.background.green = b[1];
+        rec->arg.background.blue = b[2];
+        break;
+    case VGA_BALL_WRITE_POSITION:
+        if (fread(b, 1, 4, f) != 4)
+            return -1;
+        rec->arg.position.x = b[0] | b[1] << 8;
+        rec->arg.position.y = b[2] | b[3] << 8;
+        break;
+    case VGA_BALL_WRITE_REGS:
+        if (fread(&rec->regs.mask, 1, 1, f) != 1)
+            return -1;
+        for (i = 0; i < VGA_BALL_NREGS; i++)
+            if ((rec->regs.mask & (1 << i)) &&
+                fread(&rec->regs.regs[i], 1, 1, f) != 1)
+                return -1;
+        break;
+    }
+    return 1;
+}
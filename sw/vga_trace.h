@@ -0,0 +1,43 @@
+#ifndef _VGA_TRACE_H
+#define _VGA_TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "vga_ball.h"
+
+/*
+ * Capture of vga_ball ioctl streams
+ *
+ * A trace file is an 8-byte header ("VGAT", version, flags) followed by
+ * one variable-length record per command, all little-endian:
+ *
+ *   u32 dt_us      Microseconds since the previous record (or capture start)
+ *   u8  nr         ioctl number (_IOC_NR of the VGA_BALL_* command)
+ *   ...            Payload: r g b for WRITE_BACKGROUND,
+ *                  x y (u16 each) for WRITE_POSITION,
+ *                  mask then the selected register bytes in order for
+ *                  WRITE_REGS, nothing for reads
+ */
+
+#define VGA_TRACE_MAGIC   "VGAT"
+#define VGA_TRACE_VERSION 1
+
+struct vga_trace_rec {
+    uint32_t dt_us;
+    unsigned int cmd;      /* Full ioctl command, e.g. VGA_BALL_WRITE_POSITION */
+    union {
+        vga_ball_arg_t arg;
+        vga_ball_regs_t regs;  /* VGA_BALL_WRITE_REGS */
+    };
+};
+
+/* Capture side: every vga_trace_ioctl() is logged while a capture is open */
+int vga_trace_start(const char *path);
+void vga_trace_stop(void);
+int vga_trace_ioctl(int fd, unsigned int cmd, void *arg);
+
+/* Replay side */
+FILE *vga_trace_open(const char *path);
+int vga_trace_read(FILE *f, struct vga_trace_rec *rec);
+
+#endif